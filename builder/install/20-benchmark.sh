@@ -0,0 +1,11 @@
+#!/usr/bin/env bash
+
+set -e
+
+git clone --branch "$BENCHMARK_VERSION" --depth 1 https://github.com/google/benchmark
+cd benchmark
+cp LICENSE "${LICENSE_DIR}/benchmark-${BENCHMARK_VERSION}"
+mkdir cmake-build
+cd cmake-build
+cmake -DCMAKE_BUILD_TYPE=Release -DCMAKE_INSTALL_PREFIX=/usr/local -DBENCHMARK_ENABLE_TESTING=OFF -DBENCHMARK_ENABLE_GTEST_TESTS=OFF ..
+cmake --build . --target install ${NPROCS:+-j ${NPROCS}}
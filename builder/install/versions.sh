@@ -1,6 +1,7 @@
 #!/usr/bin/env bash
 
 export B64_VERSION=1.2.1
+export BENCHMARK_VERSION=v1.7.1
 export CARES_VERSION=1.16.0
 export CMAKE_VERSION=3.15.2
 export GOOGLETEST_REVISION=release-1.10.0
@@ -0,0 +1,154 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include <fcntl.h>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "FileSystem.h"
+#include "ProcfsScraper_internal.h"
+#include "SockDiag.h"
+#include "benchmark/benchmark.h"
+
+namespace collector {
+
+namespace {
+
+// Number of listen sockets the established connections are spread across, such that the number of connections is not
+// limited by the size of the ephemeral port range.
+constexpr int kNumListeners = 8;
+
+// SocketPool holds established loopback TCP connections in the network namespace of the benchmark process. Each
+// connection accounts for two sockets (the client and the accepted server end).
+class SocketPool {
+ public:
+  static SocketPool& Get() {
+    static SocketPool pool;
+    return pool;
+  }
+
+  // Resize grows or shrinks the pool to hold (approximately) num_sockets sockets.
+  bool Resize(int num_sockets) {
+    if (listeners_.empty() && !Listen()) return false;
+
+    while (static_cast<int>(sockets_.size()) > num_sockets) {
+      sockets_.pop_back();
+    }
+
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return false;
+    rlim_t needed = num_sockets + kNumListeners + 64;
+    if (limit.rlim_cur < needed) {
+      if (limit.rlim_max < needed) return false;
+      limit.rlim_cur = needed;
+      if (setrlimit(RLIMIT_NOFILE, &limit) != 0) return false;
+    }
+
+    while (static_cast<int>(sockets_.size()) + 1 < num_sockets) {
+      if (!Connect(sockets_.size() / 2 % kNumListeners)) return false;
+    }
+    return true;
+  }
+
+ private:
+  bool Listen() {
+    for (int i = 0; i < kNumListeners; i++) {
+      FDHandle fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (!fd.valid()) return false;
+
+      struct sockaddr_in addr = {};
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      if (::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) return false;
+      if (::listen(fd, 128) != 0) return false;
+
+      socklen_t addr_len = sizeof(addr);
+      if (getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len) != 0) return false;
+      listen_addrs_.push_back(addr);
+      listeners_.push_back(std::move(fd));
+    }
+    return true;
+  }
+
+  bool Connect(int listener) {
+    FDHandle client = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (!client.valid()) return false;
+
+    const auto& addr = listen_addrs_[listener];
+    if (::connect(client, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr)) != 0) return false;
+
+    FDHandle server = accept4(listeners_[listener], nullptr, nullptr, SOCK_CLOEXEC);
+    if (!server.valid()) return false;
+
+    sockets_.push_back(std::move(client));
+    sockets_.push_back(std::move(server));
+    return true;
+  }
+
+  std::vector<FDHandle> listeners_;
+  std::vector<struct sockaddr_in> listen_addrs_;
+  std::vector<FDHandle> sockets_;
+};
+
+void BM_GetConnections(benchmark::State& state, ConnectionSource source) {
+  if (!SocketPool::Get().Resize(state.range(0))) {
+    state.SkipWithError("could not set up sockets, check RLIMIT_NOFILE");
+    return;
+  }
+
+  FDHandle dirfd = open("/proc/self", O_RDONLY | O_DIRECTORY);
+  if (source == ConnectionSource::SOCK_DIAG) {
+    FDHandle netns_fd = openat(dirfd, "ns/net", O_RDONLY);
+    if (!OpenSockDiagSocket(netns_fd).valid()) {
+      // GetConnections would silently fall back to procfs.
+      state.SkipWithError("sock_diag is not usable, requires CAP_SYS_ADMIN");
+      return;
+    }
+  }
+
+  size_t num_connections = 0;
+  for (auto _ : state) {
+    UnorderedMap<ino_t, ConnInfo> connections;
+    UnorderedMap<ino_t, EndpointInfo> listen_endpoints;
+    if (!GetConnections(dirfd, source, &connections, &listen_endpoints)) {
+      state.SkipWithError("GetConnections failed");
+      return;
+    }
+    num_connections = connections.size();
+    benchmark::DoNotOptimize(listen_endpoints);
+  }
+
+  state.counters["connections"] = num_connections;
+  state.counters["sockets_per_sec"] = benchmark::Counter(state.iterations() * state.range(0), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_CAPTURE(BM_GetConnections, procfs, ConnectionSource::PROCFS)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_GetConnections, sock_diag, ConnectionSource::SOCK_DIAG)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,162 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <grpc/compression.h>
+#include <grpcpp/support/byte_buffer.h>
+#include <zlib.h>
+
+#include "GRPC.h"
+#include "NetworkConnectionInfoEncoder.h"
+#include "NetworkStateCheckpoint.h"
+#include "ProtoUtil.h"
+#include "benchmark/benchmark.h"
+
+// Measures the CPU cost and compression ratio of the gRPC message compression algorithms on network connection info
+// messages. The deltas are read from a network state checkpoint if COLLECTOR_BENCHMARK_CHECKPOINT points to one, and
+// are synthesized otherwise. gRPC compresses messages with zlib, which is replicated here with the same parameters so
+// that the benchmark does not need a server.
+
+namespace collector {
+
+namespace {
+
+constexpr size_t kMaxMessageEntries = 1000;
+
+void SynthesizeState(NetworkState* state) {
+  std::mt19937 rng(42);
+  std::vector<std::string> containers;
+  for (int i = 0; i < 50; i++) {
+    char id[13];
+    snprintf(id, sizeof(id), "%012x", static_cast<unsigned int>(rng()) & 0xfffffff);
+    containers.emplace_back(id);
+  }
+
+  // Connections between pods of a cluster network and to a few external services, with ephemeral client ports.
+  for (int i = 0; i < 20000; i++) {
+    const auto& container = containers[rng() % containers.size()];
+    bool is_server = rng() % 4 == 0;
+    Endpoint local(Address(10, 128, rng() % 4, rng() % 64), is_server ? 8080 : 32768 + rng() % 28000);
+    Endpoint remote = rng() % 8 == 0 ? Endpoint(Address(52, 84, rng() % 16, rng() % 256), 443)
+                                     : Endpoint(Address(10, 128, rng() % 4, rng() % 64), is_server ? 32768 + rng() % 28000 : 8080);
+    ConnStatus status(1600000000000000 + rng() % 60000000, rng() % 3 != 0);
+    state->reported_conns.emplace(Connection(container, local, remote, L4Proto::TCP, is_server), status);
+  }
+
+  for (const auto& container : containers) {
+    for (uint16_t port : {8080, 9090, 53}) {
+      ContainerEndpoint cep(container, Endpoint(Address(), port), port == 53 ? L4Proto::UDP : L4Proto::TCP, nullptr);
+      state->reported_endpoints.emplace(cep, ConnStatus(1600000000000000, true));
+    }
+  }
+}
+
+const std::vector<grpc::ByteBuffer>& Messages() {
+  static std::vector<grpc::ByteBuffer>* messages = [] {
+    NetworkState state;
+    const char* path = std::getenv("COLLECTOR_BENCHMARK_CHECKPOINT");
+    if (!path || !NetworkStateCheckpoint(path, 0, INT64_MAX).Load(&state, 0)) {
+      SynthesizeState(&state);
+    }
+
+    auto* messages = new std::vector<grpc::ByteBuffer>;
+    NetworkConnectionInfoEncoder encoder;
+    auto flush = [&] {
+      if (encoder.num_entries() > 0) {
+        messages->push_back(encoder.Finish(CurrentTimeProto()));
+        encoder.Reset();
+      }
+    };
+    for (const auto& conn : state.reported_conns) {
+      encoder.AddConnection(conn.first, conn.second);
+      if (encoder.num_entries() >= kMaxMessageEntries) flush();
+    }
+    flush();
+    for (const auto& cep : state.reported_endpoints) {
+      encoder.AddContainerEndpoint(cep.first, cep.second);
+      if (encoder.num_entries() >= kMaxMessageEntries) flush();
+    }
+    flush();
+    return messages;
+  }();
+  return *messages;
+}
+
+// Compresses the message like gRPC's message_compress does, and returns the compressed size.
+size_t Compress(z_stream* zs, const grpc::ByteBuffer& message, std::vector<uint8_t>* out) {
+  std::vector<grpc::Slice> slices;
+  message.Dump(&slices);
+  deflateReset(zs);
+  out->resize(deflateBound(zs, message.Length()));
+  zs->next_out = out->data();
+  zs->avail_out = out->size();
+  for (size_t i = 0; i < slices.size(); i++) {
+    zs->next_in = const_cast<uint8_t*>(slices[i].begin());
+    zs->avail_in = slices[i].size();
+    deflate(zs, i + 1 == slices.size() ? Z_FINISH : Z_NO_FLUSH);
+  }
+  return out->size() - zs->avail_out;
+}
+
+void BM_CompressMessages(benchmark::State& state) {
+  auto algorithm = static_cast<grpc_compression_algorithm>(state.range(0));
+  state.SetLabel(CompressionAlgorithmName(algorithm));
+  const auto& messages = Messages();
+
+  z_stream zs = {};
+  if (algorithm != GRPC_COMPRESS_NONE) {
+    deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 | (algorithm == GRPC_COMPRESS_GZIP ? 16 : 0), 8,
+                 Z_DEFAULT_STRATEGY);
+  }
+
+  std::vector<uint8_t> out;
+  size_t bytes_in = 0, bytes_out = 0;
+  for (auto _ : state) {
+    bytes_in = bytes_out = 0;
+    for (const auto& message : messages) {
+      bytes_in += message.Length();
+      bytes_out += algorithm == GRPC_COMPRESS_NONE ? message.Length() : Compress(&zs, message, &out);
+    }
+    benchmark::DoNotOptimize(out.data());
+  }
+
+  if (algorithm != GRPC_COMPRESS_NONE) {
+    deflateEnd(&zs);
+  }
+
+  state.SetBytesProcessed(state.iterations() * bytes_in);
+  state.counters["messages"] = messages.size();
+  state.counters["bytes_in"] = bytes_in;
+  state.counters["bytes_out"] = bytes_out;
+  state.counters["ratio"] = bytes_out ? static_cast<double>(bytes_in) / bytes_out : 0;
+}
+
+BENCHMARK(BM_CompressMessages)->Arg(GRPC_COMPRESS_NONE)->Arg(GRPC_COMPRESS_DEFLATE)->Arg(GRPC_COMPRESS_GZIP);
+
+}  // namespace
+
+}  // namespace collector
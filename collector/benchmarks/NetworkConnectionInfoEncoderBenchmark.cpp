@@ -0,0 +1,117 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#include <string>
+#include <vector>
+
+#include <google/protobuf/arena.h>
+#include <google/protobuf/util/time_util.h>
+
+#include "internalapi/sensor/network_connection_iservice.pb.h"
+
+#include "NetworkConnectionInfoEncoder.h"
+#include "ProtoUtil.h"
+#include "benchmark/benchmark.h"
+
+namespace collector {
+
+namespace {
+
+std::vector<std::pair<Connection, ConnStatus>> MakeConnections(int num_conns) {
+  std::vector<std::pair<Connection, ConnStatus>> conns;
+  conns.reserve(num_conns);
+  for (int i = 0; i < num_conns; i++) {
+    Endpoint local(Address(10, 0, (i >> 8) & 0xff, i & 0xff), 1024 + i % 60000);
+    Endpoint remote(Address(192, 168, (i >> 16) & 0xff, (i >> 8) & 0xff), 443);
+    conns.emplace_back(Connection("0123456789ab", local, remote, L4Proto::TCP, false), ConnStatus(1600000000000000 + i, i % 4 != 0));
+  }
+  return conns;
+}
+
+sensor::NetworkAddress* EndpointToProto(google::protobuf::Arena* arena, const Endpoint& endpoint) {
+  auto* addr_proto = google::protobuf::Arena::CreateMessage<sensor::NetworkAddress>(arena);
+  addr_proto->set_address_data(endpoint.address().data(), endpoint.address().length());
+  addr_proto->set_port(endpoint.port());
+  return addr_proto;
+}
+
+// Builds the message objects in an arena and serializes them, as the network status notifier did before the encoder.
+void BM_SerializeMessageObjects(benchmark::State& state) {
+  auto conns = MakeConnections(state.range(0));
+  google::protobuf::Arena arena;
+  std::string serialized;
+
+  for (auto _ : state) {
+    auto* msg = google::protobuf::Arena::CreateMessage<sensor::NetworkConnectionInfoMessage>(&arena);
+    auto* info = msg->mutable_info();
+    for (const auto& conn : conns) {
+      auto* conn_proto = google::protobuf::Arena::CreateMessage<sensor::NetworkConnection>(&arena);
+      conn_proto->set_container_id(conn.first.container());
+      conn_proto->set_role(conn.first.is_server() ? sensor::ROLE_SERVER : sensor::ROLE_CLIENT);
+      conn_proto->set_protocol(storage::L4_PROTOCOL_TCP);
+      conn_proto->set_socket_family(sensor::SOCKET_FAMILY_IPV4);
+      conn_proto->set_allocated_local_address(EndpointToProto(&arena, conn.first.local()));
+      conn_proto->set_allocated_remote_address(EndpointToProto(&arena, conn.first.remote()));
+      if (!conn.second.IsActive()) {
+        *conn_proto->mutable_close_timestamp() = google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(
+            conn.second.LastActiveTime());
+      }
+      info->mutable_updated_connections()->AddAllocated(conn_proto);
+    }
+    *info->mutable_time() = CurrentTimeProto();
+
+    msg->SerializeToString(&serialized);
+    benchmark::DoNotOptimize(serialized);
+    arena.Reset();
+  }
+
+  state.SetItemsProcessed(state.iterations() * conns.size());
+  state.SetBytesProcessed(state.iterations() * serialized.size());
+}
+
+void BM_EncodeDirect(benchmark::State& state) {
+  auto conns = MakeConnections(state.range(0));
+  NetworkConnectionInfoEncoder encoder;
+  size_t size = 0;
+
+  for (auto _ : state) {
+    encoder.Reset();
+    for (const auto& conn : conns) {
+      encoder.AddConnection(conn.first, conn.second);
+    }
+    grpc::ByteBuffer buffer = encoder.Finish(CurrentTimeProto());
+    size = buffer.Length();
+    benchmark::DoNotOptimize(buffer);
+  }
+
+  state.SetItemsProcessed(state.iterations() * conns.size());
+  state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_SerializeMessageObjects)->Arg(100)->Arg(10000)->Arg(100000);
+BENCHMARK(BM_EncodeDirect)->Arg(100)->Arg(10000)->Arg(100000);
+
+}  // namespace
+
+}  // namespace collector
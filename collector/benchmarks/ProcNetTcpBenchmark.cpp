@@ -0,0 +1,129 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+#include "FileSystem.h"
+#include "HexDecode.h"
+#include "ProcfsScraper_internal.h"
+#include "benchmark/benchmark.h"
+
+namespace collector {
+
+namespace {
+
+constexpr int kNumLines = 1000000;
+
+// MakeNetTcpFile returns a file descriptor of an unlinked temporary file with a `net/tcp[6]`-like table of num_lines
+// sockets. Most of them are established connections, with a few listen sockets and some sockets in TIME_WAIT state.
+FDHandle MakeNetTcpFile(Address::Family family, int num_lines) {
+  std::FILE* f = std::tmpfile();
+  std::fputs("  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n", f);
+
+  bool ipv6 = family == Address::Family::IPV6;
+  for (int i = 0; i < num_lines; i++) {
+    const char* state = "01";
+    if (i < num_lines / 100) {
+      state = "0A";
+    } else if (i % 10 == 0) {
+      state = "06";
+    }
+    unsigned remote = 0x0a000000 | (i >> 8);
+    if (ipv6) {
+      std::fprintf(f, "%4d: 000080FE00000000FF000000%08X:%04X 000080FE00000000FF000000%08X:%04X %s 00000000:00000000 00:00000000 00000000  1000        0 %d 1 0000000000000000 20 4 30 10 -1\n",
+                   i, 0x0100000a, 8000 + i % 100, remote, 1024 + i % 60000, state, 100000 + i);
+    } else {
+      std::fprintf(f, "%4d: %08X:%04X %08X:%04X %s 00000000:00000000 00:00000000 00000000  1000        0 %d 1 0000000000000000 20 4 30 10 -1\n",
+                   i, 0x0100000a, 8000 + i % 100, remote, 1024 + i % 60000, state, 100000 + i);
+    }
+  }
+  std::fflush(f);
+
+  FDHandle fd = dup(fileno(f));
+  std::fclose(f);
+  return fd;
+}
+
+void BM_ReadConnectionsFromFile(benchmark::State& state, Address::Family family) {
+  FDHandle fd = MakeNetTcpFile(family, kNumLines);
+
+  for (auto _ : state) {
+    lseek(fd, 0, SEEK_SET);
+    UnorderedMap<ino_t, ConnInfo> connections;
+    UnorderedMap<ino_t, EndpointInfo> listen_endpoints;
+    if (!ReadConnectionsFromFile(family, L4Proto::TCP, fd, &connections, &listen_endpoints)) {
+      state.SkipWithError("ReadConnectionsFromFile failed");
+      return;
+    }
+    benchmark::DoNotOptimize(connections);
+  }
+
+  state.SetItemsProcessed(state.iterations() * kNumLines);
+}
+
+BENCHMARK_CAPTURE(BM_ReadConnectionsFromFile, ipv4, Address::Family::IPV4)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ReadConnectionsFromFile, ipv6, Address::Family::IPV6)->Unit(benchmark::kMillisecond);
+
+using DecodeFunc = bool (*)(const char*, int, bool, uint8_t*);
+
+#ifdef __x86_64__
+bool HasSSSE3() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("ssse3");
+}
+
+bool HasAVX2() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+#endif
+
+void BM_DecodeHexWords(benchmark::State& state, DecodeFunc decode, bool supported) {
+  if (!supported) {
+    state.SkipWithError("instruction set not supported");
+    return;
+  }
+
+  int num_words = state.range(0);
+  const char hex[] = "0123456789ABCDEFFEDCBA9876543210";
+  uint8_t out[16];
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(decode(hex, num_words, true, out));
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_CAPTURE(BM_DecodeHexWords, scalar, internal::DecodeHexWordsScalar, true)->Arg(1)->Arg(4);
+#ifdef __x86_64__
+BENCHMARK_CAPTURE(BM_DecodeHexWords, ssse3, internal::DecodeHexWordsSSSE3, HasSSSE3())->Arg(1)->Arg(4);
+BENCHMARK_CAPTURE(BM_DecodeHexWords, avx2, internal::DecodeHexWordsAVX2, HasAVX2())->Arg(1)->Arg(4);
+#endif
+
+}  // namespace
+
+}  // namespace collector
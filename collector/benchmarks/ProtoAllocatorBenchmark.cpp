@@ -0,0 +1,104 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include "internalapi/sensor/network_connection_iservice.grpc.pb.h"
+
+#include "ProtoAllocator.h"
+#include "benchmark/benchmark.h"
+
+namespace collector {
+
+namespace {
+
+// BuildMessage builds a network info message with the given number of connections, in the same way as the
+// NetworkStatusNotifier does.
+template <typename Allocator>
+void BuildMessage(Allocator* allocator, int num_conns) {
+  auto* msg = allocator->AllocateRoot();
+  auto* info = msg->mutable_info();
+  for (int i = 0; i < num_conns; i++) {
+    auto* conn = allocator->template Allocate<sensor::NetworkConnection>();
+    conn->set_container_id("0123456789ab");
+    conn->set_role(sensor::ROLE_CLIENT);
+    conn->set_protocol(storage::L4_PROTOCOL_TCP);
+
+    auto* local = allocator->template Allocate<sensor::NetworkAddress>();
+    local->set_port(1024 + i % 60000);
+    conn->set_allocated_local_address(local);
+
+    auto* remote = allocator->template Allocate<sensor::NetworkAddress>();
+    uint32_t ip = 0x0a000000 | i;
+    remote->set_address_data(&ip, sizeof(ip));
+    remote->set_port(443);
+    conn->set_allocated_remote_address(remote);
+
+    info->mutable_updated_connections()->AddAllocated(conn);
+  }
+  benchmark::DoNotOptimize(msg->ByteSizeLong());
+  allocator->Reset();
+}
+
+template <typename Allocator>
+void BM_BuildMessage(benchmark::State& state) {
+  Allocator allocator;
+  int num_conns = state.range(0);
+
+  for (auto _ : state) {
+    BuildMessage(&allocator, num_conns);
+  }
+
+  state.SetItemsProcessed(state.iterations() * num_conns);
+}
+
+// The arena allocator adapts its pool to the message size within the first iterations, so the steady state reported
+// here is that of a pool with hits only. BM_BuildMessageVarying alternates between small and large messages instead.
+template <typename Allocator>
+void BM_BuildMessageVarying(benchmark::State& state) {
+  Allocator allocator;
+  int num_conns = state.range(0);
+
+  int64_t i = 0;
+  for (auto _ : state) {
+    BuildMessage(&allocator, (i++ % 16 == 0) ? num_conns : num_conns / 100);
+  }
+
+  ProtoAllocatorStats stats = allocator.allocator_stats();
+  state.counters["hit_rate"] = stats.resets ? static_cast<double>(stats.hits) / stats.resets : 0.0;
+  state.counters["pool_size"] = stats.pool_size;
+}
+
+using HeapAllocator = internal::HeapProtoAllocator<sensor::NetworkConnectionInfoMessage>;
+
+BENCHMARK_TEMPLATE(BM_BuildMessage, HeapAllocator)->Arg(100)->Arg(10000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_BuildMessageVarying, HeapAllocator)->Arg(100000);
+
+#ifdef USE_PROTO_ARENAS
+using ArenaAllocator = internal::ArenaProtoAllocator<sensor::NetworkConnectionInfoMessage>;
+
+BENCHMARK_TEMPLATE(BM_BuildMessage, ArenaAllocator)->Arg(100)->Arg(10000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_BuildMessageVarying, ArenaAllocator)->Arg(100000);
+#endif
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,129 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "storage/process_indicator.pb.h"
+
+#include "RateLimit.h"
+#include "benchmark/benchmark.h"
+
+// Rate limiting of process signals during an exec storm: many short-lived processes, e.g., a shell loop or a build,
+// with a few thousand distinct command lines. At 100k execs/sec, the rate limiter may take at most 10us per exec. With
+// more distinct command lines than the cache capacity, every exec takes the eviction path.
+
+namespace collector {
+
+namespace {
+
+std::vector<storage::ProcessSignal> MakeExecStorm(int num_distinct) {
+  std::mt19937 rng(1);
+  std::vector<storage::ProcessSignal> signals(num_distinct);
+  for (int i = 0; i < num_distinct; i++) {
+    auto& s = signals[i];
+    s.set_container_id("c" + std::to_string(rng() % 50) + "0123456789a");
+    s.set_name(i % 3 == 0 ? "sh" : "gcc");
+    s.set_exec_file_path(i % 3 == 0 ? "/bin/sh" : "/usr/bin/gcc");
+    std::string args = "-O2 -Wall -I/usr/include -c src/file" + std::to_string(i) + ".c -o build/file" + std::to_string(i) + ".o";
+    // Some command lines exceed the 256 bytes of args that are part of the key.
+    if (i % 10 == 0) args.append(300, 'x');
+    s.set_args(args);
+  }
+  return signals;
+}
+
+// The string keys and cache as used before the hashed keys.
+std::string StringKey(const storage::ProcessSignal& s) {
+  std::stringstream ss;
+  ss << s.container_id() << " " << s.name() << " ";
+  if (s.args().length() <= 256) {
+    ss << s.args();
+  } else {
+    ss.write(s.args().c_str(), 256);
+  }
+  ss << " " << s.exec_file_path();
+  return ss.str();
+}
+
+class StringKeyCache {
+ public:
+  StringKeyCache(size_t capacity, int64_t burst_size, int64_t refill_time) : capacity_(capacity), limiter_(burst_size, refill_time) {}
+
+  bool Allow(std::string key) {
+    auto pair = cache_.emplace(std::make_pair(key, TokenBucket()));
+    if (pair.second && cache_.size() > capacity_) {
+      cache_.clear();
+      return true;
+    }
+    return limiter_.Allow(&pair.first->second);
+  }
+
+ private:
+  size_t capacity_;
+  Limiter limiter_;
+  std::unordered_map<std::string, TokenBucket> cache_;
+};
+
+uint64_t HashedKey(const storage::ProcessSignal& s) {
+  RateLimitKeyHasher hasher;
+  hasher.Add(s.container_id()).Add(s.name());
+  hasher.Add(s.args().data(), std::min<size_t>(s.args().length(), 256));
+  hasher.Add(s.exec_file_path());
+  return hasher.key();
+}
+
+void BM_StringKeys(benchmark::State& state) {
+  auto signals = MakeExecStorm(state.range(0));
+  StringKeyCache cache(4096, 10, 30 * 60);
+  size_t i = 0, allowed = 0;
+  for (auto _ : state) {
+    allowed += cache.Allow(StringKey(signals[i]));
+    if (++i == signals.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["allowed"] = benchmark::Counter(allowed, benchmark::Counter::kAvgIterations);
+}
+
+void BM_HashedKeys(benchmark::State& state) {
+  auto signals = MakeExecStorm(state.range(0));
+  RateLimitCache cache(4096, 10, 30 * 60);
+  size_t i = 0, allowed = 0;
+  for (auto _ : state) {
+    allowed += cache.Allow(HashedKey(signals[i]));
+    if (++i == signals.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.counters["allowed"] = benchmark::Counter(allowed, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_StringKeys)->Arg(1000)->Arg(3000)->Arg(10000);
+BENCHMARK(BM_HashedKeys)->Arg(1000)->Arg(3000)->Arg(10000);
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,64 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#include <uuid/uuid.h>
+
+#include "Utility.h"
+#include "benchmark/benchmark.h"
+
+// Generation of the ids of process signals, one per exec and per process sent when connecting to sensor.
+
+namespace collector {
+
+namespace {
+
+// The id generation as done before UUIDStr used its own generator.
+const char* LibUUIDStr() {
+  uuid_t uuid;
+  thread_local char uuid_str[37];
+  uuid_generate_time_safe(uuid);
+  uuid_unparse_lower(uuid, uuid_str);
+  return uuid_str;
+}
+
+void BM_LibUUIDStr(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(LibUUIDStr());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_UUIDStr(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(UUIDStr());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_LibUUIDStr)->ThreadRange(1, 8);
+BENCHMARK(BM_UUIDStr)->ThreadRange(1, 8);
+
+}  // namespace
+
+}  // namespace collector
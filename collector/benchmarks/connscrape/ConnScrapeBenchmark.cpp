@@ -0,0 +1,193 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+// Benchmarks of ConnScraper::Scrape on synthetic /proc trees, end-to-end and per phase.
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "CollectorStats.h"
+#include "FakeProcDir.h"
+#include "ProcfsScraper.h"
+#include "benchmark/benchmark.h"
+
+namespace collector {
+
+namespace {
+
+// GetFakeProcDir returns a tree with the given number of container processes and network namespaces. Trees are
+// generated once and shared between benchmarks, as generating them takes much longer than scraping them.
+const FakeProcDir* GetFakeProcDir(int num_pids, int num_namespaces) {
+  static std::map<std::pair<int, int>, std::unique_ptr<FakeProcDir>> dirs;
+
+  auto& dir = dirs[std::make_pair(num_pids, num_namespaces)];
+  if (!dir) {
+    FakeProcSpec spec;
+    spec.num_pids = num_pids;
+    spec.num_host_pids = num_pids / 10;
+    spec.num_namespaces = num_namespaces;
+    spec.num_containers = std::max(num_namespaces / 2, 1);
+    dir = FakeProcDir::Create(spec);
+  }
+  return dir.get();
+}
+
+// PhaseTimers reports the average time per iteration spent in each phase of the scrape.
+class PhaseTimers {
+ public:
+  PhaseTimers() : start_(Snapshot()) {}
+
+  void Report(benchmark::State& state) const {
+    auto end = Snapshot();
+    static const char* const kNames[] = {"proc_walk_us", "read_conns_us", "resolve_us"};
+    for (size_t i = 0; i < end.size(); i++) {
+      state.counters[kNames[i]] = benchmark::Counter(end[i] - start_[i], benchmark::Counter::kAvgIterations);
+    }
+  }
+
+ private:
+  static std::vector<int64_t> Snapshot() {
+    const auto& stats = CollectorStats::GetOrCreate();
+    return {
+        stats.GetTimerDurationMicros(CollectorStats::net_scrape_proc_walk),
+        stats.GetTimerDurationMicros(CollectorStats::net_scrape_read_conns),
+        stats.GetTimerDurationMicros(CollectorStats::net_scrape_resolve),
+    };
+  }
+
+  std::vector<int64_t> start_;
+};
+
+bool CheckResult(benchmark::State& state, const FakeProcDir& dir, const std::vector<Connection>& connections,
+                 const std::vector<ContainerEndpoint>& listen_endpoints) {
+  if (connections.size() != dir.num_connections() || listen_endpoints.size() != dir.num_listen_endpoints()) {
+    state.SkipWithError("scrape returned an unexpected number of connections");
+    return false;
+  }
+  return true;
+}
+
+// Arguments: number of container processes, number of network namespaces, number of workers.
+void ScrapeArgs(benchmark::internal::Benchmark* b) {
+  for (int num_pids : {1000, 10000}) {
+    for (int num_namespaces : {10, 500}) {
+      for (int num_workers : {1, 4}) {
+        b->Args({num_pids, num_namespaces, num_workers});
+      }
+    }
+  }
+  b->ArgNames({"pids", "netns", "workers"})->Unit(benchmark::kMillisecond);
+}
+
+// BM_Scrape measures repeated scrapes with the same scraper, i.e., with a warm pid metadata cache.
+void BM_Scrape(benchmark::State& state) {
+  const auto* dir = GetFakeProcDir(state.range(0), state.range(1));
+  if (!dir) {
+    state.SkipWithError("could not create fake /proc");
+    return;
+  }
+
+  ConnScraper scraper(dir->path(), nullptr, state.range(2));
+  std::vector<Connection> connections;
+  std::vector<ContainerEndpoint> listen_endpoints;
+
+  PhaseTimers timers;
+  for (auto _ : state) {
+    connections.clear();
+    listen_endpoints.clear();
+    if (!scraper.Scrape(&connections, &listen_endpoints)) {
+      state.SkipWithError("Scrape failed");
+      return;
+    }
+  }
+  if (!CheckResult(state, *dir, connections, listen_endpoints)) return;
+
+  timers.Report(state);
+  state.counters["connections"] = connections.size();
+  state.counters["endpoints"] = listen_endpoints.size();
+}
+
+// BM_ScrapeCold measures the first scrape of a new scraper, i.e., with an empty pid metadata cache.
+void BM_ScrapeCold(benchmark::State& state) {
+  const auto* dir = GetFakeProcDir(state.range(0), state.range(1));
+  if (!dir) {
+    state.SkipWithError("could not create fake /proc");
+    return;
+  }
+
+  std::vector<Connection> connections;
+  std::vector<ContainerEndpoint> listen_endpoints;
+
+  PhaseTimers timers;
+  for (auto _ : state) {
+    ConnScraper scraper(dir->path(), nullptr, state.range(2));
+    connections.clear();
+    listen_endpoints.clear();
+    if (!scraper.Scrape(&connections, &listen_endpoints)) {
+      state.SkipWithError("Scrape failed");
+      return;
+    }
+  }
+  if (!CheckResult(state, *dir, connections, listen_endpoints)) return;
+
+  timers.Report(state);
+}
+
+// BM_ScrapeSliced measures a complete sequence of scrape slices, without the delays between them.
+void BM_ScrapeSliced(benchmark::State& state) {
+  const auto* dir = GetFakeProcDir(state.range(0), state.range(1));
+  if (!dir) {
+    state.SkipWithError("could not create fake /proc");
+    return;
+  }
+
+  const int num_slices = 10;
+  ConnScraper scraper(dir->path(), nullptr, state.range(2));
+  std::vector<Connection> connections;
+  std::vector<ContainerEndpoint> listen_endpoints;
+
+  PhaseTimers timers;
+  for (auto _ : state) {
+    connections.clear();
+    listen_endpoints.clear();
+    for (int slice = 0; slice < num_slices; slice++) {
+      if (!scraper.ScrapeSlice(slice, num_slices, &connections, &listen_endpoints)) {
+        state.SkipWithError("ScrapeSlice failed");
+        return;
+      }
+    }
+  }
+  if (!CheckResult(state, *dir, connections, listen_endpoints)) return;
+
+  timers.Report(state);
+}
+
+BENCHMARK(BM_Scrape)->Apply(ScrapeArgs);
+BENCHMARK(BM_ScrapeCold)->Apply(ScrapeArgs);
+BENCHMARK(BM_ScrapeSliced)->Apply(ScrapeArgs);
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,114 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+// Benchmarks of resolving the container IDs of processes from their cgroup files.
+
+#include <cctype>
+#include <memory>
+#include <vector>
+
+#include <fcntl.h>
+
+#include "CollectorStats.h"
+#include "ContainerIDCache.h"
+#include "FakeProcDir.h"
+#include "FileSystem.h"
+#include "ProcfsScraper_internal.h"
+#include "benchmark/benchmark.h"
+
+namespace collector {
+
+namespace {
+
+// GetContainerProcDir returns a tree with 50k processes in 500 containers, half of them using cgroup v1 and half of
+// them cgroup v2 layouts. The processes have no open files, as only their cgroup files are of interest.
+const FakeProcDir* GetContainerProcDir() {
+  static std::unique_ptr<FakeProcDir> dir = [] {
+    FakeProcSpec spec;
+    spec.num_pids = 50000;
+    spec.num_host_pids = 5000;
+    spec.num_containers = 500;
+    spec.num_namespaces = 500;
+    spec.fds_per_pid = 0;
+    spec.sockets_per_pid = 0;
+    return FakeProcDir::Create(spec);
+  }();
+  return dir.get();
+}
+
+std::vector<std::string> ListPidDirs(const std::string& proc_path) {
+  std::vector<std::string> pids;
+  DirHandle procdir = opendir(proc_path.c_str());
+  while (auto curr = procdir.read()) {
+    if (std::isdigit(curr->d_name[0])) pids.push_back(curr->d_name);
+  }
+  return pids;
+}
+
+void BM_GetContainerID(benchmark::State& state, bool use_cache) {
+  const auto* dir = GetContainerProcDir();
+  if (!dir) {
+    state.SkipWithError("could not create fake /proc");
+    return;
+  }
+
+  FDHandle procfd = open(dir->path().c_str(), O_RDONLY | O_DIRECTORY);
+  auto pids = ListPidDirs(dir->path());
+  ContainerIDCache cache;
+
+  const auto& stats = CollectorStats::GetOrCreate();
+  int64_t hits = stats.GetCounter(CollectorStats::container_id_cache_hits);
+  int64_t misses = stats.GetCounter(CollectorStats::container_id_cache_misses);
+
+  size_t num_in_container = 0;
+  std::string container_id;
+  for (auto _ : state) {
+    num_in_container = 0;
+    for (const auto& pid : pids) {
+      FDHandle dirfd = openat(procfd, pid.c_str(), O_RDONLY);
+      if (GetContainerID(dirfd, use_cache ? &cache : nullptr, &container_id)) {
+        num_in_container++;
+      }
+    }
+    if (use_cache) cache.Sweep();
+  }
+
+  if (num_in_container != static_cast<size_t>(dir->spec().num_pids)) {
+    state.SkipWithError("unexpected number of container processes");
+    return;
+  }
+
+  hits = stats.GetCounter(CollectorStats::container_id_cache_hits) - hits;
+  misses = stats.GetCounter(CollectorStats::container_id_cache_misses) - misses;
+  if (hits + misses > 0) {
+    state.counters["hit_rate"] = static_cast<double>(hits) / (hits + misses);
+  }
+  state.counters["pids_per_sec"] = benchmark::Counter(state.iterations() * pids.size(), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_CAPTURE(BM_GetContainerID, no_cache, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_GetContainerID, cache, true)->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+}  // namespace collector
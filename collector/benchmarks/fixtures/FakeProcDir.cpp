@@ -0,0 +1,280 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include "FakeProcDir.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Logging.h"
+#include "Utility.h"
+
+namespace collector {
+
+namespace {
+
+constexpr char kNetTcpHeader[] =
+    "  sl  local_address                         remote_address                        st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n";
+
+// Inode of the first socket, and of the first network namespace.
+constexpr uint64_t kFirstSocketInode = 100000;
+constexpr uint64_t kFirstNetNSInode = 4026532000;
+
+// First pid of the generated processes.
+constexpr int kFirstPid = 1000;
+
+int RemoveEntry(const char* path, const struct stat* sb, int typeflag, struct FTW* ftwbuf) {
+  return remove(path);
+}
+
+bool RemoveTree(const std::string& path) {
+  return nftw(path.c_str(), RemoveEntry, 64, FTW_DEPTH | FTW_PHYS) == 0;
+}
+
+bool MakeDir(const std::string& path) {
+  if (mkdir(path.c_str(), 0755) == 0) return true;
+  CLOG(ERROR) << "Could not create directory " << path << ": " << StrError();
+  return false;
+}
+
+bool MakeSymlink(const std::string& target, const std::string& path) {
+  if (symlink(target.c_str(), path.c_str()) == 0) return true;
+  CLOG(ERROR) << "Could not create symlink " << path << ": " << StrError();
+  return false;
+}
+
+bool WriteFile(const std::string& path, const std::string& contents) {
+  std::ofstream out(path, std::ios::binary);
+  out << contents;
+  out.close();
+  if (out) return true;
+  CLOG(ERROR) << "Could not write " << path;
+  return false;
+}
+
+// FormatIPv4 formats an IPv4 address (given in host byte order) as listed in `net/tcp`, where the kernel prints the
+// address in network byte order as a native-endian 32-bit integer.
+std::string FormatIPv4(uint32_t addr) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%08X", htonl(addr));
+  return buf;
+}
+
+// FormatIPv6 formats the IPv6 address fd00::<hi>:<lo> as listed in `net/tcp6`, i.e., as four native-endian 32-bit
+// integers.
+std::string FormatIPv6(uint32_t hi, uint32_t lo) {
+  const uint32_t words[4] = {0xfd000000, 0, hi, lo};
+  std::string formatted;
+  for (uint32_t word : words) {
+    formatted += FormatIPv4(word);
+  }
+  return formatted;
+}
+
+void AppendSocketLine(std::string* lines, int index, const std::string& local, uint16_t local_port,
+                      const std::string& remote, uint16_t remote_port, bool listen, uint64_t inode) {
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%4d: %s:%04X %s:%04X %02X 00000000:00000000 00:00000000 00000000     0        0 %lu 1 0000000000000000 100 0 0 10 0\n",
+           index, local.c_str(), local_port, remote.c_str(), remote_port, listen ? 0x0A : 0x01,
+           static_cast<unsigned long>(inode));
+  *lines += buf;
+}
+
+std::string RandomContainerID(std::mt19937* rng) {
+  static const char kHexDigits[] = "0123456789abcdef";
+  std::uniform_int_distribution<int> dist(0, 15);
+  std::string id(64, '0');
+  for (auto& c : id) {
+    c = kHexDigits[dist(*rng)];
+  }
+  return id;
+}
+
+// CgroupV1File returns the contents of a `cgroup` file of a process in the given cgroup on all v1 hierarchies.
+std::string CgroupV1File(const std::string& path) {
+  static const char* const kHierarchies[] = {
+      "12:pids", "11:hugetlb", "10:net_cls,net_prio", "9:perf_event", "8:cpuset", "7:memory", "6:freezer",
+      "5:blkio", "4:devices", "3:cpu,cpuacct", "2:rdma", "1:name=systemd"};
+
+  std::string contents;
+  for (const char* hierarchy : kHierarchies) {
+    contents += std::string(hierarchy) + ":" + path + "\n";
+  }
+  return contents + "0::/system.slice/containerd.service\n";
+}
+
+// NetNS holds the generated processes and sockets of a network namespace.
+struct NetNS {
+  uint64_t inode;
+  std::string cgroup;
+  std::vector<int> pids;
+  std::string tcp_lines;
+  std::string tcp6_lines;
+  int num_tcp = 0;
+  int num_tcp6 = 0;
+};
+
+}  // namespace
+
+std::unique_ptr<FakeProcDir> FakeProcDir::Create(const FakeProcSpec& spec, const std::string& base_dir) {
+  std::string tmpl = base_dir + "/fakeproc.XXXXXX";
+  std::vector<char> path(tmpl.begin(), tmpl.end());
+  path.push_back('\0');
+  if (!mkdtemp(path.data())) {
+    CLOG(ERROR) << "Could not create temporary directory in " << base_dir << ": " << StrError();
+    return nullptr;
+  }
+
+  std::unique_ptr<FakeProcDir> dir(new FakeProcDir(path.data(), spec));
+  if (!dir->Populate()) {
+    return nullptr;
+  }
+  return dir;
+}
+
+FakeProcDir::~FakeProcDir() {
+  if (!RemoveTree(path_)) {
+    CLOG(WARNING) << "Could not remove " << path_ << ": " << StrError();
+  }
+}
+
+bool FakeProcDir::Populate() {
+  std::mt19937 rng(spec_.seed);
+  std::uniform_int_distribution<int> percent(0, 99);
+
+  int num_containers = std::max(spec_.num_containers, 1);
+  int num_container_ns = std::max(spec_.num_namespaces, num_containers);
+  int sockets_per_pid = std::min(spec_.sockets_per_pid, spec_.fds_per_pid);
+
+  // Namespace i belongs to container i % num_containers; the last namespace is the host network namespace.
+  std::vector<std::string> container_cgroups;
+  for (int i = 0; i < num_containers; i++) {
+    // Alternate between cgroup v1 (one line per hierarchy) and v2 (systemd driver) layouts.
+    auto id = RandomContainerID(&rng);
+    container_cgroups.push_back(i % 2 == 0 ? CgroupV1File("/docker/" + id) : "0::/system.slice/docker-" + id + ".scope\n");
+  }
+
+  std::vector<NetNS> netns(num_container_ns + 1);
+  for (int i = 0; i < num_container_ns; i++) {
+    netns[i].inode = kFirstNetNSInode + i;
+    netns[i].cgroup = container_cgroups[i % num_containers];
+  }
+  netns[num_container_ns].inode = kFirstNetNSInode + num_container_ns;
+  netns[num_container_ns].cgroup = "0::/init.scope\n";
+
+  int pid = kFirstPid;
+  for (int i = 0; i < spec_.num_pids; i++) {
+    netns[i % num_container_ns].pids.push_back(pid++);
+  }
+  for (int i = 0; i < spec_.num_host_pids; i++) {
+    netns[num_container_ns].pids.push_back(pid++);
+  }
+
+  uint64_t next_inode = kFirstSocketInode;
+  uint32_t next_remote = 0;
+  for (size_t ns_index = 0; ns_index < netns.size(); ns_index++) {
+    auto& ns = netns[ns_index];
+    if (ns.pids.empty()) continue;
+    bool is_container = ns_index < static_cast<size_t>(num_container_ns);
+    // 10.<ns>.0.1 resp. fd00::<ns>:1 is the address of the namespace.
+    uint32_t local_ipv4 = (10u << 24) | ((ns_index & 0xffff) << 8) | 1;
+
+    for (size_t pid_index = 0; pid_index < ns.pids.size(); pid_index++) {
+      std::string pid_dir = path_ + "/" + std::to_string(ns.pids[pid_index]);
+      if (!MakeDir(pid_dir) || !MakeDir(pid_dir + "/fd") || !MakeDir(pid_dir + "/ns") || !MakeDir(pid_dir + "/net")) {
+        return false;
+      }
+
+      char stat[128];
+      snprintf(stat, sizeof(stat), "%d (proc %d) S 1 %d %d 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 1 0 %d 0 0\n",
+               ns.pids[pid_index], ns.pids[pid_index], ns.pids[pid_index], ns.pids[pid_index], 1000 + ns.pids[pid_index]);
+      if (!WriteFile(pid_dir + "/stat", stat) || !WriteFile(pid_dir + "/cgroup", ns.cgroup) ||
+          !MakeSymlink("net:[" + std::to_string(ns.inode) + "]", pid_dir + "/ns/net")) {
+        return false;
+      }
+
+      for (int fd = 0; fd < spec_.fds_per_pid; fd++) {
+        std::string fd_path = pid_dir + "/fd/" + std::to_string(fd);
+        if (fd >= sockets_per_pid) {
+          if (!MakeSymlink("/dev/null", fd_path)) return false;
+          continue;
+        }
+
+        uint64_t inode = next_inode++;
+        if (!MakeSymlink("socket:[" + std::to_string(inode) + "]", fd_path)) return false;
+
+        bool listen = percent(rng) < spec_.listen_percent;
+        bool ipv6 = percent(rng) < spec_.ipv6_percent;
+        uint16_t local_port = listen ? 1024 + (inode % 8192) : 32768 + (inode % 28232);
+        uint32_t remote = ++next_remote;
+        if (ipv6) {
+          AppendSocketLine(&ns.tcp6_lines, ns.num_tcp6++, FormatIPv6(ns_index, 1), local_port,
+                           listen ? FormatIPv6(0, 0) : FormatIPv6(0xffff, remote), listen ? 0 : 443, listen, inode);
+        } else {
+          // Remote addresses of established connections are in 172.16.0.0/12.
+          AppendSocketLine(&ns.tcp_lines, ns.num_tcp++, FormatIPv4(local_ipv4), local_port,
+                           FormatIPv4(listen ? 0 : (0xac100000 | (remote & 0xfffff))), listen ? 0 : 443, listen, inode);
+        }
+
+        if (is_container) {
+          if (listen) {
+            num_listen_endpoints_++;
+          } else {
+            num_connections_++;
+          }
+        }
+      }
+    }
+
+    // Every process in the namespace sees the same `net/tcp[6]` contents.
+    std::string first_net_dir = path_ + "/" + std::to_string(ns.pids[0]) + "/net";
+    if (!WriteFile(first_net_dir + "/tcp", kNetTcpHeader + ns.tcp_lines) ||
+        !WriteFile(first_net_dir + "/tcp6", kNetTcpHeader + ns.tcp6_lines)) {
+      return false;
+    }
+    for (size_t pid_index = 1; pid_index < ns.pids.size(); pid_index++) {
+      std::string net_dir = path_ + "/" + std::to_string(ns.pids[pid_index]) + "/net";
+      for (const char* file : {"/tcp", "/tcp6"}) {
+        if (link((first_net_dir + file).c_str(), (net_dir + file).c_str()) != 0) {
+          CLOG(ERROR) << "Could not link " << net_dir << file << ": " << StrError();
+          return false;
+        }
+      }
+    }
+    std::string().swap(ns.tcp_lines);
+    std::string().swap(ns.tcp6_lines);
+  }
+
+  return true;
+}
+
+}  // namespace collector
@@ -0,0 +1,89 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#ifndef COLLECTOR_FAKEPROCDIR_H
+#define COLLECTOR_FAKEPROCDIR_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace collector {
+
+// FakeProcSpec describes the shape of a synthetic `/proc` tree.
+struct FakeProcSpec {
+  // Number of processes running in containers.
+  int num_pids = 1000;
+  // Number of processes not running in a container. Their sockets are not reported by the scraper.
+  int num_host_pids = 0;
+  // Number of containers. Container processes are distributed evenly across containers.
+  int num_containers = 50;
+  // Number of network namespaces of containers (at least num_containers). Namespace i belongs to container
+  // i % num_containers, and the processes of a container are distributed evenly across its namespaces.
+  int num_namespaces = 50;
+  // Number of open file descriptors per process, of which sockets_per_pid refer to sockets.
+  int fds_per_pid = 10;
+  int sockets_per_pid = 5;
+  // Percentage of sockets that are IPv6 (listed in `net/tcp6`).
+  int ipv6_percent = 50;
+  // Percentage of sockets in LISTEN state; all others are ESTABLISHED.
+  int listen_percent = 20;
+  // Seed for the random number generator, such that trees are reproducible.
+  uint32_t seed = 1;
+};
+
+// FakeProcDir is a synthetic `/proc` tree for benchmarking and testing the connection scraper. Each process directory
+// contains `cgroup`, `stat`, `ns/net`, `fd/*` and `net/tcp[6]` entries, as read by ConnScraper. The `net/tcp[6]` files
+// list the sockets of all processes in the network namespace; they are hard-linked between the processes of a
+// namespace to keep the generation fast. The tree is removed when the object is destroyed.
+class FakeProcDir {
+ public:
+  // Create generates a tree in a new temporary directory below base_dir. Returns nullptr on failure.
+  static std::unique_ptr<FakeProcDir> Create(const FakeProcSpec& spec, const std::string& base_dir = "/tmp");
+
+  ~FakeProcDir();
+
+  FakeProcDir(const FakeProcDir&) = delete;
+  FakeProcDir& operator=(const FakeProcDir&) = delete;
+
+  const std::string& path() const { return path_; }
+  const FakeProcSpec& spec() const { return spec_; }
+
+  // Number of connections and listen endpoints in containers, which a complete scrape should return.
+  size_t num_connections() const { return num_connections_; }
+  size_t num_listen_endpoints() const { return num_listen_endpoints_; }
+
+ private:
+  FakeProcDir(std::string path, const FakeProcSpec& spec) : path_(std::move(path)), spec_(spec) {}
+
+  bool Populate();
+
+  std::string path_;
+  FakeProcSpec spec_;
+  size_t num_connections_ = 0;
+  size_t num_listen_endpoints_ = 0;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_FAKEPROCDIR_H
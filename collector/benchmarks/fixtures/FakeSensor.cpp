@@ -0,0 +1,198 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#include "FakeSensor.h"
+
+#include <thread>
+
+#include <grpcpp/create_channel.h>
+#include <grpcpp/security/credentials.h>
+#include <grpcpp/security/server_credentials.h>
+#include <grpcpp/server_builder.h>
+
+#include "Logging.h"
+#include "Utility.h"
+
+namespace collector {
+
+namespace {
+
+bool IsValid(const sensor::NetworkConnectionInfoMessage& msg) {
+  if (!msg.has_info() || !msg.info().has_time()) {
+    return false;
+  }
+  for (const auto& conn : msg.info().updated_connections()) {
+    if (conn.container_id().empty() || !conn.has_local_address() || !conn.has_remote_address()) {
+      return false;
+    }
+  }
+  for (const auto& endpoint : msg.info().updated_endpoints()) {
+    if (endpoint.container_id().empty() || !endpoint.has_listen_address()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool IsValid(const sensor::SignalStreamMessage& msg) {
+  if (!msg.has_signal() || !msg.signal().has_process_signal()) {
+    return false;
+  }
+  const auto& signal = msg.signal().process_signal();
+  return !signal.id().empty() && !signal.name().empty() && signal.has_time();
+}
+
+}  // namespace
+
+class FakeSensor::NetworkService : public sensor::NetworkConnectionInfoService::Service {
+ public:
+  explicit NetworkService(FakeSensor* sensor) : sensor_(sensor) {}
+
+  grpc::Status PushNetworkConnectionInfo(
+      grpc::ServerContext* context,
+      grpc::ServerReaderWriter<sensor::NetworkFlowsControlMessage, sensor::NetworkConnectionInfoMessage>* stream) override {
+    sensor::NetworkConnectionInfoMessage msg;
+    while (stream->Read(&msg)) {
+      size_t entries = msg.info().updated_connections_size() + msg.info().updated_endpoints_size();
+      bool valid = !sensor_->options_.validate || IsValid(msg);
+      sensor_->OnMessage(&sensor_->network_stats_, msg.ByteSizeLong(), entries, valid);
+    }
+    return grpc::Status::OK;
+  }
+
+ private:
+  FakeSensor* sensor_;
+};
+
+class FakeSensor::SignalService : public sensor::SignalService::Service {
+ public:
+  explicit SignalService(FakeSensor* sensor) : sensor_(sensor) {}
+
+  grpc::Status PushSignals(grpc::ServerContext* context,
+                           grpc::ServerReaderWriter<v1::Empty, sensor::SignalStreamMessage>* stream) override {
+    sensor::SignalStreamMessage msg;
+    while (stream->Read(&msg)) {
+      bool valid = !sensor_->options_.validate || IsValid(msg);
+      sensor_->OnMessage(&sensor_->signal_stats_, msg.ByteSizeLong(), 1, valid);
+    }
+    return grpc::Status::OK;
+  }
+
+ private:
+  FakeSensor* sensor_;
+};
+
+FakeSensor::FakeSensor(const FakeSensorOptions& options)
+    : options_(options), network_service_(MakeUnique<NetworkService>(this)), signal_service_(MakeUnique<SignalService>(this)) {}
+
+FakeSensor::~FakeSensor() {
+  Resume();
+  if (server_) {
+    server_->Shutdown(std::chrono::system_clock::now() + std::chrono::seconds(1));
+    server_->Wait();
+  }
+}
+
+std::unique_ptr<FakeSensor> FakeSensor::Start(const std::string& address, const FakeSensorOptions& options) {
+  std::unique_ptr<FakeSensor> sensor(new FakeSensor(options));
+
+  int port = 0;
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort(address, grpc::InsecureServerCredentials(), &port);
+  builder.RegisterService(sensor->network_service_.get());
+  builder.RegisterService(sensor->signal_service_.get());
+  sensor->server_ = builder.BuildAndStart();
+  if (!sensor->server_ || port == 0) {
+    CLOG(ERROR) << "Failed to start fake sensor on " << address;
+    return nullptr;
+  }
+
+  sensor->address_ = address;
+  if (address.size() > 2 && address.compare(address.size() - 2, 2, ":0") == 0) {
+    sensor->address_ = address.substr(0, address.size() - 1) + std::to_string(port);
+  }
+  return sensor;
+}
+
+std::shared_ptr<grpc::Channel> FakeSensor::CreateChannel() const {
+  return grpc::CreateChannel(address_, grpc::InsecureChannelCredentials());
+}
+
+FakeSensorStats FakeSensor::network_stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return network_stats_;
+}
+
+FakeSensorStats FakeSensor::signal_stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return signal_stats_;
+}
+
+void FakeSensor::ResetStats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  network_stats_ = FakeSensorStats();
+  signal_stats_ = FakeSensorStats();
+}
+
+bool FakeSensor::WaitForNetworkEntries(uint64_t entries, std::chrono::milliseconds timeout) const {
+  return WaitFor(&network_stats_, entries, timeout);
+}
+
+bool FakeSensor::WaitForSignals(uint64_t signals, std::chrono::milliseconds timeout) const {
+  return WaitFor(&signal_stats_, signals, timeout);
+}
+
+bool FakeSensor::WaitFor(const FakeSensorStats* stats, uint64_t entries, std::chrono::milliseconds timeout) const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return cond_.wait_for(lock, timeout, [stats, entries] { return stats->entries >= entries; });
+}
+
+void FakeSensor::Pause() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  paused_ = true;
+}
+
+void FakeSensor::Resume() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  paused_ = false;
+  cond_.notify_all();
+}
+
+void FakeSensor::OnMessage(FakeSensorStats* stats, size_t bytes, size_t entries, bool valid) {
+  if (options_.latency.count() > 0) {
+    std::this_thread::sleep_for(options_.latency);
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock, [this] { return !paused_; });
+  stats->messages++;
+  stats->bytes += bytes;
+  stats->entries += entries;
+  if (!valid) {
+    stats->invalid++;
+  }
+  cond_.notify_all();
+}
+
+}  // namespace collector
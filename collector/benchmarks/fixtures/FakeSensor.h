@@ -0,0 +1,119 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#ifndef COLLECTOR_FAKESENSOR_H
+#define COLLECTOR_FAKESENSOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <grpcpp/channel.h>
+#include <grpcpp/server.h>
+
+#include "internalapi/sensor/network_connection_iservice.grpc.pb.h"
+#include "internalapi/sensor/signal_iservice.grpc.pb.h"
+
+namespace collector {
+
+// FakeSensorOptions configures how a FakeSensor handles the messages it receives.
+struct FakeSensorOptions {
+  // If set, received messages are checked for the fields that sensor relies on, and messages lacking them are counted
+  // as invalid.
+  bool validate = false;
+  // Time spent on each received message, to emulate a loaded sensor. As messages are read one at a time, this slows
+  // down the streams and eventually applies back-pressure to the clients via gRPC flow control.
+  std::chrono::microseconds latency{0};
+};
+
+// FakeSensorStats counts the messages received on one of the services of a FakeSensor.
+struct FakeSensorStats {
+  uint64_t messages = 0;
+  // Serialized size of the received messages.
+  uint64_t bytes = 0;
+  // Number of connection and endpoint updates, or signals, in the received messages.
+  uint64_t entries = 0;
+  uint64_t invalid = 0;
+};
+
+// FakeSensor is an in-process gRPC server that implements the network connection info and signal services of sensor,
+// for benchmarking and testing the clients end-to-end without a real sensor. It listens on a unix socket (address
+// "unix:<path>") or a TCP port (e.g., "localhost:0" for any free port), and counts the messages it receives.
+class FakeSensor {
+ public:
+  // Start starts a server listening on the given address. Returns nullptr on failure.
+  static std::unique_ptr<FakeSensor> Start(const std::string& address, const FakeSensorOptions& options = FakeSensorOptions());
+
+  ~FakeSensor();
+
+  FakeSensor(const FakeSensor&) = delete;
+  FakeSensor& operator=(const FakeSensor&) = delete;
+
+  // Address the server is listening on, with the actual port if any port was requested.
+  const std::string& address() const { return address_; }
+  std::shared_ptr<grpc::Channel> CreateChannel() const;
+
+  FakeSensorStats network_stats() const;
+  FakeSensorStats signal_stats() const;
+  void ResetStats();
+
+  // Waits until the given number of connection and endpoint updates, or signals, have been received in total. Returns
+  // false on timeout.
+  bool WaitForNetworkEntries(uint64_t entries, std::chrono::milliseconds timeout) const;
+  bool WaitForSignals(uint64_t signals, std::chrono::milliseconds timeout) const;
+
+  // While paused, no messages are read from the streams, such that clients are blocked by flow control once the stream
+  // buffers are full.
+  void Pause();
+  void Resume();
+
+ private:
+  class NetworkService;
+  class SignalService;
+
+  explicit FakeSensor(const FakeSensorOptions& options);
+
+  // Waits while paused, applies the configured latency, and counts the given message.
+  void OnMessage(FakeSensorStats* stats, size_t bytes, size_t entries, bool valid);
+  bool WaitFor(const FakeSensorStats* stats, uint64_t entries, std::chrono::milliseconds timeout) const;
+
+  FakeSensorOptions options_;
+  std::string address_;
+  std::unique_ptr<NetworkService> network_service_;
+  std::unique_ptr<SignalService> signal_service_;
+  std::unique_ptr<grpc::Server> server_;
+
+  mutable std::mutex mutex_;
+  mutable std::condition_variable cond_;
+  bool paused_ = false;
+  FakeSensorStats network_stats_;
+  FakeSensorStats signal_stats_;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_FAKESENSOR_H
@@ -0,0 +1,152 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+// clang-format off
+// sinsp.h needs to be included before chisel.h
+#include "libsinsp/sinsp.h"
+#include "chisel.h"
+#include "libsinsp/wrapper.h"
+// clang-format on
+
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ProcessSignalFormatter.h"
+#include "Utility.h"
+#include "benchmark/benchmark.h"
+
+// Heap allocations made while turning a known thread into a process signal, as done for every process when a
+// connection to sensor is established. Global operator new is replaced with a counting one, which is why these
+// benchmarks are built into their own binary.
+
+namespace {
+
+std::atomic<uint64_t> num_allocations(0);
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+namespace collector {
+
+namespace {
+
+// Reports the heap allocations per iteration made since the given count.
+void ReportAllocations(benchmark::State& state, uint64_t allocations_before) {
+  uint64_t allocations = num_allocations.load(std::memory_order_relaxed) - allocations_before;
+  state.counters["allocs_per_signal"] = benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+}
+
+std::vector<std::string> CompilerArgs() {
+  return {"-O2", "-Wall", "-I/usr/include", "-c", "src/collector/lib/ProcessSignalFormatter.cpp", "-o",
+          "build/collector/lib/ProcessSignalFormatter.o"};
+}
+
+// The argument formatting as done before JoinProcessArgs.
+std::string StreamProcessArgs(const std::vector<std::string>& args) {
+  if (args.empty()) return "";
+  std::ostringstream out;
+  for (auto it = args.begin(); it != args.end();) {
+    out << *it++;
+    if (it != args.end()) out << " ";
+  }
+  return out.str();
+}
+
+void BM_StreamProcessArgs(benchmark::State& state) {
+  auto args = CompilerArgs();
+  uint64_t allocations_before = num_allocations.load(std::memory_order_relaxed);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(StreamProcessArgs(args));
+  }
+  ReportAllocations(state, allocations_before);
+}
+
+void BM_JoinProcessArgs(benchmark::State& state) {
+  auto args = CompilerArgs();
+  std::string joined;
+  uint64_t allocations_before = num_allocations.load(std::memory_order_relaxed);
+  for (auto _ : state) {
+    JoinProcessArgs(args, &joined);
+    benchmark::DoNotOptimize(joined.data());
+  }
+  ReportAllocations(state, allocations_before);
+}
+
+// A compiler process in a container, started by make from a shell, with state.range(0) ancestors in total.
+void BM_ProcessSignalFromThreadinfo(benchmark::State& state) {
+  std::unique_ptr<sinsp> inspector(new_inspector());
+  ProcessSignalFormatter formatter(inspector.get());
+
+  const char* names[] = {"bash", "make", "sh"};
+  const char* paths[] = {"/usr/bin/bash", "/usr/bin/make", "/usr/bin/sh"};
+  int num_ancestors = state.range(0);
+  std::shared_ptr<sinsp_threadinfo> tinfo;
+  for (int i = 0; i <= num_ancestors; i++) {
+    tinfo = std::make_shared<sinsp_threadinfo>(inspector.get());
+    tinfo->m_pid = 1000 + i;
+    tinfo->m_tid = 1000 + i;
+    tinfo->m_ptid = i == 0 ? -1 : 1000 + i - 1;
+    tinfo->m_vpid = 1 + i;
+    tinfo->m_clone_ts = 1000000 + i;
+    tinfo->m_user.uid = 1000;
+    tinfo->m_container_id = "c2b0b3b4f1a6";
+    tinfo->m_comm = i == num_ancestors ? "cc1plus" : names[i % 3];
+    tinfo->m_exepath = i == num_ancestors ? "/usr/libexec/gcc/x86_64-linux-gnu/cc1plus" : paths[i % 3];
+    if (i == num_ancestors) tinfo->m_args = CompilerArgs();
+    inspector->add_thread(tinfo);
+  }
+
+  uint64_t allocations_before = num_allocations.load(std::memory_order_relaxed);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(formatter.ToProtoMessage(tinfo.get()));
+  }
+  state.SetItemsProcessed(state.iterations());
+  ReportAllocations(state, allocations_before);
+}
+
+BENCHMARK(BM_StreamProcessArgs);
+BENCHMARK(BM_JoinProcessArgs);
+BENCHMARK(BM_ProcessSignalFromThreadinfo)->Arg(1)->Arg(5)->Arg(20);
+
+}  // namespace
+
+}  // namespace collector
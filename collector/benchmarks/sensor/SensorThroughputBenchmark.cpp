@@ -0,0 +1,199 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+// End-to-end throughput of the network connection info and signal streams, through the real clients and DuplexGRPC,
+// against an in-process fake sensor.
+
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FakeSensor.h"
+#include "NetworkConnectionInfoEncoder.h"
+#include "NetworkConnectionInfoServiceComm.h"
+#include "ProtoUtil.h"
+#include "SignalServiceClient.h"
+#include "Utility.h"
+#include "benchmark/benchmark.h"
+
+namespace collector {
+
+namespace {
+
+// Number of messages sent per iteration, after which the benchmark waits for the sensor to have received them all.
+constexpr int kNetworkMessagesPerIteration = 20;
+constexpr int kSignalsPerIteration = 1000;
+constexpr auto kTimeout = std::chrono::seconds(30);
+
+std::unique_ptr<FakeSensor> StartFakeSensor(benchmark::State& state, int latency_micros) {
+  FakeSensorOptions options;
+  options.validate = true;
+  options.latency = std::chrono::microseconds(latency_micros);
+  auto sensor = FakeSensor::Start("unix:/tmp/collector-fake-sensor-" + std::to_string(getpid()) + ".sock", options);
+  if (!sensor) {
+    state.SkipWithError("Failed to start fake sensor");
+  }
+  return sensor;
+}
+
+void ReportStats(benchmark::State& state, const FakeSensorStats& stats) {
+  state.SetItemsProcessed(stats.entries);
+  state.SetBytesProcessed(stats.bytes);
+  state.counters["messages_per_second"] = benchmark::Counter(stats.messages, benchmark::Counter::kIsRate);
+  state.counters["invalid"] = stats.invalid;
+}
+
+std::vector<std::pair<Connection, ConnStatus>> MakeConnections(int num_conns) {
+  std::vector<std::pair<Connection, ConnStatus>> conns;
+  conns.reserve(num_conns);
+  for (int i = 0; i < num_conns; i++) {
+    Endpoint local(Address(10, 0, (i >> 8) & 0xff, i & 0xff), 1024 + i % 60000);
+    Endpoint remote(Address(192, 168, (i >> 16) & 0xff, (i >> 8) & 0xff), 443);
+    conns.emplace_back(Connection("0123456789ab", local, remote, L4Proto::TCP, false), ConnStatus(1600000000000000 + i, i % 4 != 0));
+  }
+  return conns;
+}
+
+// Sends messages with the given number of connections as the network status notifier does: encoded by
+// NetworkConnectionInfoEncoder, and written asynchronously with at most one write pending.
+void BM_NetworkConnectionInfoStream(benchmark::State& state) {
+  int entries_per_message = state.range(0);
+  auto sensor = StartFakeSensor(state, state.range(1));
+  if (!sensor) return;
+
+  NetworkConnectionInfoServiceComm comm("fake-node", sensor->CreateChannel());
+  comm.WaitForConnectionReady([] { return false; });
+  auto writer = comm.PushNetworkConnectionInfoOpenStream([](const sensor::NetworkFlowsControlMessage*) {});
+  if (!writer->WaitUntilStarted(kTimeout)) {
+    state.SkipWithError("Failed to establish network connection info stream");
+    return;
+  }
+
+  auto conns = MakeConnections(entries_per_message);
+  NetworkConnectionInfoEncoder encoder;
+  uint64_t sent_entries = 0;
+
+  for (auto _ : state) {
+    for (int i = 0; i < kNetworkMessagesPerIteration; i++) {
+      encoder.Reset();
+      for (const auto& conn : conns) {
+        encoder.AddConnection(conn.first, conn.second);
+      }
+      grpc::ByteBuffer msg = encoder.Finish(CurrentTimeProto());
+      if (!writer->WaitUntilWritable(kTimeout) || !writer->WriteAsync(msg)) {
+        state.SkipWithError("Failed to write network connection info");
+        return;
+      }
+      sent_entries += conns.size();
+    }
+    if (!sensor->WaitForNetworkEntries(sent_entries, kTimeout)) {
+      state.SkipWithError("Fake sensor did not receive all messages");
+      return;
+    }
+  }
+
+  ReportStats(state, sensor->network_stats());
+  // WritesDone must not be issued while the last write is pending.
+  writer->WaitUntilWritable(kTimeout);
+  writer->WritesDone(kTimeout);
+  writer->Finish(kTimeout);
+}
+
+sensor::SignalStreamMessage MakeSignal(int i) {
+  sensor::SignalStreamMessage msg;
+  auto* signal = msg.mutable_signal()->mutable_process_signal();
+  signal->set_id(UUIDStr());
+  signal->set_container_id("0123456789ab");
+  *signal->mutable_time() = CurrentTimeProto();
+  signal->set_name("curl");
+  signal->set_exec_file_path("/usr/bin/curl");
+  signal->set_args("-s -o /dev/null https://example.com/" + std::to_string(i));
+  signal->set_pid(1000 + i);
+  for (int j = 0; j < 3; j++) {
+    auto* lineage = signal->add_lineage_info();
+    lineage->set_parent_uid(0);
+    lineage->set_parent_exec_file_path("/bin/sh");
+  }
+  return msg;
+}
+
+// Pushes process signals through SignalServiceClient, which queues them and writes them from its stream thread. The
+// queue is large enough for all signals of an iteration, such that none are dropped.
+void BM_SignalStream(benchmark::State& state) {
+  auto sensor = StartFakeSensor(state, state.range(0));
+  if (!sensor) return;
+
+  std::vector<sensor::SignalStreamMessage> signals;
+  for (int i = 0; i < kSignalsPerIteration; i++) {
+    signals.push_back(MakeSignal(i));
+  }
+
+  SignalServiceClient client(sensor->CreateChannel());
+  client.Start();
+  // The first push after the stream has been established only requests a refresh of existing processes.
+  auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (client.PushSignals(signals[0]) != SignalHandler::NEEDS_REFRESH) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      state.SkipWithError("Failed to establish signal stream");
+      client.Stop();
+      return;
+    }
+    usleep(10000);
+  }
+
+  uint64_t sent_signals = 0;
+  for (auto _ : state) {
+    for (const auto& signal : signals) {
+      if (client.PushSignals(signal) != SignalHandler::PROCESSED) {
+        state.SkipWithError("Failed to push signal");
+        client.Stop();
+        return;
+      }
+    }
+    sent_signals += signals.size();
+    if (!sensor->WaitForSignals(sent_signals, kTimeout)) {
+      state.SkipWithError("Fake sensor did not receive all signals");
+      client.Stop();
+      return;
+    }
+  }
+
+  ReportStats(state, sensor->signal_stats());
+  client.Stop();
+}
+
+BENCHMARK(BM_NetworkConnectionInfoStream)
+    ->ArgNames({"entries", "latency_us"})
+    ->Args({100, 0})
+    ->Args({1000, 0})
+    ->Args({10000, 0})
+    ->Args({1000, 1000})
+    ->UseRealTime();
+BENCHMARK(BM_SignalStream)->ArgNames({"latency_us"})->Arg(0)->Arg(100)->UseRealTime();
+
+}  // namespace
+
+}  // namespace collector
@@ -27,6 +27,7 @@ You should have received a copy of the GNU General Public License along with thi
 
 #include "CollectorArgs.h"
 #include "EnvVar.h"
+#include "GRPC.h"
 #include "HostHeuristics.h"
 #include "HostInfo.h"
 #include "Logging.h"
@@ -55,6 +56,82 @@ BoolEnvVar set_enable_core_dump("ENABLE_CORE_DUMP", false);
 // If true, add originator process information in NetworkEndpoint
 BoolEnvVar set_processes_listening_on_ports("ROX_PROCESSES_LISTENING_ON_PORT", CollectorConfig::kEnableProcessesListeningOnPorts);
 
+// If true, read the originator processes of listening endpoints from /proc instead of requesting them from Falco.
+BoolEnvVar processes_listening_on_ports_from_procfs("ROX_PROCESSES_LISTENING_ON_PORT_FROM_PROCFS", false);
+
+// If true, read connection information via netlink sock_diag instead of parsing net/tcp[6] in /proc.
+BoolEnvVar use_sock_diag("ROX_NETWORK_USE_SOCK_DIAG", false);
+
+// Number of threads used to walk /proc when scraping connections.
+IntEnvVar network_scrape_workers("ROX_NETWORK_SCRAPE_WORKERS", CollectorConfig::kNetworkScrapeWorkers);
+
+// If true, infer the sockets of the process with the most open files in each network namespace instead of reading its
+// fd directory.
+BoolEnvVar network_scrape_infer_socket_owners("ROX_NETWORK_SCRAPE_INFER_SOCKET_OWNERS", false);
+
+// Number of slices the connection scrape is spread across within each scrape interval. 1 disables slicing.
+IntEnvVar network_scrape_slices("ROX_NETWORK_SCRAPE_SLICES", CollectorConfig::kNetworkScrapeSlices);
+
+// Maximum CPU time spent scraping while a sliced scrape is in progress, in percent of a single CPU. 0 means unlimited.
+IntEnvVar network_scrape_cpu_budget("ROX_NETWORK_SCRAPE_CPU_BUDGET", CollectorConfig::kNetworkScrapeCPUBudget);
+
+// Maximum number of connections and endpoints per network connection info message. 0 means unlimited.
+IntEnvVar network_max_message_entries("ROX_NETWORK_MAX_MESSAGE_ENTRIES", CollectorConfig::kNetworkMaxMessageEntries);
+
+// Size in bytes at which a network connection info message is closed, and the remaining deltas are sent in further
+// messages. 0 means unlimited.
+IntEnvVar network_max_message_size("ROX_NETWORK_MAX_MESSAGE_SIZE", CollectorConfig::kNetworkMaxMessageSize);
+
+// Maximum number of connection and endpoint updates that may not have been sent when the stream to sensor fails, for
+// only the changes to be sent after reconnecting. 0 means that the full state is always sent after reconnecting.
+IntEnvVar network_resync_buffer_entries("ROX_NETWORK_RESYNC_BUFFER_ENTRIES", CollectorConfig::kNetworkResyncBufferEntries);
+
+// Flush network connection updates before the next scrape once this many updates from events are pending. 0 disables.
+IntEnvVar network_flush_pending_updates("ROX_NETWORK_FLUSH_PENDING_UPDATES", CollectorConfig::kNetworkFlushPendingUpdates);
+
+// Flush network connection updates before the next scrape once the first pending update from an event is older than
+// this (in milliseconds). 0 disables.
+IntEnvVar network_flush_max_age("ROX_NETWORK_FLUSH_MAX_AGE", CollectorConfig::kNetworkFlushMaxAge);
+
+// Minimum time between two flushes of network connection updates, in milliseconds.
+IntEnvVar network_flush_min_interval("ROX_NETWORK_FLUSH_MIN_INTERVAL", CollectorConfig::kNetworkFlushMinInterval);
+
+// If set, periodically checkpoint the network state to this file and restore it on startup.
+StringEnvVar network_state_checkpoint_path("ROX_NETWORK_STATE_CHECKPOINT_PATH");
+
+// Interval between two network state checkpoints, in seconds.
+IntEnvVar network_state_checkpoint_interval("ROX_NETWORK_STATE_CHECKPOINT_INTERVAL", CollectorConfig::kNetworkStateCheckpointInterval);
+
+// Network state checkpoints older than this (in seconds) are discarded on startup.
+IntEnvVar network_state_checkpoint_max_age("ROX_NETWORK_STATE_CHECKPOINT_MAX_AGE", CollectorConfig::kNetworkStateCheckpointMaxAge);
+
+// Compression of the messages sent on the gRPC streams to sensor: none, deflate or gzip.
+StringEnvVar grpc_compression("ROX_GRPC_COMPRESSION");
+
+// If set, overrides ROX_GRPC_COMPRESSION for the network connection info stream and the signal stream, respectively.
+StringEnvVar network_grpc_compression("ROX_NETWORK_GRPC_COMPRESSION");
+StringEnvVar signal_grpc_compression("ROX_SIGNAL_GRPC_COMPRESSION");
+
+// Maximum number of process signals waiting to be sent to sensor.
+IntEnvVar signal_queue_size("ROX_SIGNAL_QUEUE_SIZE", CollectorConfig::kSignalQueueSize);
+
+// Which process signal is dropped when the queue is full: drop-oldest or drop-newest.
+StringEnvVar signal_queue_overflow("ROX_SIGNAL_QUEUE_OVERFLOW");
+
+// Returns the compression algorithm with the given name, or the default if the name is empty.
+grpc_compression_algorithm CompressionAlgorithm(const std::string& name, grpc_compression_algorithm default_algorithm) {
+  if (name.empty()) {
+    return default_algorithm;
+  }
+  grpc_compression_algorithm algorithm;
+  if (!ParseCompressionAlgorithm(name, &algorithm)) {
+    CLOG(WARNING) << "Unknown gRPC compression algorithm '" << name << "'. Using "
+                  << CompressionAlgorithmName(default_algorithm) << ".";
+    return default_algorithm;
+  }
+  return algorithm;
+}
+
 }  // namespace
 
 constexpr bool CollectorConfig::kUseChiselCache;
@@ -66,6 +143,18 @@ constexpr char CollectorConfig::kChisel[];
 constexpr const char* CollectorConfig::kSyscalls[];
 constexpr bool CollectorConfig::kForceKernelModules;
 constexpr bool CollectorConfig::kEnableProcessesListeningOnPorts;
+constexpr int CollectorConfig::kNetworkScrapeWorkers;
+constexpr int CollectorConfig::kNetworkScrapeSlices;
+constexpr int CollectorConfig::kNetworkScrapeCPUBudget;
+constexpr int CollectorConfig::kNetworkMaxMessageEntries;
+constexpr int CollectorConfig::kNetworkMaxMessageSize;
+constexpr int CollectorConfig::kNetworkResyncBufferEntries;
+constexpr int CollectorConfig::kNetworkFlushPendingUpdates;
+constexpr int CollectorConfig::kNetworkFlushMaxAge;
+constexpr int CollectorConfig::kNetworkFlushMinInterval;
+constexpr int CollectorConfig::kNetworkStateCheckpointInterval;
+constexpr int CollectorConfig::kNetworkStateCheckpointMaxAge;
+constexpr int CollectorConfig::kSignalQueueSize;
 
 const UnorderedSet<L4ProtoPortPair> CollectorConfig::kIgnoredL4ProtoPortPairs = {{L4Proto::UDP, 9}};
 ;
@@ -198,6 +287,46 @@ CollectorConfig::CollectorConfig(CollectorArgs* args) {
     enable_core_dump_ = true;
   }
 
+  if (use_sock_diag) {
+    use_sock_diag_ = true;
+  }
+
+  if (network_scrape_infer_socket_owners) {
+    network_scrape_infer_socket_owners_ = true;
+  }
+
+  if (processes_listening_on_ports_from_procfs) {
+    processes_listening_on_ports_from_procfs_ = true;
+  }
+
+  network_scrape_workers_ = std::max(network_scrape_workers.value(), 1);
+  network_scrape_slices_ = std::max(network_scrape_slices.value(), 1);
+  network_scrape_cpu_budget_ = std::min(std::max(network_scrape_cpu_budget.value(), 0), 100);
+
+  network_max_message_entries_ = std::max(network_max_message_entries.value(), 0);
+  network_max_message_size_ = std::max(network_max_message_size.value(), 0);
+  network_resync_buffer_entries_ = std::max(network_resync_buffer_entries.value(), 0);
+
+  network_flush_pending_updates_ = std::max(network_flush_pending_updates.value(), 0);
+  network_flush_max_age_ = std::max(network_flush_max_age.value(), 0);
+  network_flush_min_interval_ = std::max(network_flush_min_interval.value(), 0);
+
+  network_state_checkpoint_path_ = network_state_checkpoint_path.value();
+  network_state_checkpoint_interval_ = network_state_checkpoint_interval.value();
+  network_state_checkpoint_max_age_ = network_state_checkpoint_max_age.value();
+
+  grpc_compression_algorithm default_compression = CompressionAlgorithm(grpc_compression.value(), GRPC_COMPRESS_NONE);
+  network_grpc_compression_ = CompressionAlgorithm(network_grpc_compression.value(), default_compression);
+  signal_grpc_compression_ = CompressionAlgorithm(signal_grpc_compression.value(), default_compression);
+
+  signal_queue_size_ = std::max(signal_queue_size.value(), 1);
+  const std::string& overflow = signal_queue_overflow.value();
+  if (overflow == "drop-newest") {
+    signal_queue_drop_newest_ = true;
+  } else if (!overflow.empty() && overflow != "drop-oldest") {
+    CLOG(WARNING) << "Unknown signal queue overflow policy '" << overflow << "'. Using drop-oldest.";
+  }
+
   HandleAfterglowEnvVars();
 
   host_config_ = ProcessHostHeuristics(*this);
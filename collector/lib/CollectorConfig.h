@@ -29,6 +29,7 @@ You should have received a copy of the GNU General Public License along with thi
 
 #include <json/json.h>
 
+#include <grpc/compression.h>
 #include <grpcpp/channel.h>
 
 #include "HostConfig.h"
@@ -81,6 +82,18 @@ end
   static const UnorderedSet<L4ProtoPortPair> kIgnoredL4ProtoPortPairs;
   static constexpr bool kForceKernelModules = false;
   static constexpr bool kEnableProcessesListeningOnPorts = false;
+  static constexpr int kNetworkScrapeWorkers = 4;
+  static constexpr int kNetworkScrapeSlices = 1;
+  static constexpr int kNetworkScrapeCPUBudget = 0;
+  static constexpr int kNetworkMaxMessageEntries = 20000;
+  static constexpr int kNetworkMaxMessageSize = 2 * 1024 * 1024;
+  static constexpr int kNetworkResyncBufferEntries = 0;
+  static constexpr int kNetworkFlushPendingUpdates = 0;
+  static constexpr int kNetworkFlushMaxAge = 0;
+  static constexpr int kNetworkFlushMinInterval = 1000;
+  static constexpr int kNetworkStateCheckpointInterval = 60;
+  static constexpr int kNetworkStateCheckpointMaxAge = 300;
+  static constexpr int kSignalQueueSize = 4096;
 
   CollectorConfig() = delete;
   CollectorConfig(CollectorArgs* collectorArgs);
@@ -110,6 +123,25 @@ end
   bool IsCoreDumpEnabled() const;
   Json::Value TLSConfiguration() const { return tls_config_; }
   bool IsProcessesListeningOnPortsEnabled() const { return enable_processes_listening_on_ports_; }
+  bool ProcessesListeningOnPortsFromProcfs() const { return processes_listening_on_ports_from_procfs_; }
+  bool UseSockDiag() const { return use_sock_diag_; }
+  int NetworkScrapeWorkers() const { return network_scrape_workers_; }
+  bool NetworkScrapeInferSocketOwners() const { return network_scrape_infer_socket_owners_; }
+  int NetworkScrapeSlices() const { return network_scrape_slices_; }
+  int NetworkScrapeCPUBudget() const { return network_scrape_cpu_budget_; }
+  int NetworkMaxMessageEntries() const { return network_max_message_entries_; }
+  int NetworkMaxMessageSize() const { return network_max_message_size_; }
+  int NetworkResyncBufferEntries() const { return network_resync_buffer_entries_; }
+  int NetworkFlushPendingUpdates() const { return network_flush_pending_updates_; }
+  int NetworkFlushMaxAge() const { return network_flush_max_age_; }
+  int NetworkFlushMinInterval() const { return network_flush_min_interval_; }
+  const std::string& NetworkStateCheckpointPath() const { return network_state_checkpoint_path_; }
+  int NetworkStateCheckpointInterval() const { return network_state_checkpoint_interval_; }
+  int NetworkStateCheckpointMaxAge() const { return network_state_checkpoint_max_age_; }
+  grpc_compression_algorithm NetworkGRPCCompression() const { return network_grpc_compression_; }
+  grpc_compression_algorithm SignalGRPCCompression() const { return signal_grpc_compression_; }
+  int SignalQueueSize() const { return signal_queue_size_; }
+  bool SignalQueueDropNewest() const { return signal_queue_drop_newest_; }
 
   std::shared_ptr<grpc::Channel> grpc_channel;
 
@@ -135,6 +167,25 @@ end
   bool enable_afterglow_ = true;
   bool enable_core_dump_ = false;
   bool enable_processes_listening_on_ports_;
+  bool processes_listening_on_ports_from_procfs_ = false;
+  bool use_sock_diag_ = false;
+  int network_scrape_workers_ = kNetworkScrapeWorkers;
+  bool network_scrape_infer_socket_owners_ = false;
+  int network_scrape_slices_ = kNetworkScrapeSlices;
+  int network_scrape_cpu_budget_ = kNetworkScrapeCPUBudget;
+  int network_max_message_entries_ = kNetworkMaxMessageEntries;
+  int network_max_message_size_ = kNetworkMaxMessageSize;
+  int network_resync_buffer_entries_ = kNetworkResyncBufferEntries;
+  int network_flush_pending_updates_ = kNetworkFlushPendingUpdates;
+  int network_flush_max_age_ = kNetworkFlushMaxAge;
+  int network_flush_min_interval_ = kNetworkFlushMinInterval;
+  std::string network_state_checkpoint_path_;
+  int network_state_checkpoint_interval_ = kNetworkStateCheckpointInterval;
+  int network_state_checkpoint_max_age_ = kNetworkStateCheckpointMaxAge;
+  grpc_compression_algorithm network_grpc_compression_ = GRPC_COMPRESS_NONE;
+  grpc_compression_algorithm signal_grpc_compression_ = GRPC_COMPRESS_NONE;
+  int signal_queue_size_ = kSignalQueueSize;
+  bool signal_queue_drop_newest_ = false;
 
   Json::Value tls_config_;
 };
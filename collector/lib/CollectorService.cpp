@@ -32,12 +32,15 @@ extern "C" {
 #include "CivetServer.h"
 #include "CollectorStatsExporter.h"
 #include "ConnTracker.h"
+#include "ContainerIDCache.h"
 #include "Containers.h"
 #include "GRPCUtil.h"
 #include "GetStatus.h"
 #include "LogLevel.h"
+#include "NetworkStateCheckpoint.h"
 #include "NetworkStatusNotifier.h"
 #include "ProfilerHandler.h"
+#include "ScrapeScheduler.h"
 #include "SysdigService.h"
 #include "Utility.h"
 #include "prometheus/exposer.h"
@@ -88,20 +91,55 @@ void CollectorService::RunForever() {
     CLOG(INFO) << "Sensor connectivity is successful";
 
     if (!config_.DisableNetworkFlows()) {
+      // The container ID cache is shared by all scrapers of the host's /proc.
+      auto container_id_cache = std::make_shared<ContainerIDCache>();
       std::shared_ptr<ProcessStore> process_store;
       if (config_.IsProcessesListeningOnPortsEnabled()) {
-        process_store = std::make_shared<ProcessStore>(&sysdig_);
+        std::shared_ptr<ProcessScraper> process_scraper;
+        if (config_.ProcessesListeningOnPortsFromProcfs()) {
+          process_scraper = std::make_shared<ProcessScraper>(config_.HostProc(), container_id_cache, config_.NetworkScrapeWorkers());
+        }
+        process_store = std::make_shared<ProcessStore>(&sysdig_, process_scraper);
       }
-      std::shared_ptr<IConnScraper> conn_scraper = std::make_shared<ConnScraper>(config_.HostProc(), process_store);
+      std::shared_ptr<ConnScraper> conn_scraper;
+      if (config_.UseSockDiag()) {
+        CLOG(INFO) << "Reading network connections via sock_diag";
+        conn_scraper = std::make_shared<NetlinkConnScraper>(config_.HostProc(), process_store, config_.NetworkScrapeWorkers());
+      } else {
+        conn_scraper = std::make_shared<ConnScraper>(config_.HostProc(), process_store, config_.NetworkScrapeWorkers());
+      }
+      conn_scraper->SetInferSocketOwners(config_.NetworkScrapeInferSocketOwners());
+      conn_scraper->SetContainerIDCache(container_id_cache);
       conn_tracker = std::make_shared<ConnectionTracker>();
       UnorderedSet<L4ProtoPortPair> ignored_l4proto_port_pairs(config_.IgnoredL4ProtoPortPairs());
       conn_tracker->UpdateIgnoredL4ProtoPortPairs(std::move(ignored_l4proto_port_pairs));
 
-      auto network_connection_info_service_comm = std::make_shared<NetworkConnectionInfoServiceComm>(config_.Hostname(), config_.grpc_channel);
+      auto network_connection_info_service_comm = std::make_shared<NetworkConnectionInfoServiceComm>(config_.Hostname(), config_.grpc_channel, config_.NetworkGRPCCompression());
+
+      NetworkStatusNotifierOptions notifier_options;
+      if (!config_.NetworkStateCheckpointPath().empty()) {
+        notifier_options.checkpoint = std::make_shared<NetworkStateCheckpoint>(config_.NetworkStateCheckpointPath(),
+                                                                               config_.NetworkStateCheckpointInterval() * 1000000LL,
+                                                                               config_.NetworkStateCheckpointMaxAge() * 1000000LL);
+      }
+
+      if (config_.NetworkScrapeSlices() > 1) {
+        notifier_options.scrape_scheduler = std::make_shared<ScrapeScheduler>(std::chrono::seconds(config_.ScrapeInterval()),
+                                                                              config_.NetworkScrapeSlices(), config_.NetworkScrapeCPUBudget());
+        CLOG(INFO) << "Network scrape split into " << config_.NetworkScrapeSlices() << " slices, starting after "
+                   << notifier_options.scrape_scheduler->start_offset().count() / 1000 << " ms";
+      }
+
+      notifier_options.max_message_entries = config_.NetworkMaxMessageEntries();
+      notifier_options.max_message_bytes = config_.NetworkMaxMessageSize();
+      notifier_options.resync_buffer_entries = config_.NetworkResyncBufferEntries();
+      notifier_options.flush_pending_updates = config_.NetworkFlushPendingUpdates();
+      notifier_options.flush_max_age = std::chrono::milliseconds(config_.NetworkFlushMaxAge());
+      notifier_options.flush_min_interval = std::chrono::milliseconds(config_.NetworkFlushMinInterval());
 
       net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper, config_.ScrapeInterval(), config_.ScrapeListenEndpoints(), config_.TurnOffScrape(),
                                                               conn_tracker, config_.AfterglowPeriod(), config_.EnableAfterglow(),
-                                                              network_connection_info_service_comm);
+                                                              network_connection_info_service_comm, notifier_options);
       net_status_notifier->Start();
     }
   }
@@ -7,29 +7,60 @@
 
 #include "TimeUtil.h"
 
-#define TIMER_NAMES     \
-  X(net_scrape_read)    \
-  X(net_scrape_update)  \
-  X(net_fetch_state)    \
-  X(net_create_message) \
-  X(net_write_message)
-
-#define COUNTER_NAMES             \
-  X(net_conn_updates)             \
-  X(net_conn_deltas)              \
-  X(net_conn_inactive)            \
-  X(net_cep_updates)              \
-  X(net_cep_deltas)               \
-  X(net_cep_inactive)             \
-  X(net_known_ip_networks)        \
-  X(net_known_public_ips)         \
-  X(process_lineage_counts)       \
-  X(process_lineage_total)        \
-  X(process_lineage_sqr_total)    \
-  X(process_lineage_string_total) \
-  X(process_info_hit)             \
-  X(process_info_miss)            \
-  X(rate_limit_flushing_counts)
+#define TIMER_NAMES         \
+  X(net_scrape_read)        \
+  X(net_scrape_proc_walk)   \
+  X(net_scrape_read_conns)  \
+  X(net_scrape_resolve)     \
+  X(net_scrape_update)      \
+  X(net_fetch_state)        \
+  X(net_create_message)     \
+  X(net_write_backpressure) \
+  X(net_write_message)      \
+  X(net_checkpoint_write)
+
+#define COUNTER_NAMES              \
+  X(net_conn_updates)              \
+  X(net_conn_deltas)               \
+  X(net_conn_inactive)             \
+  X(net_cep_updates)               \
+  X(net_cep_deltas)                \
+  X(net_cep_inactive)              \
+  X(net_known_ip_networks)         \
+  X(net_known_public_ips)          \
+  X(process_lineage_counts)        \
+  X(process_lineage_total)         \
+  X(process_lineage_sqr_total)     \
+  X(process_lineage_string_total)  \
+  X(process_lineage_cache_hits)    \
+  X(process_lineage_cache_misses)  \
+  X(process_lineage_cache_size)    \
+  X(process_info_hit)              \
+  X(process_info_miss)             \
+  X(process_info_procfs)           \
+  X(rate_limit_evictions)          \
+  X(net_scrape_pid_cache_hits)     \
+  X(net_scrape_pid_cache_misses)   \
+  X(net_scrape_pid_cache_size)     \
+  X(container_id_cache_hits)       \
+  X(container_id_cache_misses)     \
+  X(container_id_cache_size)       \
+  X(net_scrape_fds_resolved)       \
+  X(net_scrape_fds_skipped)        \
+  X(net_scrape_inferred_sockets)   \
+  X(net_scrape_netns_reads)        \
+  X(net_write_stalls)              \
+  X(net_message_chunks)            \
+  X(net_message_chunks_last_cycle) \
+  X(net_message_bytes)             \
+  X(proto_arena_hits)              \
+  X(proto_arena_misses)            \
+  X(proto_arena_grows)             \
+  X(proto_arena_shrinks)           \
+  X(net_resyncs)                   \
+  X(net_full_resyncs)              \
+  X(net_resync_unwritten_deltas)   \
+  X(net_early_flushes)
 
 namespace collector {
 
@@ -83,6 +83,7 @@ void CollectorStatsExporter::run() {
 
   auto& processSent = collectorEventCounters.Add({{"type", "processSent"}});
   auto& processSendFailures = collectorEventCounters.Add({{"type", "processSendFailures"}});
+  auto& processSendQueueDrops = collectorEventCounters.Add({{"type", "processSendQueueDrops"}});
   auto& processResolutionFailuresByEvt = collectorEventCounters.Add({{"type", "processResolutionFailuresByEvt"}});
   auto& processResolutionFailuresByTinfo = collectorEventCounters.Add({{"type", "processResolutionFailuresByTinfo"}});
   auto& processRateLimitCount = collectorEventCounters.Add({{"type", "processRateLimitCount"}});
@@ -226,6 +227,7 @@ void CollectorStatsExporter::run() {
     // process related metrics
     processSent.Set(stats.nProcessSent);
     processSendFailures.Set(stats.nProcessSendFailures);
+    processSendQueueDrops.Set(stats.nProcessSendQueueDrops);
     processResolutionFailuresByEvt.Set(stats.nProcessResolutionFailuresByEvt);
     processResolutionFailuresByTinfo.Set(stats.nProcessResolutionFailuresByTinfo);
     processRateLimitCount.Set(stats.nProcessRateLimitCount);
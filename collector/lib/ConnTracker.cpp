@@ -28,6 +28,7 @@ You should have received a copy of the GNU General Public License along with thi
 #include "CollectorStats.h"
 #include "Containers.h"
 #include "Logging.h"
+#include "TimeUtil.h"
 #include "Utility.h"
 
 namespace collector {
@@ -47,6 +48,9 @@ bool ContainsPrivateNetwork(Address::Family family, NRadixTree tree) {
 void ConnectionTracker::UpdateConnection(const Connection& conn, int64_t timestamp, bool added) {
   WITH_LOCK(mutex_) {
     EmplaceOrUpdateNoLock(conn, ConnStatus(timestamp, added));
+    if (pending_updates_.fetch_add(1, std::memory_order_relaxed) == 0) {
+      first_pending_update_micros_.store(NowMicros(), std::memory_order_relaxed);
+    }
   }
 }
 
@@ -75,6 +79,17 @@ void ConnectionTracker::Update(
   }
 }
 
+void ConnectionTracker::RestoreState(const ConnMap& conn_state, const ContainerEndpointMap& endpoint_state) {
+  WITH_LOCK(mutex_) {
+    for (const auto& conn : conn_state) {
+      EmplaceOrUpdateNoLock(conn.first, conn.second);
+    }
+    for (const auto& endpoint : endpoint_state) {
+      EmplaceOrUpdateNoLock(endpoint.first, endpoint.second);
+    }
+  }
+}
+
 IPNet ConnectionTracker::NormalizeAddressNoLock(const Address& address) const {
   if (address.IsNull()) {
     return {};
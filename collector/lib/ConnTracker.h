@@ -24,6 +24,7 @@ You should have received a copy of the GNU General Public License along with thi
 #ifndef COLLECTOR_CONNTRACKER_H
 #define COLLECTOR_CONNTRACKER_H
 
+#include <atomic>
 #include <mutex>
 #include <vector>
 
@@ -106,10 +107,24 @@ class ConnectionTracker {
 
   void Update(const std::vector<Connection>& all_conns, const std::vector<ContainerEndpoint>& all_listen_endpoints, int64_t timestamp);
 
+  // Returns the number of connection updates from events since the last call to ResetPendingUpdates, and stores the
+  // time of the first one (in microseconds since epoch) in *first_update_micros. Does not acquire the lock.
+  uint64_t PendingUpdates(int64_t* first_update_micros) const {
+    *first_update_micros = first_pending_update_micros_.load(std::memory_order_relaxed);
+    return pending_updates_.load(std::memory_order_relaxed);
+  }
+  void ResetPendingUpdates() {
+    pending_updates_.store(0, std::memory_order_relaxed);
+  }
+
   // Atomically fetch a snapshot of the current state, removing all inactive connections if requested.
   ConnMap FetchConnState(bool normalize = false, bool clear_inactive = true);
   ContainerEndpointMap FetchEndpointState(bool normalize = false, bool clear_inactive = true);
 
+  // Merges previously fetched (non-normalized) state back into the current state, keeping the most recent status for
+  // objects that are already known. Used to resume from a checkpoint written by an earlier collector instance.
+  void RestoreState(const ConnMap& conn_state, const ContainerEndpointMap& endpoint_state);
+
   template <typename T>
   static void UpdateOldState(UnorderedMap<T, ConnStatus>* old_state, const UnorderedMap<T, ConnStatus>& new_state, int64_t time_micros, int64_t afterglow_period_micros);
 
@@ -186,6 +201,9 @@ class ConnectionTracker {
   ConnMap conn_state_;
   ContainerEndpointMap endpoint_state_;
 
+  std::atomic<uint64_t> pending_updates_{0};
+  std::atomic<int64_t> first_pending_update_micros_{0};
+
   UnorderedSet<Address> known_public_ips_;
   NRadixTree known_ip_networks_;
   UnorderedMap<Address::Family, bool> known_private_networks_exists_;
@@ -0,0 +1,79 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include "ContainerIDCache.h"
+
+#include "CollectorStats.h"
+#include "Utility.h"
+
+namespace collector {
+
+bool ContainerIDCache::Lookup(const std::string& key, std::string* container_id) {
+  WITH_LOCK(mutex_) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+      COUNTER_INC(CollectorStats::container_id_cache_misses);
+      return false;
+    }
+    it->second.used = true;
+    *container_id = it->second.container_id;
+  }
+  COUNTER_INC(CollectorStats::container_id_cache_hits);
+  return true;
+}
+
+void ContainerIDCache::Insert(const std::string& key, StringView container_id) {
+  WITH_LOCK(mutex_) {
+    auto& entry = entries_[key];
+    entry.container_id = container_id.str();
+    entry.used = true;
+  }
+}
+
+void ContainerIDCache::MarkUsed(const std::string& key) {
+  WITH_LOCK(mutex_) {
+    auto it = entries_.find(key);
+    if (it != entries_.end()) it->second.used = true;
+  }
+}
+
+void ContainerIDCache::Sweep() {
+  WITH_LOCK(mutex_) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+      if (it->second.used) {
+        it->second.used = false;
+        ++it;
+      } else {
+        it = entries_.erase(it);
+      }
+    }
+    COUNTER_SET(CollectorStats::container_id_cache_size, entries_.size());
+  }
+}
+
+size_t ContainerIDCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+}  // namespace collector
@@ -0,0 +1,68 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#ifndef COLLECTOR_CONTAINERIDCACHE_H
+#define COLLECTOR_CONTAINERIDCACHE_H
+
+#include <mutex>
+#include <string>
+
+#include "Hash.h"
+#include "StringView.h"
+
+namespace collector {
+
+// ContainerIDCache maps the cgroup membership of processes to container IDs, such that the container ID of a process
+// in a known cgroup can be determined without parsing its cgroup file. The key is the cgroup path on the unified
+// hierarchy (cgroup v2), or the entire contents of the `/proc/<pid>/cgroup` file otherwise. An empty container ID
+// denotes processes which are not running in a container. It can be shared between scrapers and is safe for
+// concurrent use.
+class ContainerIDCache {
+ public:
+  // Lookup retrieves the container ID for the given key. Returns false if the key is not known.
+  bool Lookup(const std::string& key, std::string* container_id);
+
+  void Insert(const std::string& key, StringView container_id);
+
+  // MarkUsed keeps the entry for the given key, if any, from being removed by the next call of Sweep. It is meant for
+  // users which hold on to the results of previous lookups, and does not count as a lookup.
+  void MarkUsed(const std::string& key);
+
+  // Sweep removes all entries which have not been looked up, inserted or marked as used since the previous call.
+  void Sweep();
+
+  size_t size() const;
+
+ private:
+  struct Entry {
+    std::string container_id;
+    bool used;
+  };
+
+  mutable std::mutex mutex_;
+  UnorderedMap<std::string, Entry> entries_;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_CONTAINERIDCACHE_H
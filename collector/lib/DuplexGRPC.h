@@ -27,6 +27,7 @@ You should have received a copy of the GNU General Public License along with thi
 #include <chrono>
 #include <cstdint>
 
+#include <grpcpp/generic/generic_stub.h>
 #include <grpcpp/grpcpp.h>
 #include <grpcpp/support/async_stream.h>
 
@@ -52,6 +53,10 @@ You should have received a copy of the GNU General Public License along with thi
 //    no more reads will happen. Note that `read_callback` is executed synchronously during event processing.
 // 3. auto client = DuplexClient::CreateWithReadsIgnored(&MyService::Stub::MyAsyncMethod, channel, context);
 //    This is a convenience variant of (2) with a `read_callback` that does nothing.
+// 4. auto client = DuplexClient::CreateGenericWithReadCallback<R>("/my.Service/MyMethod", channel, context, read_callback).
+//    This is a variant of (2) which calls the method by name through a generic stub. The written messages are
+//    pre-serialized `grpc::ByteBuffer`s, while read messages are deserialized to `R` before being passed to
+//    `read_callback`.
 
 namespace collector {
 
@@ -314,6 +319,8 @@ class IDuplexClientWriter : public virtual IDuplexClient {
 
   virtual Result Write(const W& obj, const gpr_timespec& deadline) = 0;
   virtual Result WriteAsync(const W& obj) = 0;
+  virtual Result WriteAsync(const W& obj, const grpc::WriteOptions& options) = 0;
+  virtual Result WaitUntilWritable(const gpr_timespec& deadline) = 0;
 
   // Templated methods
 
@@ -322,6 +329,12 @@ class IDuplexClientWriter : public virtual IDuplexClient {
                const TS& time_spec = time_point::max()) {
     return Write(obj, ToDeadline(time_spec));
   }
+
+  // Wait for the specified time until no write is pending, i.e., until the next asynchronous write can be started.
+  template <typename TS = time_point>
+  Result WaitUntilWritable(const TS& time_spec = time_point::max()) {
+    return WaitUntilWritable(ToDeadline(time_spec));
+  }
 };
 
 // Base class for duplex clients.
@@ -471,6 +484,13 @@ class DuplexClient : public virtual IDuplexClient {
         new DuplexClientReaderWriter<W, R>(create_method, channel, context, std::move(read_callback)));
   }
 
+  template <typename R>
+  static std::unique_ptr<DuplexClientWriter<grpc::ByteBuffer>> CreateGenericWithReadCallback(
+      const std::string& method,
+      const std::shared_ptr<grpc::Channel>& channel,
+      grpc::ClientContext* context,
+      std::function<void(const R*)> read_callback);
+
   template <typename Stub, typename W, typename R>
   static std::unique_ptr<DuplexClientWriter<W>> CreateWithReadsIgnored(
       std::unique_ptr<grpc::ClientAsyncReaderWriter<W, R>> (Stub::*create_method)(
@@ -554,10 +574,26 @@ class DuplexClientWriter : public DuplexClient, public IDuplexClientWriter<W> {
     return Result(WriteAsyncInternal(obj));
   }
 
+  Result WriteAsync(const W& obj, const grpc::WriteOptions& options) {
+    return Result(WriteAsyncInternal(obj, options));
+  }
+
+  // Wait for the specified time until the pending write (if any) is done. Fails if the stream failed.
+  Result WaitUntilWritable(const gpr_timespec& deadline) {
+    if (!this->CheckFlags(Pending(Op::WRITE))) {
+      return Result(!this->CheckFlags(STREAM_ERROR));
+    }
+
+    auto res = this->Poll([](Flags fl) { return !(fl & Pending(Op::WRITE)) || (fl & STREAM_ERROR); }, deadline);
+    if (!res) return res;
+    return Result(!this->CheckFlags(STREAM_ERROR));
+  }
+
  protected:
   DuplexClientWriter(grpc::ClientContext* context) : DuplexClient(context) {}
 
   virtual OpDescriptor WriteAsyncInternal(const W& obj) = 0;
+  virtual OpDescriptor WriteAsyncInternal(const W& obj, const grpc::WriteOptions& options) = 0;
 };
 
 template <typename W, typename R>
@@ -613,6 +649,21 @@ class DuplexClientReaderWriter : public DuplexClientWriter<W> {
     ReadNext();
   }
 
+  DuplexClientReaderWriter(
+      const std::string& method,
+      const std::shared_ptr<grpc::Channel>& channel,
+      grpc::ClientContext* context,
+      std::function<void(const R*)>&& read_callback)
+      : DuplexClientWriter<W>(context), read_callback_(std::move(read_callback)) {
+    // `grpc::TemplatedGenericStub` is not available in the gRPC version collector is built with, hence the generic
+    // variant only reads and writes byte buffers.
+    grpc::GenericStub stub(channel);
+    rw_ = stub.PrepareCall(context, method, &this->cq_);
+    rw_->StartCall(OpToTag(Op::START));
+    this->SetFlags(Pending(Op::START));
+    ReadNext();
+  }
+
   // Perform the next read operation.
   void ReadNext() {
     read_buf_valid_ = false;
@@ -656,6 +707,10 @@ class DuplexClientReaderWriter : public DuplexClientWriter<W> {
     return DoAsync<const W&>(&RW::Write, obj, Op::WRITE);
   }
 
+  OpDescriptor WriteAsyncInternal(const W& obj, const grpc::WriteOptions& options) override {
+    return DoAsync<const W&, grpc::WriteOptions>(&RW::Write, obj, options, Op::WRITE);
+  }
+
   OpDescriptor WritesDoneAsyncInternal() override {
     return DoAsync<>(&RW::WritesDone, Op::WRITES_DONE);
   }
@@ -737,6 +792,29 @@ class DuplexClientReaderWriter : public DuplexClientWriter<W> {
   friend class DuplexClient;
 };
 
+template <typename R>
+std::unique_ptr<DuplexClientWriter<grpc::ByteBuffer>> DuplexClient::CreateGenericWithReadCallback(
+    const std::string& method,
+    const std::shared_ptr<grpc::Channel>& channel,
+    grpc::ClientContext* context,
+    std::function<void(const R*)> read_callback) {
+  // The generic stub only deals in byte buffers, hence read messages are deserialized here. Messages that fail to
+  // deserialize are dropped.
+  std::function<void(const grpc::ByteBuffer*)> read_buffer_callback = [read_callback](const grpc::ByteBuffer* buf) {
+    if (!buf) {
+      read_callback(nullptr);
+      return;
+    }
+    grpc::ByteBuffer buf_copy(*buf);  // Deserialize consumes the buffer, copying only takes references to slices.
+    R msg;
+    if (grpc::SerializationTraits<R>::Deserialize(&buf_copy, &msg).ok()) {
+      read_callback(&msg);
+    }
+  };
+  return std::unique_ptr<DuplexClientWriter<grpc::ByteBuffer>>(
+      new DuplexClientReaderWriter<grpc::ByteBuffer, grpc::ByteBuffer>(method, channel, context, std::move(read_buffer_callback)));
+}
+
 }  // namespace grpc_duplex_impl
 
 // Export public definitions.
@@ -7,6 +7,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <climits>
 #include <cstdlib>
 #include <mutex>
 #include <utility>
@@ -57,9 +58,30 @@ struct ParseBool {
   }
 };
 
+struct ParseInt {
+  bool operator()(int* out, const std::string& str_val) const {
+    char* endp;
+    long parsed = std::strtol(str_val.c_str(), &endp, 10);
+    if (*endp != '\0' || parsed < INT_MIN || parsed > INT_MAX) {
+      return false;
+    }
+    *out = static_cast<int>(parsed);
+    return true;
+  }
+};
+
+struct ParseString {
+  bool operator()(std::string* out, const std::string& str_val) const {
+    *out = str_val;
+    return true;
+  }
+};
+
 }  // namespace internal
 
 using BoolEnvVar = EnvVar<bool, internal::ParseBool>;
+using IntEnvVar = EnvVar<int, internal::ParseInt>;
+using StringEnvVar = EnvVar<std::string, internal::ParseString>;
 
 }  // namespace collector
 
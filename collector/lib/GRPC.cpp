@@ -23,6 +23,8 @@ You should have received a copy of the GNU General Public License along with thi
 
 #include "GRPC.h"
 
+#include <algorithm>
+#include <cctype>
 #include <fstream>
 #include <sstream>
 #include <string>
@@ -68,4 +70,33 @@ std::shared_ptr<grpc::Channel> CreateChannel(const std::string& server_address,
   return grpc::CreateCustomChannel(server_address, creds, chan_args);
 }
 
+bool ParseCompressionAlgorithm(std::string name, grpc_compression_algorithm* algorithm) {
+  std::transform(name.begin(), name.end(), name.begin(), [](char c) -> char {
+    return static_cast<char>(std::tolower(c));
+  });
+  if (name.empty() || name == "none") {
+    *algorithm = GRPC_COMPRESS_NONE;
+  } else if (name == "deflate") {
+    *algorithm = GRPC_COMPRESS_DEFLATE;
+  } else if (name == "gzip") {
+    *algorithm = GRPC_COMPRESS_GZIP;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* CompressionAlgorithmName(grpc_compression_algorithm algorithm) {
+  switch (algorithm) {
+    case GRPC_COMPRESS_NONE:
+      return "none";
+    case GRPC_COMPRESS_DEFLATE:
+      return "deflate";
+    case GRPC_COMPRESS_GZIP:
+      return "gzip";
+    default:
+      return "unknown";
+  }
+}
+
 }  // namespace collector
@@ -24,6 +24,9 @@ You should have received a copy of the GNU General Public License along with thi
 #ifndef COLLECTOR_GRPC_H
 #define COLLECTOR_GRPC_H
 
+#include <string>
+
+#include <grpc/compression.h>
 #include <grpcpp/channel.h>
 #include <grpcpp/security/credentials.h>
 
@@ -34,6 +37,13 @@ std::shared_ptr<grpc::ChannelCredentials> TLSCredentialsFromFiles(
 
 std::shared_ptr<grpc::Channel> CreateChannel(const std::string& server_address, const std::string& hostname_override, const std::shared_ptr<grpc::ChannelCredentials>& creds);
 
+// Parses the name of a message compression algorithm ("none", "deflate" or "gzip", case-insensitive). An empty name
+// means no compression. Returns false if the name is not known.
+bool ParseCompressionAlgorithm(std::string name, grpc_compression_algorithm* algorithm);
+
+// Returns the name of the given message compression algorithm.
+const char* CompressionAlgorithmName(grpc_compression_algorithm algorithm);
+
 }  // namespace collector
 
 #endif  // COLLECTOR_GRPC_H
@@ -0,0 +1,155 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include "HexDecode.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef __x86_64__
+#  include <immintrin.h>
+#endif
+
+namespace collector {
+
+namespace internal {
+
+namespace {
+
+// HexCharToVal returns the numeric value of a single (uppercase) hexadecimal digit, or -1 if c is not one.
+int HexCharToVal(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return 10 + (c - 'A');
+  return -1;
+}
+
+#ifdef __x86_64__
+
+// Decodes the hexadecimal digits in chars into bytes, storing them in the low 8 bytes of *out. Only the characters
+// selected by valid_mask (one bit per character, as returned by _mm_movemask_epi8) are validated.
+__attribute__((target("ssse3"))) bool DecodeHex16(__m128i chars, int valid_mask, __m128i* out) {
+  __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+  __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('F' + 1)));
+  if ((_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) & valid_mask) != valid_mask) return false;
+
+  // The value of a digit is its low nibble, plus 9 for 'A'-'F'.
+  __m128i nibbles = _mm_add_epi8(_mm_and_si128(chars, _mm_set1_epi8(0x0f)), _mm_and_si128(is_alpha, _mm_set1_epi8(9)));
+  // Combine pairs of nibbles into 16-bit values of 16 * high + low, then narrow them to bytes.
+  __m128i values = _mm_maddubs_epi16(nibbles, _mm_set1_epi16(0x0110));
+  *out = _mm_packus_epi16(values, values);
+  return true;
+}
+
+__attribute__((target("ssse3"))) __m128i ReverseWordBytes(__m128i bytes) {
+  return _mm_shuffle_epi8(bytes, _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+}
+
+#endif
+
+}  // namespace
+
+bool DecodeHexWordsScalar(const char* hex, int num_words, bool reverse_bytes, uint8_t* out) {
+  for (int i = 0; i < 4 * num_words; i++) {
+    int high = HexCharToVal(*hex++);
+    int low = HexCharToVal(*hex++);
+    if (high < 0 || low < 0) return false;
+    out[i] = high << 4 | low;
+  }
+
+  if (reverse_bytes) {
+    for (int i = 0; i < num_words; i++) {
+      std::reverse(out + 4 * i, out + 4 * (i + 1));
+    }
+  }
+  return true;
+}
+
+#ifdef __x86_64__
+
+__attribute__((target("ssse3"))) bool DecodeHexWordsSSSE3(const char* hex, int num_words, bool reverse_bytes, uint8_t* out) {
+  if (num_words == 1) {
+    __m128i bytes;
+    if (!DecodeHex16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(hex)), 0xff, &bytes)) return false;
+    if (reverse_bytes) bytes = ReverseWordBytes(bytes);
+    uint32_t word = _mm_cvtsi128_si32(bytes);
+    std::memcpy(out, &word, sizeof(word));
+    return true;
+  }
+
+  __m128i low, high;
+  if (!DecodeHex16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hex)), 0xffff, &low)) return false;
+  if (!DecodeHex16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hex + 16)), 0xffff, &high)) return false;
+  __m128i bytes = _mm_unpacklo_epi64(low, high);
+  if (reverse_bytes) bytes = ReverseWordBytes(bytes);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), bytes);
+  return true;
+}
+
+__attribute__((target("avx2"))) bool DecodeHexWordsAVX2(const char* hex, int num_words, bool reverse_bytes, uint8_t* out) {
+  if (num_words == 1) {
+    return DecodeHexWordsSSSE3(hex, num_words, reverse_bytes, out);
+  }
+
+  __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(hex));
+  __m256i is_digit = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chars));
+  __m256i is_alpha = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('F' + 1), chars));
+  if (_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha)) != -1) return false;
+
+  __m256i nibbles = _mm256_add_epi8(_mm256_and_si256(chars, _mm256_set1_epi8(0x0f)), _mm256_and_si256(is_alpha, _mm256_set1_epi8(9)));
+  __m256i values = _mm256_maddubs_epi16(nibbles, _mm256_set1_epi16(0x0110));
+  // Packing operates on each 128-bit lane separately, gather the low 8 bytes of both lanes.
+  __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(values, values), 0x08);
+  __m128i bytes = _mm256_castsi256_si128(packed);
+  if (reverse_bytes) bytes = ReverseWordBytes(bytes);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), bytes);
+  return true;
+}
+
+#endif
+
+}  // namespace internal
+
+namespace {
+
+using DecodeHexWordsFunc = bool (*)(const char*, int, bool, uint8_t*);
+
+DecodeHexWordsFunc SelectDecodeHexWords() {
+#ifdef __x86_64__
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return internal::DecodeHexWordsAVX2;
+  if (__builtin_cpu_supports("ssse3")) return internal::DecodeHexWordsSSSE3;
+#endif
+  return internal::DecodeHexWordsScalar;
+}
+
+}  // namespace
+
+bool DecodeHexWords(const char* hex, int num_words, bool reverse_bytes, uint8_t* out) {
+  static const DecodeHexWordsFunc impl = SelectDecodeHexWords();
+  if (num_words != 1 && num_words != 4) {
+    return internal::DecodeHexWordsScalar(hex, num_words, reverse_bytes, out);
+  }
+  return impl(hex, num_words, reverse_bytes, out);
+}
+
+}  // namespace collector
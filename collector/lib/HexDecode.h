@@ -0,0 +1,52 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#ifndef COLLECTOR_HEXDECODE_H
+#define COLLECTOR_HEXDECODE_H
+
+#include <cstdint>
+
+namespace collector {
+
+// DecodeHexWords decodes num_words 32-bit words, each represented by 8 uppercase hexadecimal digits, from hex into out
+// (which must have room for 4 * num_words bytes). If reverse_bytes is true, the order of the 4 bytes of each word is
+// reversed. Returns false if any of the characters is not an uppercase hexadecimal digit.
+//
+// Depending on the CPU, this uses AVX2 or SSSE3 instructions, falling back to a scalar implementation.
+bool DecodeHexWords(const char* hex, int num_words, bool reverse_bytes, uint8_t* out);
+
+namespace internal {
+
+// The individual implementations of DecodeHexWords, exposed for testing and benchmarking. The SIMD implementations must
+// only be called if the CPU supports the respective instruction set, and only support num_words values of 1 and 4.
+bool DecodeHexWordsScalar(const char* hex, int num_words, bool reverse_bytes, uint8_t* out);
+#ifdef __x86_64__
+bool DecodeHexWordsSSSE3(const char* hex, int num_words, bool reverse_bytes, uint8_t* out);
+bool DecodeHexWordsAVX2(const char* hex, int num_words, bool reverse_bytes, uint8_t* out);
+#endif
+
+}  // namespace internal
+
+}  // namespace collector
+
+#endif  // COLLECTOR_HEXDECODE_H
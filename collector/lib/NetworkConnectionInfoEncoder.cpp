@@ -0,0 +1,303 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include "NetworkConnectionInfoEncoder.h"
+
+#include <array>
+#include <cstring>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <grpc/slice.h>
+#include <grpcpp/support/slice.h>
+
+#include "internalapi/sensor/network_connection_iservice.pb.h"
+
+namespace collector {
+
+namespace {
+
+using google::protobuf::internal::WireFormatLite;
+using google::protobuf::io::CodedOutputStream;
+
+storage::L4Protocol TranslateL4Protocol(L4Proto proto) {
+  switch (proto) {
+    case L4Proto::TCP:
+      return storage::L4_PROTOCOL_TCP;
+    case L4Proto::UDP:
+      return storage::L4_PROTOCOL_UDP;
+    case L4Proto::ICMP:
+      return storage::L4_PROTOCOL_ICMP;
+    default:
+      return storage::L4_PROTOCOL_UNKNOWN;
+  }
+}
+
+sensor::SocketFamily TranslateAddressFamily(Address::Family family) {
+  switch (family) {
+    case Address::Family::IPV4:
+      return sensor::SOCKET_FAMILY_IPV4;
+    case Address::Family::IPV6:
+      return sensor::SOCKET_FAMILY_IPV6;
+    default:
+      return sensor::SOCKET_FAMILY_UNKNOWN;
+  }
+}
+
+// The helpers below come in pairs of a function returning the encoded size of a field (including the tag), and a
+// function writing the field to a target buffer with room for that size. As in proto3, scalar fields with default
+// values are omitted, whereas message fields are written whenever they are present.
+
+size_t TagSize(int field) {
+  return CodedOutputStream::VarintSize32(WireFormatLite::MakeTag(field, WireFormatLite::WIRETYPE_VARINT));
+}
+
+uint8_t* WriteTag(int field, WireFormatLite::WireType type, uint8_t* target) {
+  return CodedOutputStream::WriteTagToArray(WireFormatLite::MakeTag(field, type), target);
+}
+
+// Varint fields cover enums, as well as signed (non-zigzag) and unsigned integers. Negative values are sign-extended
+// to 64 bits, like the generated code does for int32 and enum fields.
+size_t VarintFieldSize(int field, int64_t value) {
+  return value ? TagSize(field) + CodedOutputStream::VarintSize64(static_cast<uint64_t>(value)) : 0;
+}
+
+uint8_t* WriteVarintField(int field, int64_t value, uint8_t* target) {
+  if (!value) return target;
+  target = WriteTag(field, WireFormatLite::WIRETYPE_VARINT, target);
+  return CodedOutputStream::WriteVarint64ToArray(static_cast<uint64_t>(value), target);
+}
+
+size_t MessageFieldSize(int field, size_t size) {
+  return TagSize(field) + CodedOutputStream::VarintSize32(static_cast<uint32_t>(size)) + size;
+}
+
+// Writes the tag and length of a message field, which must be followed by the encoded message of the given size.
+uint8_t* WriteMessageHeader(int field, size_t size, uint8_t* target) {
+  target = WriteTag(field, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, target);
+  return CodedOutputStream::WriteVarint32ToArray(static_cast<uint32_t>(size), target);
+}
+
+size_t BytesFieldSize(int field, size_t size) {
+  return size ? MessageFieldSize(field, size) : 0;
+}
+
+uint8_t* WriteBytesField(int field, const void* data, size_t size, uint8_t* target) {
+  if (!size) return target;
+  target = WriteMessageHeader(field, size, target);
+  std::memcpy(target, data, size);
+  return target + size;
+}
+
+// Timestamp holds the fields of a google.protobuf.Timestamp. Constructing the message object itself would take longer
+// than encoding the entire entry.
+struct Timestamp {
+  int64_t seconds;
+  int32_t nanos;
+};
+
+// Returns the timestamp for the given time in microseconds, normalized like TimeUtil::MicrosecondsToTimestamp.
+Timestamp MicrosecondsToTimestamp(int64_t micros) {
+  Timestamp ts = {micros / 1000000, static_cast<int32_t>(micros % 1000000) * 1000};
+  if (ts.nanos < 0) {
+    ts.seconds--;
+    ts.nanos += 1000000000;
+  }
+  return ts;
+}
+
+size_t TimestampSize(const Timestamp& ts) {
+  return VarintFieldSize(google::protobuf::Timestamp::kSecondsFieldNumber, ts.seconds) +
+         VarintFieldSize(google::protobuf::Timestamp::kNanosFieldNumber, ts.nanos);
+}
+
+size_t TimestampFieldSize(int field, const Timestamp& ts) {
+  return MessageFieldSize(field, TimestampSize(ts));
+}
+
+uint8_t* WriteTimestampField(int field, const Timestamp& ts, uint8_t* target) {
+  target = WriteMessageHeader(field, TimestampSize(ts), target);
+  target = WriteVarintField(google::protobuf::Timestamp::kSecondsFieldNumber, ts.seconds, target);
+  return WriteVarintField(google::protobuf::Timestamp::kNanosFieldNumber, ts.nanos, target);
+}
+
+// Note: the address data and network data are sent as separate fields for backward compatibility, although the
+// network field can handle both. Sensor tries to match the address to known cluster entities, and if that fails, it
+// tries to match the network to known external networks.
+
+size_t AddressSize(const Endpoint& endpoint) {
+  size_t addr_length = endpoint.address().length();
+  size_t size = VarintFieldSize(sensor::NetworkAddress::kPortFieldNumber, endpoint.port());
+  if (endpoint.network().IsAddress()) {
+    size += BytesFieldSize(sensor::NetworkAddress::kAddressDataFieldNumber, addr_length);
+  }
+  if (endpoint.network().bits() > 0) {
+    size += BytesFieldSize(sensor::NetworkAddress::kIpNetworkFieldNumber, addr_length + 1);
+  }
+  return size;
+}
+
+size_t AddressFieldSize(int field, const Endpoint& endpoint) {
+  if (endpoint.IsNull()) return 0;
+  return MessageFieldSize(field, AddressSize(endpoint));
+}
+
+uint8_t* WriteAddressField(int field, const Endpoint& endpoint, uint8_t* target) {
+  if (endpoint.IsNull()) return target;
+
+  target = WriteMessageHeader(field, AddressSize(endpoint), target);
+  size_t addr_length = endpoint.address().length();
+  if (endpoint.network().IsAddress()) {
+    target = WriteBytesField(sensor::NetworkAddress::kAddressDataFieldNumber, endpoint.address().data(), addr_length, target);
+  }
+  target = WriteVarintField(sensor::NetworkAddress::kPortFieldNumber, endpoint.port(), target);
+  if (endpoint.network().bits() > 0) {
+    std::array<uint8_t, Address::kMaxLen + 1> buff;
+    std::memcpy(buff.data(), endpoint.network().address().data(), addr_length);
+    buff[addr_length] = endpoint.network().bits();
+    target = WriteBytesField(sensor::NetworkAddress::kIpNetworkFieldNumber, buff.data(), addr_length + 1, target);
+  }
+  return target;
+}
+
+}  // namespace
+
+uint8_t* NetworkConnectionInfoEncoder::Append(size_t size) {
+  size_t offset = buffer_.size();
+  buffer_.resize(offset + size);
+  return buffer_.data() + offset;
+}
+
+size_t NetworkConnectionInfoEncoder::AddConnection(const Connection& conn, const ConnStatus& status) {
+  using Proto = sensor::NetworkConnection;
+
+  int64_t family = TranslateAddressFamily(conn.local().address().family());
+  int64_t protocol = TranslateL4Protocol(conn.l4proto());
+  int64_t role = conn.is_server() ? sensor::ROLE_SERVER : sensor::ROLE_CLIENT;
+  bool closed = !status.IsActive();
+  Timestamp close_timestamp = {0, 0};
+  if (closed) {
+    close_timestamp = MicrosecondsToTimestamp(status.LastActiveTime());
+  }
+
+  size_t size = VarintFieldSize(Proto::kSocketFamilyFieldNumber, family) +
+                AddressFieldSize(Proto::kLocalAddressFieldNumber, conn.local()) +
+                AddressFieldSize(Proto::kRemoteAddressFieldNumber, conn.remote()) +
+                VarintFieldSize(Proto::kProtocolFieldNumber, protocol) +
+                VarintFieldSize(Proto::kRoleFieldNumber, role) +
+                BytesFieldSize(Proto::kContainerIdFieldNumber, conn.container().size());
+  if (closed) {
+    size += TimestampFieldSize(Proto::kCloseTimestampFieldNumber, close_timestamp);
+  }
+
+  size_t entry_size = MessageFieldSize(sensor::NetworkConnectionInfo::kUpdatedConnectionsFieldNumber, size);
+  uint8_t* target = Append(entry_size);
+  target = WriteMessageHeader(sensor::NetworkConnectionInfo::kUpdatedConnectionsFieldNumber, size, target);
+  target = WriteVarintField(Proto::kSocketFamilyFieldNumber, family, target);
+  target = WriteAddressField(Proto::kLocalAddressFieldNumber, conn.local(), target);
+  target = WriteAddressField(Proto::kRemoteAddressFieldNumber, conn.remote(), target);
+  target = WriteVarintField(Proto::kProtocolFieldNumber, protocol, target);
+  target = WriteVarintField(Proto::kRoleFieldNumber, role, target);
+  target = WriteBytesField(Proto::kContainerIdFieldNumber, conn.container().data(), conn.container().size(), target);
+  if (closed) {
+    WriteTimestampField(Proto::kCloseTimestampFieldNumber, close_timestamp, target);
+  }
+
+  num_entries_++;
+  return entry_size;
+}
+
+size_t NetworkConnectionInfoEncoder::AddContainerEndpoint(const ContainerEndpoint& cep, const ConnStatus& status) {
+  using Proto = sensor::NetworkEndpoint;
+  using ProcessProto = storage::NetworkProcessUniqueKey;
+
+  int64_t family = TranslateAddressFamily(cep.endpoint().address().family());
+  int64_t protocol = TranslateL4Protocol(cep.l4proto());
+  bool closed = !status.IsActive();
+  Timestamp close_timestamp = {0, 0};
+  if (closed) {
+    close_timestamp = MicrosecondsToTimestamp(status.LastActiveTime());
+  }
+
+  std::string process_name, process_exec_file_path, process_args;
+  size_t originator_size = 0;
+  if (cep.originator()) {
+    process_name = cep.originator()->comm();
+    process_exec_file_path = cep.originator()->exe_path();
+    process_args = cep.originator()->args();
+    originator_size = BytesFieldSize(ProcessProto::kProcessNameFieldNumber, process_name.size()) +
+                      BytesFieldSize(ProcessProto::kProcessExecFilePathFieldNumber, process_exec_file_path.size()) +
+                      BytesFieldSize(ProcessProto::kProcessArgsFieldNumber, process_args.size());
+  }
+
+  size_t size = VarintFieldSize(Proto::kSocketFamilyFieldNumber, family) +
+                VarintFieldSize(Proto::kProtocolFieldNumber, protocol) +
+                AddressFieldSize(Proto::kListenAddressFieldNumber, cep.endpoint()) +
+                BytesFieldSize(Proto::kContainerIdFieldNumber, cep.container().size());
+  if (closed) {
+    size += TimestampFieldSize(Proto::kCloseTimestampFieldNumber, close_timestamp);
+  }
+  if (cep.originator()) {
+    size += MessageFieldSize(Proto::kOriginatorFieldNumber, originator_size);
+  }
+
+  size_t entry_size = MessageFieldSize(sensor::NetworkConnectionInfo::kUpdatedEndpointsFieldNumber, size);
+  uint8_t* target = Append(entry_size);
+  target = WriteMessageHeader(sensor::NetworkConnectionInfo::kUpdatedEndpointsFieldNumber, size, target);
+  target = WriteVarintField(Proto::kSocketFamilyFieldNumber, family, target);
+  target = WriteVarintField(Proto::kProtocolFieldNumber, protocol, target);
+  target = WriteAddressField(Proto::kListenAddressFieldNumber, cep.endpoint(), target);
+  target = WriteBytesField(Proto::kContainerIdFieldNumber, cep.container().data(), cep.container().size(), target);
+  if (closed) {
+    target = WriteTimestampField(Proto::kCloseTimestampFieldNumber, close_timestamp, target);
+  }
+  if (cep.originator()) {
+    target = WriteMessageHeader(Proto::kOriginatorFieldNumber, originator_size, target);
+    target = WriteBytesField(ProcessProto::kProcessNameFieldNumber, process_name.data(), process_name.size(), target);
+    target = WriteBytesField(ProcessProto::kProcessExecFilePathFieldNumber, process_exec_file_path.data(), process_exec_file_path.size(), target);
+    WriteBytesField(ProcessProto::kProcessArgsFieldNumber, process_args.data(), process_args.size(), target);
+  }
+
+  num_entries_++;
+  return entry_size;
+}
+
+grpc::ByteBuffer NetworkConnectionInfoEncoder::Finish(const google::protobuf::Timestamp& time_proto) const {
+  Timestamp time = {time_proto.seconds(), time_proto.nanos()};
+  size_t info_size = buffer_.size() + TimestampFieldSize(sensor::NetworkConnectionInfo::kTimeFieldNumber, time);
+  size_t msg_size = MessageFieldSize(sensor::NetworkConnectionInfoMessage::kInfoFieldNumber, info_size);
+
+  // The message is assembled in a slice owned by the byte buffer, which keeps it alive until gRPC has sent it.
+  grpc::Slice slice(grpc_slice_malloc(msg_size), grpc::Slice::STEAL_REF);
+  uint8_t* target = const_cast<uint8_t*>(slice.begin());
+  target = WriteMessageHeader(sensor::NetworkConnectionInfoMessage::kInfoFieldNumber, info_size, target);
+  if (!buffer_.empty()) {
+    std::memcpy(target, buffer_.data(), buffer_.size());
+    target += buffer_.size();
+  }
+  WriteTimestampField(sensor::NetworkConnectionInfo::kTimeFieldNumber, time, target);
+
+  return grpc::ByteBuffer(&slice, 1);
+}
+
+}  // namespace collector
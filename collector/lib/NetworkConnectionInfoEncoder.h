@@ -0,0 +1,72 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#ifndef COLLECTOR_NETWORKCONNECTIONINFOENCODER_H
+#define COLLECTOR_NETWORKCONNECTIONINFOENCODER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <google/protobuf/timestamp.pb.h>
+#include <grpcpp/support/byte_buffer.h>
+
+#include "ConnTracker.h"
+#include "NetworkConnection.h"
+
+namespace collector {
+
+// NetworkConnectionInfoEncoder encodes a sensor::NetworkConnectionInfoMessage with connection and endpoint updates
+// directly in the protobuf wire format, without building the intermediate message objects. The result is equivalent to
+// serializing the message built by the generated code. Entries are encoded into a buffer that is reused across
+// messages, such that encoding does not allocate once the buffer has reached its steady-state size.
+class NetworkConnectionInfoEncoder {
+ public:
+  // Starts a new message.
+  void Reset() {
+    buffer_.clear();
+    num_entries_ = 0;
+  }
+
+  // Adds an entry to the updated connections of the message, and returns its encoded size.
+  size_t AddConnection(const Connection& conn, const ConnStatus& status);
+  // Adds an entry to the updated endpoints of the message, and returns its encoded size. All connections must be added
+  // before the first endpoint, in order to keep the repeated fields contiguous.
+  size_t AddContainerEndpoint(const ContainerEndpoint& cep, const ConnStatus& status);
+
+  // Completes the message with the given time, and returns the serialized message.
+  grpc::ByteBuffer Finish(const google::protobuf::Timestamp& time) const;
+
+  size_t num_entries() const { return num_entries_; }
+  // Returns the encoded size of the entries added so far.
+  size_t entries_size() const { return buffer_.size(); }
+
+ private:
+  uint8_t* Append(size_t size);
+
+  std::vector<uint8_t> buffer_;
+  size_t num_entries_ = 0;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_NETWORKCONNECTIONINFOENCODER_H
@@ -36,10 +36,11 @@ std::unique_ptr<grpc::ClientContext> NetworkConnectionInfoServiceComm::CreateCli
   auto ctx = MakeUnique<grpc::ClientContext>();
   ctx->AddMetadata(kHostnameMetadataKey, hostname_);
   ctx->AddMetadata(kCapsMetadataKey, kSupportedCaps);
+  ctx->set_compression_algorithm(compression_);
   return ctx;
 }
 
-NetworkConnectionInfoServiceComm::NetworkConnectionInfoServiceComm(std::string hostname, std::shared_ptr<grpc::Channel> channel) : hostname_(std::move(hostname)), channel_(std::move(channel)), stub_(sensor::NetworkConnectionInfoService::NewStub(channel_)) {
+NetworkConnectionInfoServiceComm::NetworkConnectionInfoServiceComm(std::string hostname, std::shared_ptr<grpc::Channel> channel, grpc_compression_algorithm compression) : hostname_(std::move(hostname)), channel_(std::move(channel)), compression_(compression), stub_(sensor::NetworkConnectionInfoService::NewStub(channel_)) {
 }
 
 void NetworkConnectionInfoServiceComm::ResetClientContext() {
@@ -58,13 +59,15 @@ void NetworkConnectionInfoServiceComm::TryCancel() {
   }
 }
 
-std::unique_ptr<IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>> NetworkConnectionInfoServiceComm::PushNetworkConnectionInfoOpenStream(std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) {
+std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> NetworkConnectionInfoServiceComm::PushNetworkConnectionInfoOpenStream(std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) {
   if (!context_)
     ResetClientContext();
 
-  return DuplexClient::CreateWithReadCallback(
-      &sensor::NetworkConnectionInfoService::Stub::AsyncPushNetworkConnectionInfo,
-      channel_, context_.get(), std::move(receive_func));
+  // The method is called through a generic stub, since the messages are encoded by the NetworkConnectionInfoEncoder
+  // rather than by the generated code.
+  std::string method = std::string("/") + sensor::NetworkConnectionInfoService::service_full_name() + "/PushNetworkConnectionInfo";
+  return DuplexClient::CreateGenericWithReadCallback<sensor::NetworkFlowsControlMessage>(
+      method, channel_, context_.get(), std::move(receive_func));
 }
 
 }  // namespace collector
@@ -51,12 +51,14 @@ class INetworkConnectionInfoServiceComm {
 
   virtual sensor::NetworkConnectionInfoService::StubInterface* GetStub() = 0;
 
-  virtual std::unique_ptr<IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>> PushNetworkConnectionInfoOpenStream(std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) = 0;
+  // Opens the stream of network connection info messages, which are written in serialized form.
+  virtual std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> PushNetworkConnectionInfoOpenStream(std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) = 0;
 };
 
 class NetworkConnectionInfoServiceComm : public INetworkConnectionInfoServiceComm {
  public:
-  NetworkConnectionInfoServiceComm(std::string hostname, std::shared_ptr<grpc::Channel> channel);
+  NetworkConnectionInfoServiceComm(std::string hostname, std::shared_ptr<grpc::Channel> channel,
+                                   grpc_compression_algorithm compression = GRPC_COMPRESS_NONE);
 
   void ResetClientContext() override;
   bool WaitForConnectionReady(const std::function<bool()>& check_interrupted) override;
@@ -66,7 +68,7 @@ class NetworkConnectionInfoServiceComm : public INetworkConnectionInfoServiceCom
     return stub_.get();
   }
 
-  std::unique_ptr<IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>> PushNetworkConnectionInfoOpenStream(std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) override;
+  std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> PushNetworkConnectionInfoOpenStream(std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) override;
 
  private:
   static constexpr char kHostnameMetadataKey[] = "rox-collector-hostname";
@@ -79,6 +81,7 @@ class NetworkConnectionInfoServiceComm : public INetworkConnectionInfoServiceCom
 
   std::string hostname_;
   std::shared_ptr<grpc::Channel> channel_;
+  grpc_compression_algorithm compression_;
   std::unique_ptr<sensor::NetworkConnectionInfoService::Stub> stub_;
 
   std::mutex context_mutex_;
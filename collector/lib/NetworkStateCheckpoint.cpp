@@ -0,0 +1,359 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include "NetworkStateCheckpoint.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <type_traits>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "FileSystem.h"
+#include "Logging.h"
+#include "Utility.h"
+
+namespace collector {
+
+constexpr uint32_t NetworkStateCheckpoint::kMagic;
+constexpr uint32_t NetworkStateCheckpoint::kVersion;
+
+namespace {
+
+struct CheckpointHeader {
+  uint32_t magic;
+  uint32_t version;
+  int64_t created_micros;
+  uint64_t payload_size;
+  uint32_t payload_crc32;
+  uint32_t reserved;
+};
+
+static_assert(std::is_trivially_copyable<CheckpointHeader>::value, "CheckpointHeader must be trivially copyable");
+
+// Encoder appends binary representations of values to a string buffer.
+class Encoder {
+ public:
+  explicit Encoder(std::string* buf) : buf_(buf) {}
+
+  template <typename T>
+  void Put(const T& val) {
+    static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be encoded directly");
+    buf_->append(reinterpret_cast<const char*>(&val), sizeof(val));
+  }
+
+  void PutString(const std::string& str) {
+    Put(static_cast<uint32_t>(str.size()));
+    buf_->append(str);
+  }
+
+  void PutEndpoint(const Endpoint& ep) {
+    const IPNet& net = ep.network();
+    Put(static_cast<uint8_t>(net.family()));
+    Put(net.address().array());
+    Put(static_cast<uint8_t>(net.bits()));
+    Put(static_cast<uint8_t>(net.IsAddress()));
+    Put(ep.port());
+  }
+
+  void PutStatus(const ConnStatus& status) {
+    Put(status.LastActiveTime());
+    Put(static_cast<uint8_t>(status.IsActive()));
+  }
+
+  void PutConnMap(const ConnMap& conns) {
+    Put(static_cast<uint64_t>(conns.size()));
+    for (const auto& entry : conns) {
+      const Connection& conn = entry.first;
+      PutString(conn.container());
+      PutEndpoint(conn.local());
+      PutEndpoint(conn.remote());
+      Put(static_cast<uint8_t>(conn.l4proto()));
+      Put(static_cast<uint8_t>(conn.is_server()));
+      PutStatus(entry.second);
+    }
+  }
+
+  void PutEndpointMap(const ContainerEndpointMap& endpoints) {
+    Put(static_cast<uint64_t>(endpoints.size()));
+    for (const auto& entry : endpoints) {
+      const ContainerEndpoint& cep = entry.first;
+      PutString(cep.container());
+      PutEndpoint(cep.endpoint());
+      Put(static_cast<uint8_t>(cep.l4proto()));
+      PutStatus(entry.second);
+    }
+  }
+
+ private:
+  std::string* buf_;
+};
+
+// Decoder reads values written by an Encoder, checking bounds on every access.
+class Decoder {
+ public:
+  Decoder(const char* data, size_t size) : p_(data), endp_(data + size) {}
+
+  template <typename T>
+  bool Get(T* val) {
+    static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be decoded directly");
+    if (endp_ - p_ < ssizeof(T)) return false;
+    std::memcpy(val, p_, sizeof(T));
+    p_ += sizeof(T);
+    return true;
+  }
+
+  bool GetString(std::string* str) {
+    uint32_t len;
+    if (!Get(&len) || endp_ - p_ < static_cast<ssize_t>(len)) return false;
+    str->assign(p_, len);
+    p_ += len;
+    return true;
+  }
+
+  bool GetEndpoint(Endpoint* ep) {
+    uint8_t family, bits, is_addr;
+    std::array<uint64_t, Address::kU64MaxLen> addr_data;
+    uint16_t port;
+    if (!Get(&family) || !Get(&addr_data) || !Get(&bits) || !Get(&is_addr) || !Get(&port)) return false;
+    if (family > static_cast<uint8_t>(Address::Family::IPV6)) return false;
+
+    *ep = Endpoint(IPNet(Address(static_cast<Address::Family>(family), addr_data), bits, is_addr != 0), port);
+    return true;
+  }
+
+  bool GetStatus(ConnStatus* status) {
+    int64_t last_active_time;
+    uint8_t active;
+    if (!Get(&last_active_time) || !Get(&active)) return false;
+    *status = ConnStatus(last_active_time, active != 0);
+    return true;
+  }
+
+  bool GetConnMap(ConnMap* conns) {
+    uint64_t count;
+    if (!Get(&count)) return false;
+    for (uint64_t i = 0; i < count; i++) {
+      std::string container;
+      Endpoint local, remote;
+      uint8_t l4proto, is_server;
+      ConnStatus status;
+      if (!GetString(&container) || !GetEndpoint(&local) || !GetEndpoint(&remote) || !Get(&l4proto) ||
+          !Get(&is_server) || !GetStatus(&status)) {
+        return false;
+      }
+      conns->emplace(Connection(std::move(container), local, remote, static_cast<L4Proto>(l4proto), is_server != 0), status);
+    }
+    return true;
+  }
+
+  bool GetEndpointMap(ContainerEndpointMap* endpoints) {
+    uint64_t count;
+    if (!Get(&count)) return false;
+    for (uint64_t i = 0; i < count; i++) {
+      std::string container;
+      Endpoint endpoint;
+      uint8_t l4proto;
+      ConnStatus status;
+      if (!GetString(&container) || !GetEndpoint(&endpoint) || !Get(&l4proto) || !GetStatus(&status)) {
+        return false;
+      }
+      endpoints->emplace(ContainerEndpoint(std::move(container), endpoint, static_cast<L4Proto>(l4proto), nullptr), status);
+    }
+    return true;
+  }
+
+  bool AtEnd() const { return p_ == endp_; }
+
+ private:
+  const char* p_;
+  const char* endp_;
+};
+
+uint32_t Checksum(const char* data, size_t size) {
+  return static_cast<uint32_t>(crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(data), size));
+}
+
+// MappedFile is a read-only or read-write memory mapping of an entire file.
+class MappedFile {
+ public:
+  MappedFile(int fd, size_t size, int prot) : size_(size) {
+    void* addr = mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+    addr_ = (addr == MAP_FAILED) ? nullptr : static_cast<char*>(addr);
+  }
+  ~MappedFile() {
+    if (addr_) munmap(addr_, size_);
+  }
+
+  bool valid() const { return addr_ != nullptr; }
+  char* data() const { return addr_; }
+  size_t size() const { return size_; }
+
+ private:
+  char* addr_;
+  size_t size_;
+};
+
+}  // namespace
+
+std::string NetworkStateCheckpoint::Serialize(const NetworkState& state, int64_t now_micros) {
+  std::string buf(sizeof(CheckpointHeader), '\0');
+  Encoder enc(&buf);
+  enc.PutConnMap(state.tracker_conns);
+  enc.PutEndpointMap(state.tracker_endpoints);
+  enc.PutConnMap(state.reported_conns);
+  enc.PutEndpointMap(state.reported_endpoints);
+  enc.Put(state.time_at_last_scrape);
+
+  CheckpointHeader header = {};
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.created_micros = now_micros;
+  header.payload_size = buf.size() - sizeof(CheckpointHeader);
+  header.payload_crc32 = Checksum(buf.data() + sizeof(CheckpointHeader), header.payload_size);
+  std::memcpy(&buf[0], &header, sizeof(header));
+
+  return buf;
+}
+
+bool NetworkStateCheckpoint::Deserialize(const char* data, size_t size, int64_t now_micros, int64_t max_age_micros, NetworkState* state) {
+  CheckpointHeader header;
+  if (size < sizeof(header)) {
+    CLOG(WARNING) << "Network state checkpoint is truncated";
+    return false;
+  }
+  std::memcpy(&header, data, sizeof(header));
+
+  if (header.magic != kMagic) {
+    CLOG(WARNING) << "Network state checkpoint has an invalid magic number";
+    return false;
+  }
+  if (header.version != kVersion) {
+    CLOG(INFO) << "Discarding network state checkpoint with unsupported version " << header.version;
+    return false;
+  }
+  if (header.created_micros > now_micros) {
+    CLOG(INFO) << "Discarding network state checkpoint created in the future ("
+               << (header.created_micros - now_micros) / 1000000 << "s ahead)";
+    return false;
+  }
+  if (now_micros - header.created_micros > max_age_micros) {
+    CLOG(INFO) << "Discarding stale network state checkpoint (age: " << (now_micros - header.created_micros) / 1000000 << "s)";
+    return false;
+  }
+  if (header.payload_size != size - sizeof(header)) {
+    CLOG(WARNING) << "Network state checkpoint has an unexpected size";
+    return false;
+  }
+
+  const char* payload = data + sizeof(header);
+  if (Checksum(payload, header.payload_size) != header.payload_crc32) {
+    CLOG(WARNING) << "Network state checkpoint has an invalid checksum";
+    return false;
+  }
+
+  NetworkState decoded;
+  Decoder dec(payload, header.payload_size);
+  if (!dec.GetConnMap(&decoded.tracker_conns) || !dec.GetEndpointMap(&decoded.tracker_endpoints) ||
+      !dec.GetConnMap(&decoded.reported_conns) || !dec.GetEndpointMap(&decoded.reported_endpoints) ||
+      !dec.Get(&decoded.time_at_last_scrape) || !dec.AtEnd()) {
+    CLOG(WARNING) << "Network state checkpoint is malformed";
+    return false;
+  }
+
+  decoded.created_micros = header.created_micros;
+  *state = std::move(decoded);
+  return true;
+}
+
+bool NetworkStateCheckpoint::Save(const NetworkState& state, int64_t now_micros) const {
+  std::string buf = Serialize(state, now_micros);
+  std::string tmp_path = path_ + ".tmp";
+
+  {
+    FDHandle fd = open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (!fd.valid()) {
+      CLOG(ERROR) << "Could not open " << tmp_path << " for writing: " << StrError();
+      return false;
+    }
+    if (ftruncate(fd, buf.size()) != 0) {
+      CLOG(ERROR) << "Could not resize " << tmp_path << ": " << StrError();
+      return false;
+    }
+
+    MappedFile mapping(fd, buf.size(), PROT_READ | PROT_WRITE);
+    if (!mapping.valid()) {
+      CLOG(ERROR) << "Could not map " << tmp_path << ": " << StrError();
+      return false;
+    }
+    std::memcpy(mapping.data(), buf.data(), buf.size());
+    if (msync(mapping.data(), mapping.size(), MS_SYNC) != 0) {
+      CLOG(ERROR) << "Could not sync " << tmp_path << ": " << StrError();
+      return false;
+    }
+  }
+
+  if (rename(tmp_path.c_str(), path_.c_str()) != 0) {
+    CLOG(ERROR) << "Could not move network state checkpoint to " << path_ << ": " << StrError();
+    TryUnlink(tmp_path.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+bool NetworkStateCheckpoint::Load(NetworkState* state, int64_t now_micros) const {
+  FDHandle fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (!fd.valid()) {
+    if (errno != ENOENT) {
+      CLOG(WARNING) << "Could not open network state checkpoint " << path_ << ": " << StrError();
+    }
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    CLOG(WARNING) << "Could not determine size of network state checkpoint " << path_;
+    return false;
+  }
+
+  MappedFile mapping(fd, st.st_size, PROT_READ);
+  if (!mapping.valid()) {
+    CLOG(WARNING) << "Could not map network state checkpoint " << path_ << ": " << StrError();
+    return false;
+  }
+
+  if (!Deserialize(mapping.data(), mapping.size(), now_micros, max_age_micros_, state)) {
+    TryUnlink(path_.c_str());
+    return false;
+  }
+
+  CLOG(INFO) << "Restored network state checkpoint with " << state->tracker_conns.size() << " connections and "
+             << state->tracker_endpoints.size() << " endpoints";
+  return true;
+}
+
+}  // namespace collector
@@ -0,0 +1,88 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#ifndef COLLECTOR_NETWORKSTATECHECKPOINT_H
+#define COLLECTOR_NETWORKSTATECHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+
+#include "ConnTracker.h"
+
+namespace collector {
+
+// NetworkState is the part of the network state that needs to survive a collector restart: the state held by the
+// ConnectionTracker, and the state that has last been reported to sensor by the NetworkStatusNotifier.
+struct NetworkState {
+  ConnMap tracker_conns;
+  ContainerEndpointMap tracker_endpoints;
+
+  ConnMap reported_conns;
+  ContainerEndpointMap reported_endpoints;
+  int64_t time_at_last_scrape = 0;
+
+  // Time at which the checkpoint was written. Only set by Load.
+  int64_t created_micros = 0;
+};
+
+// NetworkStateCheckpoint reads and writes NetworkState checkpoints from/to a file, which is expected to live on a
+// host path such that it is retained across container restarts.
+//
+// A checkpoint consists of a fixed-size header (magic, format version, creation time, payload size and CRC32 of the
+// payload) followed by the serialized state. Checkpoints with a different version, a bad checksum, or that are older
+// than the configured maximum age (or created in the future) are discarded on load. Values are stored in host byte order, as a checkpoint is
+// only ever read back on the node it was written on.
+//
+// Note that the originator process of container endpoints is not persisted.
+class NetworkStateCheckpoint {
+ public:
+  static constexpr uint32_t kMagic = 0x4b43584e;  // "NXCK"
+  static constexpr uint32_t kVersion = 1;
+
+  NetworkStateCheckpoint(std::string path, int64_t interval_micros, int64_t max_age_micros)
+      : path_(std::move(path)), interval_micros_(interval_micros), max_age_micros_(max_age_micros) {}
+
+  // Save atomically replaces the checkpoint file with the given state.
+  bool Save(const NetworkState& state, int64_t now_micros) const;
+
+  // Load reads the checkpoint file into *state. Returns false if there is no usable checkpoint, in which case *state
+  // is left untouched.
+  bool Load(NetworkState* state, int64_t now_micros) const;
+
+  const std::string& path() const { return path_; }
+  // Minimum time between two checkpoints written by the NetworkStatusNotifier.
+  int64_t interval_micros() const { return interval_micros_; }
+
+  // Serialization of the state, exposed for testing.
+  static std::string Serialize(const NetworkState& state, int64_t now_micros);
+  static bool Deserialize(const char* data, size_t size, int64_t now_micros, int64_t max_age_micros, NetworkState* state);
+
+ private:
+  std::string path_;
+  int64_t interval_micros_;
+  int64_t max_age_micros_;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_NETWORKSTATECHECKPOINT_H
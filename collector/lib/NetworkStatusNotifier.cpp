@@ -23,8 +23,6 @@ You should have received a copy of the GNU General Public License along with thi
 
 #include "NetworkStatusNotifier.h"
 
-#include <google/protobuf/util/time_util.h>
-
 #include "CollectorStats.h"
 #include "DuplexGRPC.h"
 #include "GRPCUtil.h"
@@ -37,27 +35,32 @@ namespace collector {
 
 namespace {
 
-storage::L4Protocol TranslateL4Protocol(L4Proto proto) {
-  switch (proto) {
-    case L4Proto::TCP:
-      return storage::L4_PROTOCOL_TCP;
-    case L4Proto::UDP:
-      return storage::L4_PROTOCOL_UDP;
-    case L4Proto::ICMP:
-      return storage::L4_PROTOCOL_ICMP;
-    default:
-      return storage::L4_PROTOCOL_UNKNOWN;
+// Waiting longer than this for the previous message to be sent counts as a stall of the pipeline.
+constexpr auto kWriteStallThreshold = std::chrono::milliseconds(1);
+
+// Interval at which the pending connection updates are checked when early flushes are enabled.
+constexpr auto kFlushCheckInterval = std::chrono::milliseconds(250);
+
+// Adds the entries of from to *to, unless *to already has a (more recent) status for them.
+template <typename T>
+void AddMissing(UnorderedMap<T, ConnStatus>* from, UnorderedMap<T, ConnStatus>* to) {
+  if (to->empty()) {
+    std::swap(*from, *to);
+    return;
   }
+  for (const auto& entry : *from) {
+    to->insert(entry);
+  }
+  from->clear();
 }
 
-sensor::SocketFamily TranslateAddressFamily(Address::Family family) {
-  switch (family) {
-    case Address::Family::IPV4:
-      return sensor::SOCKET_FAMILY_IPV4;
-    case Address::Family::IPV6:
-      return sensor::SOCKET_FAMILY_IPV6;
-    default:
-      return sensor::SOCKET_FAMILY_UNKNOWN;
+// MarkClosed marks all active entries of the given state as closed at the given time.
+template <typename T>
+void MarkClosed(UnorderedMap<T, ConnStatus>* state, int64_t time_micros) {
+  for (auto& entry : *state) {
+    if (entry.second.IsActive()) {
+      entry.second = ConnStatus(time_micros, false);
+    }
   }
 }
 
@@ -157,13 +160,14 @@ void NetworkStatusNotifier::Run() {
     } else {
       CLOG(ERROR) << "Error streaming network connection info: " << status.error_message();
     }
-    next_attempt = std::chrono::system_clock::now() + std::chrono::seconds(10);
+    next_attempt = std::chrono::system_clock::now() + reconnect_delay_;
   }
 
   CLOG(INFO) << "Stopped network status notifier.";
 }
 
 void NetworkStatusNotifier::Start() {
+  RestoreCheckpoint();
   thread_.Start([this] { Run(); });
   CLOG(INFO) << "Started network status notifier.";
 }
@@ -173,7 +177,93 @@ void NetworkStatusNotifier::Stop() {
   thread_.Stop();
 }
 
-void NetworkStatusNotifier::WaitUntilWriterStarted(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer, int wait_time_seconds) {
+void NetworkStatusNotifier::RestoreCheckpoint() {
+  if (!checkpoint_) {
+    return;
+  }
+
+  auto state = MakeUnique<NetworkState>();
+  if (!checkpoint_->Load(state.get(), NowMicros())) {
+    return;
+  }
+
+  if (turn_off_scraping_) {
+    // Without scrapes, restored connections would only be closed by close events, which may have been missed while
+    // collector was not running. Hence they are considered closed as of the checkpoint.
+    MarkClosed(&state->tracker_conns, state->created_micros);
+    MarkClosed(&state->tracker_endpoints, state->created_micros);
+  }
+  conn_tracker_->RestoreState(state->tracker_conns, state->tracker_endpoints);
+  state->tracker_conns.clear();
+  state->tracker_endpoints.clear();
+  restored_state_ = std::move(state);
+}
+
+void NetworkStatusNotifier::TakeRestoredState(ConnMap* reported_conns, ContainerEndpointMap* reported_endpoints, int64_t* time_at_last_scrape) {
+  if (!restored_state_) {
+    return;
+  }
+
+  *reported_conns = std::move(restored_state_->reported_conns);
+  *reported_endpoints = std::move(restored_state_->reported_endpoints);
+  if (time_at_last_scrape && restored_state_->time_at_last_scrape) {
+    *time_at_last_scrape = restored_state_->time_at_last_scrape;
+  }
+  restored_state_.reset();
+}
+
+void NetworkStatusNotifier::RetainStateForResync(ConnMap* reported_conns, ContainerEndpointMap* reported_endpoints, int64_t time_at_last_scrape) {
+  if (resync_buffer_entries_ == 0) {
+    return;
+  }
+
+  size_t num_unwritten = unwritten_conn_deltas_.size() + unwritten_cep_deltas_.size();
+  if (unwritten_overflow_ || num_unwritten > resync_buffer_entries_) {
+    CLOG(WARNING) << "Too many network connection updates may not have been sent, the full state will be sent on the next stream";
+    unwritten_conn_deltas_.clear();
+    unwritten_cep_deltas_.clear();
+    unwritten_overflow_ = false;
+    resyncing_ = false;
+    COUNTER_INC(CollectorStats::net_full_resyncs);
+    return;
+  }
+
+  auto state = MakeUnique<NetworkState>();
+  state->reported_conns = std::move(*reported_conns);
+  state->reported_endpoints = std::move(*reported_endpoints);
+  state->time_at_last_scrape = time_at_last_scrape;
+  restored_state_ = std::move(state);
+  resyncing_ = true;
+  COUNTER_INC(CollectorStats::net_resyncs);
+  COUNTER_ADD(CollectorStats::net_resync_unwritten_deltas, num_unwritten);
+}
+
+void NetworkStatusNotifier::MaybeCheckpoint(const ConnMap& reported_conns, const ContainerEndpointMap& reported_endpoints, int64_t time_at_last_scrape, bool force) {
+  if (!checkpoint_) {
+    return;
+  }
+
+  int64_t now = NowMicros();
+  if (!force && now < next_checkpoint_micros_) {
+    return;
+  }
+  next_checkpoint_micros_ = now + checkpoint_->interval_micros();
+
+  WITH_TIMER(CollectorStats::net_checkpoint_write) {
+    NetworkState state;
+    state.tracker_conns = conn_tracker_->FetchConnState(false, false);
+    state.tracker_endpoints = conn_tracker_->FetchEndpointState(false, false);
+    state.reported_conns = reported_conns;
+    state.reported_endpoints = reported_endpoints;
+    state.time_at_last_scrape = time_at_last_scrape;
+
+    if (!checkpoint_->Save(state, now)) {
+      CLOG(WARNING) << "Failed to write network state checkpoint to " << checkpoint_->path();
+    }
+  }
+}
+
+void NetworkStatusNotifier::WaitUntilWriterStarted(IDuplexClientWriter<grpc::ByteBuffer>* writer, int wait_time_seconds) {
   if (!writer->WaitUntilStarted(std::chrono::seconds(wait_time_seconds))) {
     CLOG(ERROR) << "Failed to establish network connection info stream.";
     return;
@@ -182,7 +272,80 @@ void NetworkStatusNotifier::WaitUntilWriterStarted(IDuplexClientWriter<sensor::N
   CLOG(INFO) << "Established network connection info stream.";
 }
 
-bool NetworkStatusNotifier::UpdateAllConnsAndEndpoints() {
+std::chrono::system_clock::time_point NetworkStatusNotifier::FirstScrapeTime() {
+  auto now = std::chrono::system_clock::now();
+  if (scraped_once_ || !scrape_scheduler_) {
+    return now;
+  }
+  scraped_once_ = true;
+  return now + scrape_scheduler_->start_offset();
+}
+
+bool NetworkStatusNotifier::EarlyFlushDue(std::chrono::system_clock::time_point now) const {
+  if (now - last_flush_ < flush_min_interval_) {
+    return false;
+  }
+
+  int64_t first_update_micros;
+  uint64_t pending_updates = conn_tracker_->PendingUpdates(&first_update_micros);
+  if (pending_updates == 0) {
+    return false;
+  }
+  if (flush_pending_updates_ > 0 && pending_updates >= flush_pending_updates_) {
+    return true;
+  }
+  return flush_max_age_.count() > 0 &&
+         NowMicros() - first_update_micros >= std::chrono::duration_cast<std::chrono::microseconds>(flush_max_age_).count();
+}
+
+bool NetworkStatusNotifier::WaitForNextCycle(IDuplexClient* client, std::chrono::system_clock::time_point next_scrape, bool* scrape) {
+  *scrape = true;
+  if (flush_pending_updates_ == 0 && flush_max_age_.count() == 0) {
+    return client->Sleep(next_scrape);
+  }
+
+  // Connection updates are not signalled to this thread, hence they are polled for while waiting for the next scrape.
+  for (;;) {
+    auto wake = std::min(next_scrape, std::chrono::system_clock::now() + kFlushCheckInterval);
+    if (!client->Sleep(wake)) {
+      return false;
+    }
+    if (wake == next_scrape) {
+      return true;
+    }
+    if (EarlyFlushDue(wake)) {
+      *scrape = false;
+      COUNTER_INC(CollectorStats::net_early_flushes);
+      return true;
+    }
+  }
+}
+
+bool NetworkStatusNotifier::ScrapeSliced(IDuplexClient* client, std::vector<Connection>* all_conns, std::vector<ContainerEndpoint>* all_listen_endpoints) {
+  auto cycle_start = std::chrono::system_clock::now();
+  int num_slices = scrape_scheduler_->num_slices();
+  for (int slice = 0; slice < num_slices; slice++) {
+    auto slice_start = std::chrono::system_clock::now();
+    auto slice_start_cpu_time = ThreadCPUTime() + conn_scraper_->WorkerCPUTime();
+    WITH_TIMER(CollectorStats::net_scrape_read) {
+      if (!conn_scraper_->ScrapeSlice(slice, num_slices, all_conns, all_listen_endpoints)) {
+        CLOG(ERROR) << "Failed to scrape connections and no pending connections to send";
+        return false;
+      }
+    }
+
+    if (slice + 1 < num_slices) {
+      auto now = std::chrono::system_clock::now();
+      auto cpu_time = ThreadCPUTime() + conn_scraper_->WorkerCPUTime() - slice_start_cpu_time;
+      if (!client->Sleep(scrape_scheduler_->NextSliceTime(cycle_start, slice + 1, now, now - slice_start, cpu_time))) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool NetworkStatusNotifier::UpdateAllConnsAndEndpoints(IDuplexClient* client) {
   if (turn_off_scraping_) {
     return true;
   }
@@ -190,13 +353,22 @@ bool NetworkStatusNotifier::UpdateAllConnsAndEndpoints() {
   int64_t ts = NowMicros();
   std::vector<Connection> all_conns;
   std::vector<ContainerEndpoint> all_listen_endpoints;
-  WITH_TIMER(CollectorStats::net_scrape_read) {
-    bool success = conn_scraper_->Scrape(&all_conns, scrape_listen_endpoints_ ? &all_listen_endpoints : nullptr);
-    if (!success) {
-      CLOG(ERROR) << "Failed to scrape connections and no pending connections to send";
+  auto* listen_endpoints = scrape_listen_endpoints_ ? &all_listen_endpoints : nullptr;
+  if (scrape_scheduler_ && scrape_scheduler_->num_slices() > 1) {
+    if (!ScrapeSliced(client, &all_conns, listen_endpoints)) {
       return false;
     }
+  } else {
+    WITH_TIMER(CollectorStats::net_scrape_read) {
+      bool success = conn_scraper_->Scrape(&all_conns, listen_endpoints);
+      if (!success) {
+        CLOG(ERROR) << "Failed to scrape connections and no pending connections to send";
+        return false;
+      }
+    }
   }
+  // A sliced snapshot is assembled from slices scraped at different times. It is applied with the timestamp of the start of
+  // the cycle, such that more recent updates from events take precedence.
   WITH_TIMER(CollectorStats::net_scrape_update) {
     conn_tracker_->Update(all_conns, all_listen_endpoints, ts);
   }
@@ -204,21 +376,55 @@ bool NetworkStatusNotifier::UpdateAllConnsAndEndpoints() {
   return true;
 }
 
-void NetworkStatusNotifier::RunSingle(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer) {
+bool NetworkStatusNotifier::WriteMessage(IDuplexClientWriter<grpc::ByteBuffer>* writer,
+                                         const grpc::ByteBuffer& msg,
+                                         std::chrono::system_clock::time_point deadline) {
+  // The previous message may still be in flight, e.g., due to gRPC flow control. Only one write can be pending at a
+  // time, so wait for it, which is accounted as back-pressure on the scrape stages.
+  auto wait_start = std::chrono::steady_clock::now();
+  bool writable;
+  WITH_TIMER(CollectorStats::net_write_backpressure) {
+    writable = writer->WaitUntilWritable(deadline).ok();
+  }
+  // A wait that timed out is a stall as well.
+  if (std::chrono::steady_clock::now() - wait_start > kWriteStallThreshold) {
+    COUNTER_INC(CollectorStats::net_write_stalls);
+  }
+  if (!writable) {
+    CLOG(ERROR) << "Failed to write network connection info: previous message could not be sent";
+    return false;
+  }
+
+  // gRPC keeps a reference to the serialized message until the write is done, hence it can be released right away.
+  WITH_TIMER(CollectorStats::net_write_message) {
+    if (!writer->WriteAsync(msg)) {
+      CLOG(ERROR) << "Failed to write network connection info";
+      return false;
+    }
+  }
+  return true;
+}
+
+void NetworkStatusNotifier::RunSingle(IDuplexClientWriter<grpc::ByteBuffer>* writer) {
   WaitUntilWriterStarted(writer, 10);
 
   ConnMap old_conn_state;
   ContainerEndpointMap old_cep_state;
-  auto next_scrape = std::chrono::system_clock::now();
+  TakeRestoredState(&old_conn_state, &old_cep_state, nullptr);
+  auto next_scrape = FirstScrapeTime();
+  bool scrape;
 
-  while (writer->Sleep(next_scrape)) {
-    next_scrape = std::chrono::system_clock::now() + std::chrono::seconds(scrape_interval_);
+  while (WaitForNextCycle(writer, next_scrape, &scrape)) {
+    if (scrape) {
+      next_scrape = std::chrono::system_clock::now() + std::chrono::seconds(scrape_interval_);
 
-    if (!UpdateAllConnsAndEndpoints()) {
-      continue;
+      if (!UpdateAllConnsAndEndpoints(writer)) {
+        continue;
+      }
     }
+    last_flush_ = std::chrono::system_clock::now();
+    conn_tracker_->ResetPendingUpdates();
 
-    const sensor::NetworkConnectionInfoMessage* msg;
     ConnMap new_conn_state;
     ContainerEndpointMap new_cep_state;
     WITH_TIMER(CollectorStats::net_fetch_state) {
@@ -229,42 +435,47 @@ void NetworkStatusNotifier::RunSingle(IDuplexClientWriter<sensor::NetworkConnect
       ConnectionTracker::ComputeDelta(new_cep_state, &old_cep_state);
     }
 
-    WITH_TIMER(CollectorStats::net_create_message) {
-      msg = CreateInfoMessage(old_conn_state, old_cep_state);
-      old_conn_state = std::move(new_conn_state);
-      old_cep_state = std::move(new_cep_state);
-    }
+    // The old state now holds the deltas to report.
+    ConnMap conn_delta = std::move(old_conn_state);
+    ContainerEndpointMap cep_delta = std::move(old_cep_state);
+    old_conn_state = std::move(new_conn_state);
+    old_cep_state = std::move(new_cep_state);
 
-    if (!msg) {
-      continue;
+    if (!SendDeltas(writer, &conn_delta, &cep_delta, next_scrape)) {
+      break;
     }
+    MaybeCheckpoint(old_conn_state, old_cep_state, NowMicros(), false);
+  }
 
-    WITH_TIMER(CollectorStats::net_write_message) {
-      if (!writer->Write(*msg, next_scrape)) {
-        CLOG(ERROR) << "Failed to write network connection info";
-        return;
-      }
-    }
+  if (thread_.should_stop()) {
+    MaybeCheckpoint(old_conn_state, old_cep_state, NowMicros(), true);
+  } else {
+    RetainStateForResync(&old_conn_state, &old_cep_state, 0);
   }
 }
 
-void NetworkStatusNotifier::RunSingleAfterglow(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer) {
+void NetworkStatusNotifier::RunSingleAfterglow(IDuplexClientWriter<grpc::ByteBuffer>* writer) {
   WaitUntilWriterStarted(writer, 10);
 
   ConnMap old_conn_state;
   ContainerEndpointMap old_cep_state;
-  auto next_scrape = std::chrono::system_clock::now();
+  auto next_scrape = FirstScrapeTime();
   int64_t time_at_last_scrape = NowMicros();
+  TakeRestoredState(&old_conn_state, &old_cep_state, &time_at_last_scrape);
+  bool scrape;
 
-  while (writer->Sleep(next_scrape)) {
-    next_scrape = std::chrono::system_clock::now() + std::chrono::seconds(scrape_interval_);
+  while (WaitForNextCycle(writer, next_scrape, &scrape)) {
+    if (scrape) {
+      next_scrape = std::chrono::system_clock::now() + std::chrono::seconds(scrape_interval_);
 
-    if (!UpdateAllConnsAndEndpoints()) {
-      continue;
+      if (!UpdateAllConnsAndEndpoints(writer)) {
+        continue;
+      }
     }
+    last_flush_ = std::chrono::system_clock::now();
+    conn_tracker_->ResetPendingUpdates();
 
     int64_t time_micros = NowMicros();
-    const sensor::NetworkConnectionInfoMessage* msg;
     ContainerEndpointMap new_cep_state;
     ConnMap new_conn_state, delta_conn;
     WITH_TIMER(CollectorStats::net_fetch_state) {
@@ -275,127 +486,100 @@ void NetworkStatusNotifier::RunSingleAfterglow(IDuplexClientWriter<sensor::Netwo
       ConnectionTracker::ComputeDelta(new_cep_state, &old_cep_state);
     }
 
-    WITH_TIMER(CollectorStats::net_create_message) {
-      // Report the deltas
-      msg = CreateInfoMessage(delta_conn, old_cep_state);
-      // Add new connections to the old_state and remove inactive connections that are older than the afterglow period.
-      ConnectionTracker::UpdateOldState(&old_conn_state, new_conn_state, time_micros, afterglow_period_micros_);
-      old_cep_state = std::move(new_cep_state);
-      time_at_last_scrape = time_micros;
-    }
+    // Add new connections to the old_state and remove inactive connections that are older than the afterglow period.
+    ConnectionTracker::UpdateOldState(&old_conn_state, new_conn_state, time_micros, afterglow_period_micros_);
+    ContainerEndpointMap cep_delta = std::move(old_cep_state);
+    old_cep_state = std::move(new_cep_state);
+    time_at_last_scrape = time_micros;
 
-    if (!msg) {
-      continue;
+    // Report the deltas
+    if (!SendDeltas(writer, &delta_conn, &cep_delta, next_scrape)) {
+      break;
     }
+    MaybeCheckpoint(old_conn_state, old_cep_state, time_at_last_scrape, false);
+  }
 
-    WITH_TIMER(CollectorStats::net_write_message) {
-      if (!writer->Write(*msg, next_scrape)) {
-        CLOG(ERROR) << "Failed to write network connection info";
-        return;
-      }
-    }
+  if (thread_.should_stop()) {
+    MaybeCheckpoint(old_conn_state, old_cep_state, time_at_last_scrape, true);
+  } else {
+    RetainStateForResync(&old_conn_state, &old_cep_state, time_at_last_scrape);
   }
 }
 
-sensor::NetworkConnectionInfoMessage* NetworkStatusNotifier::CreateInfoMessage(const ConnMap& conn_delta, const ContainerEndpointMap& endpoint_delta) {
-  if (conn_delta.empty() && endpoint_delta.empty()) return nullptr;
-
-  Reset();
-  auto* msg = AllocateRoot();
-  auto* info = msg->mutable_info();
-
-  AddConnections(info->mutable_updated_connections(), conn_delta);
-  COUNTER_ADD(CollectorStats::net_conn_deltas, conn_delta.size());
-  AddContainerEndpoints(info->mutable_updated_endpoints(), endpoint_delta);
-  COUNTER_ADD(CollectorStats::net_cep_deltas, endpoint_delta.size());
+bool NetworkStatusNotifier::SendDeltas(IDuplexClientWriter<grpc::ByteBuffer>* writer, ConnMap* conn_delta,
+                                       ContainerEndpointMap* cep_delta, std::chrono::system_clock::time_point deadline) {
+  if (resync_buffer_entries_ > 0) {
+    // Once the messages of the previous cycle have been written, their deltas no longer need to be retained. Deltas left
+    // over from a previous stream are sent along with the current ones, which take precedence.
+    if (!resyncing_ && writer->WaitUntilWritable(deadline)) {
+      unwritten_conn_deltas_.clear();
+      unwritten_cep_deltas_.clear();
+      unwritten_overflow_ = false;
+    }
+    resyncing_ = false;
+    AddMissing(&unwritten_conn_deltas_, conn_delta);
+    AddMissing(&unwritten_cep_deltas_, cep_delta);
+  }
 
-  *info->mutable_time() = CurrentTimeProto();
+  COUNTER_ADD(CollectorStats::net_conn_deltas, conn_delta->size());
+  COUNTER_ADD(CollectorStats::net_cep_deltas, cep_delta->size());
 
-  return msg;
-}
-
-void NetworkStatusNotifier::AddConnections(::google::protobuf::RepeatedPtrField<sensor::NetworkConnection>* updates, const ConnMap& delta) {
-  for (const auto& delta_entry : delta) {
-    auto* conn_proto = ConnToProto(delta_entry.first);
-    if (!delta_entry.second.IsActive()) {
-      *conn_proto->mutable_close_timestamp() = google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(
-          delta_entry.second.LastActiveTime());
+  bool ok = true;
+  DeltaCursor cursor = {conn_delta->cbegin(), conn_delta->cend(), cep_delta->cbegin(), cep_delta->cend()};
+  size_t num_chunks = 0;
+  while (ok && !cursor.done()) {
+    grpc::ByteBuffer msg;
+    size_t msg_bytes;
+    WITH_TIMER(CollectorStats::net_create_message) {
+      msg = CreateInfoMessage(&cursor, &msg_bytes);
     }
-    updates->AddAllocated(conn_proto);
+    num_chunks++;
+    COUNTER_ADD(CollectorStats::net_message_bytes, msg_bytes);
+
+    ok = WriteMessage(writer, msg, deadline);
   }
-}
 
-void NetworkStatusNotifier::AddContainerEndpoints(::google::protobuf::RepeatedPtrField<sensor::NetworkEndpoint>* updates, const ContainerEndpointMap& delta) {
-  for (const auto& delta_entry : delta) {
-    auto* endpoint_proto = ContainerEndpointToProto(delta_entry.first);
-    if (!delta_entry.second.IsActive()) {
-      *endpoint_proto->mutable_close_timestamp() = google::protobuf::util::TimeUtil::MicrosecondsToTimestamp(
-          delta_entry.second.LastActiveTime());
+  if (resync_buffer_entries_ > 0) {
+    if (conn_delta->size() + cep_delta->size() > resync_buffer_entries_) {
+      unwritten_overflow_ = true;
+    } else {
+      unwritten_conn_deltas_ = std::move(*conn_delta);
+      unwritten_cep_deltas_ = std::move(*cep_delta);
     }
-    updates->AddAllocated(endpoint_proto);
   }
-}
-
-sensor::NetworkConnection* NetworkStatusNotifier::ConnToProto(const Connection& conn) {
-  auto* conn_proto = Allocate<sensor::NetworkConnection>();
-  conn_proto->set_container_id(conn.container());
-  conn_proto->set_role(conn.is_server() ? sensor::ROLE_SERVER : sensor::ROLE_CLIENT);
-  conn_proto->set_protocol(TranslateL4Protocol(conn.l4proto()));
-  conn_proto->set_socket_family(TranslateAddressFamily(conn.local().address().family()));
-  conn_proto->set_allocated_local_address(EndpointToProto(conn.local()));
-  conn_proto->set_allocated_remote_address(EndpointToProto(conn.remote()));
 
-  return conn_proto;
-}
-
-sensor::NetworkEndpoint* NetworkStatusNotifier::ContainerEndpointToProto(const ContainerEndpoint& cep) {
-  auto* endpoint_proto = Allocate<sensor::NetworkEndpoint>();
-  endpoint_proto->set_container_id(cep.container());
-  endpoint_proto->set_protocol(TranslateL4Protocol(cep.l4proto()));
-  endpoint_proto->set_socket_family(TranslateAddressFamily(cep.endpoint().address().family()));
-  endpoint_proto->set_allocated_listen_address(EndpointToProto(cep.endpoint()));
-  if (cep.originator()) {
-    endpoint_proto->set_allocated_originator(ProcessToProto(*cep.originator().get()));
+  if (!ok) {
+    return false;
   }
-  CLOG(DEBUG) << cep;
-
-  return endpoint_proto;
+  COUNTER_ADD(CollectorStats::net_message_chunks, num_chunks);
+  COUNTER_SET(CollectorStats::net_message_chunks_last_cycle, num_chunks);
+  return true;
 }
 
-sensor::NetworkAddress* NetworkStatusNotifier::EndpointToProto(const collector::Endpoint& endpoint) {
-  if (endpoint.IsNull()) {
-    return nullptr;
-  }
+grpc::ByteBuffer NetworkStatusNotifier::CreateInfoMessage(DeltaCursor* cursor, size_t* msg_bytes) {
+  encoder_.Reset();
 
-  // Note: We are sending the address data and network data as separate fields for
-  // backward compatibility, although, network field can handle both.
-  // Sensor tries to match address to known cluster entities. If that fails, it tries
-  // to match the network to known external networks,
+  size_t bytes = 0;
+  auto full = [&]() {
+    size_t num_entries = encoder_.num_entries();
+    if (num_entries == 0) return false;
+    return (max_message_entries_ > 0 && num_entries >= max_message_entries_) ||
+           (max_message_bytes_ > 0 && bytes >= max_message_bytes_);
+  };
 
-  auto* addr_proto = Allocate<sensor::NetworkAddress>();
-  auto addr_length = endpoint.address().length();
-  if (endpoint.network().IsAddress()) {
-    addr_proto->set_address_data(endpoint.address().data(), addr_length);
+  while (cursor->conn_it != cursor->conn_end && !full()) {
+    const auto& delta_entry = *cursor->conn_it++;
+    bytes += encoder_.AddConnection(delta_entry.first, delta_entry.second);
   }
-  if (endpoint.network().bits() > 0) {
-    std::array<uint8_t, Address::kMaxLen + 1> buff;
-    std::memcpy(buff.data(), endpoint.network().address().data(), addr_length);
-    buff[addr_length] = endpoint.network().bits();
-    addr_proto->set_ip_network(buff.data(), addr_length + 1);
-  }
-  addr_proto->set_port(endpoint.port());
 
-  return addr_proto;
-}
-
-storage::NetworkProcessUniqueKey* NetworkStatusNotifier::ProcessToProto(const collector::Process& process) {
-  auto* process_proto = Allocate<storage::NetworkProcessUniqueKey>();
-
-  process_proto->set_process_name(process.comm());
-  process_proto->set_process_exec_file_path(process.exe_path());
-  process_proto->set_process_args(process.args());
+  while (cursor->cep_it != cursor->cep_end && !full()) {
+    const auto& delta_entry = *cursor->cep_it++;
+    CLOG(DEBUG) << delta_entry.first;
+    bytes += encoder_.AddContainerEndpoint(delta_entry.first, delta_entry.second);
+  }
 
-  return process_proto;
+  *msg_bytes = bytes;
+  return encoder_.Finish(CurrentTimeProto());
 }
 
 }  // namespace collector
@@ -24,48 +24,109 @@ You should have received a copy of the GNU General Public License along with thi
 #ifndef COLLECTOR_NETWORKSTATUSNOTIFIER_H
 #define COLLECTOR_NETWORKSTATUSNOTIFIER_H
 
+#include <chrono>
 #include <memory>
 
 #include "CollectorStats.h"
 #include "ConnTracker.h"
+#include "NetworkConnectionInfoEncoder.h"
 #include "NetworkConnectionInfoServiceComm.h"
+#include "NetworkStateCheckpoint.h"
 #include "ProcfsScraper.h"
-#include "ProtoAllocator.h"
+#include "ScrapeScheduler.h"
 #include "StoppableThread.h"
 
 namespace collector {
 
-class NetworkStatusNotifier : protected ProtoAllocator<sensor::NetworkConnectionInfoMessage> {
+// NetworkStatusNotifierOptions are the optional settings of a NetworkStatusNotifier. The defaults disable the
+// respective features.
+struct NetworkStatusNotifierOptions {
+  // If set, the network state is restored from this checkpoint on start, and written to it periodically.
+  std::shared_ptr<NetworkStateCheckpoint> checkpoint;
+  // If set, scrapes are split into slices scheduled by it.
+  std::shared_ptr<ScrapeScheduler> scrape_scheduler;
+  // Maximum number of entries and encoded size of each message sent to Sensor. 0 means unlimited.
+  size_t max_message_entries = 0;
+  size_t max_message_bytes = 0;
+  // Maximum number of deltas that may not have been written when a stream fails, for the next stream to only send what
+  // changed since. 0 disables resync, in which case the full state is sent on every new stream.
+  size_t resync_buffer_entries = 0;
+  // Time to wait before establishing a new stream after the previous one failed.
+  std::chrono::milliseconds reconnect_delay = std::chrono::seconds(10);
+  // Deltas are flushed before the next scrape once at least flush_pending_updates connection updates from events are
+  // pending (if non-zero), or the first pending update is older than flush_max_age (if non-zero). An early flush
+  // happens at least flush_min_interval after the previous flush or scrape.
+  uint64_t flush_pending_updates = 0;
+  std::chrono::milliseconds flush_max_age{0};
+  std::chrono::milliseconds flush_min_interval{0};
+};
+
+class NetworkStatusNotifier {
  public:
   NetworkStatusNotifier(std::shared_ptr<IConnScraper> conn_scraper, int scrape_interval, bool scrape_listen_endpoints, bool turn_off_scrape,
                         std::shared_ptr<ConnectionTracker> conn_tracker, int64_t afterglow_period_micros, bool use_afterglow,
-                        std::shared_ptr<INetworkConnectionInfoServiceComm> comm)
-      : conn_scraper_(conn_scraper), scrape_interval_(scrape_interval), turn_off_scraping_(turn_off_scrape), scrape_listen_endpoints_(scrape_listen_endpoints), conn_tracker_(std::move(conn_tracker)), afterglow_period_micros_(afterglow_period_micros), enable_afterglow_(use_afterglow), comm_(comm) {
+                        std::shared_ptr<INetworkConnectionInfoServiceComm> comm,
+                        const NetworkStatusNotifierOptions& options = NetworkStatusNotifierOptions())
+      : conn_scraper_(conn_scraper), scrape_interval_(scrape_interval), turn_off_scraping_(turn_off_scrape), scrape_listen_endpoints_(scrape_listen_endpoints), conn_tracker_(std::move(conn_tracker)), afterglow_period_micros_(afterglow_period_micros), enable_afterglow_(use_afterglow), comm_(comm), checkpoint_(options.checkpoint), scrape_scheduler_(options.scrape_scheduler), max_message_entries_(options.max_message_entries), max_message_bytes_(options.max_message_bytes), flush_pending_updates_(options.flush_pending_updates), flush_max_age_(options.flush_max_age), flush_min_interval_(options.flush_min_interval), resync_buffer_entries_(options.resync_buffer_entries), reconnect_delay_(options.reconnect_delay) {
   }
 
   void Start();
   void Stop();
 
  private:
-  sensor::NetworkConnectionInfoMessage* CreateInfoMessage(const ConnMap& conn_delta, const ContainerEndpointMap& cep_delta);
-  void AddConnections(::google::protobuf::RepeatedPtrField<sensor::NetworkConnection>* updates, const ConnMap& delta);
-  void AddContainerEndpoints(::google::protobuf::RepeatedPtrField<sensor::NetworkEndpoint>* updates, const ContainerEndpointMap& delta);
-
-  sensor::NetworkConnection* ConnToProto(const Connection& conn);
-  sensor::NetworkEndpoint* ContainerEndpointToProto(const ContainerEndpoint& cep);
-  sensor::NetworkAddress* EndpointToProto(const Endpoint& endpoint);
-  storage::NetworkProcessUniqueKey* ProcessToProto(const collector::Process& process);
+  // DeltaCursor is the position within the connection and endpoint deltas of a scrape cycle, which are sent in chunks.
+  struct DeltaCursor {
+    ConnMap::const_iterator conn_it, conn_end;
+    ContainerEndpointMap::const_iterator cep_it, cep_end;
+
+    bool done() const { return conn_it == conn_end && cep_it == cep_end; }
+  };
+
+  // Creates a serialized message from the deltas at the cursor, and advances the cursor past the added entries. The
+  // message contains at least one entry, at most max_message_entries_ entries (if non-zero), and stops growing once its
+  // encoded size reaches max_message_bytes_ (if non-zero). The encoded size of the entries is stored in *msg_bytes.
+  grpc::ByteBuffer CreateInfoMessage(DeltaCursor* cursor, size_t* msg_bytes);
+  // Sends the given deltas as a sequence of size-bounded messages. Returns false if the stream failed. If resync is
+  // enabled, the deltas that may not have been written on the previous stream are sent along, and the given deltas are
+  // retained until their messages have been written.
+  bool SendDeltas(IDuplexClientWriter<grpc::ByteBuffer>* writer, ConnMap* conn_delta, ContainerEndpointMap* cep_delta,
+                  std::chrono::system_clock::time_point deadline);
 
   void OnRecvControlMessage(const sensor::NetworkFlowsControlMessage* msg);
 
   void Run();
-  void WaitUntilWriterStarted(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer, int wait_time);
-  bool UpdateAllConnsAndEndpoints();
-  void RunSingle(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer);
-  void RunSingleAfterglow(IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>* writer);
+  void WaitUntilWriterStarted(IDuplexClientWriter<grpc::ByteBuffer>* writer, int wait_time);
+  // Scrapes all connections and endpoints and updates the connection tracker. If a scrape scheduler is set, the scrape
+  // is split into slices, and the client is used to sleep between them. Returns false if the scrape failed or the client
+  // was interrupted.
+  bool UpdateAllConnsAndEndpoints(IDuplexClient* client);
+  bool ScrapeSliced(IDuplexClient* client, std::vector<Connection>* all_conns, std::vector<ContainerEndpoint>* all_listen_endpoints);
+  // Returns the time of the first scrape after establishing a stream, which is delayed by the random start offset of
+  // the scrape scheduler when the stream is established for the first time.
+  std::chrono::system_clock::time_point FirstScrapeTime();
+  // Waits until the next scrape is due, or until deltas should be flushed early. Sets *scrape to whether a scrape is due.
+  // Returns false if the stream failed.
+  bool WaitForNextCycle(IDuplexClient* client, std::chrono::system_clock::time_point next_scrape, bool* scrape);
+  bool EarlyFlushDue(std::chrono::system_clock::time_point now) const;
+  // Hands the message to the write stage, which sends it asynchronously while the next scrape is in progress. Waits until
+  // the given deadline for the previous message to be sent first. Returns false if the stream failed.
+  bool WriteMessage(IDuplexClientWriter<grpc::ByteBuffer>* writer, const grpc::ByteBuffer& msg,
+                    std::chrono::system_clock::time_point deadline);
+  void RunSingle(IDuplexClientWriter<grpc::ByteBuffer>* writer);
+  void RunSingleAfterglow(IDuplexClientWriter<grpc::ByteBuffer>* writer);
   void ReceivePublicIPs(const sensor::IPAddressList& public_ips);
   void ReceiveIPNetworks(const sensor::IPNetworkList& networks);
 
+  void RestoreCheckpoint();
+  // Writes a checkpoint of the tracker state and the given reported state, if one is due (or if force is set).
+  void MaybeCheckpoint(const ConnMap& reported_conns, const ContainerEndpointMap& reported_endpoints, int64_t time_at_last_scrape, bool force);
+  // Moves the state restored from a checkpoint or retained from the previous stream (if any) into the given reported
+  // state.
+  void TakeRestoredState(ConnMap* reported_conns, ContainerEndpointMap* reported_endpoints, int64_t* time_at_last_scrape);
+  // Retains the reported state after the stream failed, such that the next stream only sends what changed since, unless
+  // resync is disabled or too many deltas may not have been written.
+  void RetainStateForResync(ConnMap* reported_conns, ContainerEndpointMap* reported_endpoints, int64_t time_at_last_scrape);
+
   StoppableThread thread_;
 
   std::shared_ptr<IConnScraper> conn_scraper_;
@@ -77,6 +138,33 @@ class NetworkStatusNotifier : protected ProtoAllocator<sensor::NetworkConnection
   int64_t afterglow_period_micros_;
   bool enable_afterglow_;
   std::shared_ptr<INetworkConnectionInfoServiceComm> comm_;
+
+  std::shared_ptr<NetworkStateCheckpoint> checkpoint_;
+  std::unique_ptr<NetworkState> restored_state_;
+  int64_t next_checkpoint_micros_ = 0;
+
+  std::shared_ptr<ScrapeScheduler> scrape_scheduler_;
+  bool scraped_once_ = false;
+
+  size_t max_message_entries_;
+  size_t max_message_bytes_;
+  NetworkConnectionInfoEncoder encoder_;
+
+  uint64_t flush_pending_updates_;
+  std::chrono::milliseconds flush_max_age_;
+  std::chrono::milliseconds flush_min_interval_;
+  std::chrono::system_clock::time_point last_flush_;
+
+  size_t resync_buffer_entries_;
+  // Deltas whose messages may not have been written yet. They are sent again on the next stream if the current one
+  // fails, and are dropped once they exceed resync_buffer_entries_.
+  ConnMap unwritten_conn_deltas_;
+  ContainerEndpointMap unwritten_cep_deltas_;
+  bool unwritten_overflow_ = false;
+  // Set when the unwritten deltas are from a previous stream.
+  bool resyncing_ = false;
+
+  std::chrono::milliseconds reconnect_delay_;
 };
 
 }  // namespace collector
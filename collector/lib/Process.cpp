@@ -23,16 +23,20 @@ You should have received a copy of the GNU General Public License along with thi
 
 #include "Process.h"
 
+#include <algorithm>
 #include <chrono>
 
 #include "CollectorStats.h"
+#include "ProcfsScraper.h"
 #include "SysdigService.h"
+#include "Utility.h"
 
 namespace collector {
 
 const std::string Process::NOT_AVAILABLE("N/A");
 
-ProcessStore::ProcessStore(SysdigService* falco_instance) : falco_instance_(falco_instance) {
+ProcessStore::ProcessStore(SysdigService* falco_instance, std::shared_ptr<ProcessScraper> process_scraper)
+    : falco_instance_(falco_instance), process_scraper_(std::move(process_scraper)) {
   cache_ = std::make_shared<std::unordered_map<uint64_t, std::weak_ptr<Process>>>();
 }
 
@@ -49,7 +53,52 @@ const std::shared_ptr<Process> ProcessStore::Fetch(uint64_t pid) {
   return cached_process;
 }
 
+std::vector<std::shared_ptr<Process>> ProcessStore::FetchMany(const std::vector<uint64_t>& pids) {
+  std::vector<std::shared_ptr<Process>> processes(pids.size());
+  std::vector<uint64_t> missing_pids;
+  for (size_t i = 0; i < pids.size(); i++) {
+    auto cached_process_pair_iter = cache_->find(pids[i]);
+    if (cached_process_pair_iter != cache_->end()) {
+      processes[i] = cached_process_pair_iter->second.lock();
+    } else if (process_scraper_) {
+      missing_pids.push_back(pids[i]);
+    }
+  }
+
+  if (!missing_pids.empty()) {
+    std::sort(missing_pids.begin(), missing_pids.end());
+    missing_pids.erase(std::unique(missing_pids.begin(), missing_pids.end()), missing_pids.end());
+
+    std::vector<ProcessInfo> process_infos;
+    process_scraper_->ScrapeMany(missing_pids, &process_infos);
+    COUNTER_ADD(CollectorStats::process_info_procfs, process_infos.size());
+
+    std::unordered_map<uint64_t, std::shared_ptr<Process>> scraped_processes;
+    for (auto& process_info : process_infos) {
+      uint64_t pid = process_info.pid;
+      auto cached_process = std::make_shared<Process>(std::move(process_info), cache_);
+      cache_->emplace(pid, cached_process);
+      scraped_processes.emplace(pid, std::move(cached_process));
+    }
+    for (size_t i = 0; i < pids.size(); i++) {
+      if (processes[i]) continue;
+      auto scraped_process_pair_iter = scraped_processes.find(pids[i]);
+      if (scraped_process_pair_iter != scraped_processes.end()) {
+        processes[i] = scraped_process_pair_iter->second;
+      }
+    }
+  }
+
+  // Processes which are neither known nor could be read from procfs are requested from Falco.
+  for (size_t i = 0; i < pids.size(); i++) {
+    if (!processes[i]) processes[i] = Fetch(pids[i]);
+  }
+  return processes;
+}
+
 std::string Process::container_id() const {
+  if (procfs_info_) return procfs_info_->container_id;
+
   WaitForProcessInfo();
 
   if (falco_threadinfo_) {
@@ -60,6 +109,8 @@ std::string Process::container_id() const {
 }
 
 std::string Process::comm() const {
+  if (procfs_info_) return procfs_info_->comm;
+
   WaitForProcessInfo();
 
   if (falco_threadinfo_) {
@@ -70,6 +121,8 @@ std::string Process::comm() const {
 }
 
 std::string Process::exe() const {
+  if (procfs_info_) return procfs_info_->exe;
+
   WaitForProcessInfo();
 
   if (falco_threadinfo_) {
@@ -80,6 +133,8 @@ std::string Process::exe() const {
 }
 
 std::string Process::exe_path() const {
+  if (procfs_info_) return procfs_info_->exe_path;
+
   WaitForProcessInfo();
 
   if (falco_threadinfo_) {
@@ -90,22 +145,17 @@ std::string Process::exe_path() const {
 }
 
 std::string Process::args() const {
+  if (procfs_info_) return procfs_info_->args;
+
   WaitForProcessInfo();
 
   if (!falco_threadinfo_) {
     return NOT_AVAILABLE;
   }
 
-  if (falco_threadinfo_->m_args.empty()) {
-    return "";
-  }
-
-  std::ostringstream args;
-  for (auto it = falco_threadinfo_->m_args.begin(); it != falco_threadinfo_->m_args.end();) {
-    args << *it++;
-    if (it != falco_threadinfo_->m_args.end()) args << " ";
-  }
-  return args.str();
+  std::string args;
+  JoinProcessArgs(falco_threadinfo_->m_args, &args);
+  return args;
 }
 
 Process::Process(
@@ -124,6 +174,12 @@ Process::Process(
   }
 }
 
+Process::Process(ProcessInfo process_info, ProcessStore::MapRef cache)
+    : pid_(process_info.pid),
+      cache_(cache),
+      process_info_pending_resolution_(false),
+      procfs_info_(new ProcessInfo(std::move(process_info))) {}
+
 Process::~Process() {
   if (cache_) {
     cache_->erase(pid_);
@@ -31,32 +31,52 @@ You should have received a copy of the GNU General Public License along with thi
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 // forward declarations
 class sinsp_threadinfo;
 namespace collector {
 class Process;
+class ProcessScraper;
 class SysdigService;
 }  // namespace collector
 
 namespace collector {
+
+// ProcessInfo is the information about a process read directly from procfs.
+class ProcessInfo {
+ public:
+  std::string container_id;
+  std::string comm;      // binary name
+  std::string exe;       // argv[0]
+  std::string exe_path;  // full binary path
+  std::string args;      // space separated concatenation of arguments
+  uint64_t pid;
+};
+
 /* A Process object store used to deduplicate process information.
    Processes are kept in the store as long as they are referenced from the outside.
    When a process cannot be found in the store, it is fetched as a side-effect. */
 class ProcessStore {
  public:
-  /* falco_instance is the source of process information */
-  ProcessStore(SysdigService* falco_instance);
+  /* falco_instance is the source of process information. If process_scraper is given, processes
+     fetched in bulk are read from procfs instead, and only requested from Falco if that fails. */
+  ProcessStore(SysdigService* falco_instance, std::shared_ptr<ProcessScraper> process_scraper = nullptr);
 
   /* Get a Process by PID.
      Returns a reference to the cached Process entry, which may have just been created
      if it wasn't already known. */
   const std::shared_ptr<Process> Fetch(uint64_t pid);
 
+  /* Get the Processes for the given PIDs, in the same order.
+     Processes not known yet are resolved with a single scrape of the process scraper, if any. */
+  std::vector<std::shared_ptr<Process>> FetchMany(const std::vector<uint64_t>& pids);
+
   typedef std::shared_ptr<std::unordered_map<uint64_t, std::weak_ptr<Process>>> MapRef;
 
  private:
   SysdigService* falco_instance_;
+  std::shared_ptr<ProcessScraper> process_scraper_;
   MapRef cache_;
 };
 
@@ -77,6 +97,8 @@ class Process {
   /* - when 'cache' is provided, this process will remove itself from it upon deletion.
    * - 'falco_instance' is used to request the process information from the system. */
   Process(uint64_t pid, ProcessStore::MapRef cache = 0, SysdigService* falco_instance = 0);
+  /* A process whose information was read from procfs beforehand. */
+  Process(ProcessInfo process_info, ProcessStore::MapRef cache = 0);
   ~Process();
 
  private:
@@ -90,6 +112,9 @@ class Process {
   mutable std::mutex process_info_mutex_;
   mutable std::condition_variable process_info_condition_;
 
+  // Process information read from procfs, if the process was not resolved by Falco
+  std::unique_ptr<const ProcessInfo> procfs_info_;
+
   // Underlying thread info provided asynchronously by Falco via falco_callback_
   mutable std::shared_ptr<sinsp_threadinfo> falco_threadinfo_;
   // use a shared pointer here to handle deletion while the callback is pending
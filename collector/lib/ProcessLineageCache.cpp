@@ -0,0 +1,80 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#include "ProcessLineageCache.h"
+
+#include "CollectorStats.h"
+
+namespace collector {
+
+namespace {
+
+// Maximum number of links from processes to the entries depending on them, per entry.
+constexpr size_t kMaxLinksPerEntry = 16;
+
+}  // namespace
+
+constexpr size_t ProcessLineageCache::kDefaultCapacity;
+
+const ProcessLineageCache::Entry* ProcessLineageCache::Find(int64_t tid, uint64_t clone_ts) const {
+  auto it = entries_.find(tid);
+  if (it == entries_.end() || it->second.clone_ts != clone_ts) {
+    COUNTER_INC(CollectorStats::process_lineage_cache_misses);
+    return nullptr;
+  }
+  COUNTER_INC(CollectorStats::process_lineage_cache_hits);
+  return &it->second;
+}
+
+const ProcessLineageCache::Entry& ProcessLineageCache::Insert(int64_t tid, Entry entry) {
+  if (entries_.size() >= capacity_ || dependents_.size() >= capacity_ * kMaxLinksPerEntry) {
+    Clear();
+  }
+
+  for (int64_t ancestor : entry.ancestors) {
+    dependents_.emplace(ancestor, tid);
+  }
+  Entry& cached = entries_[tid];
+  cached = std::move(entry);
+  COUNTER_SET(CollectorStats::process_lineage_cache_size, entries_.size());
+  return cached;
+}
+
+void ProcessLineageCache::Invalidate(int64_t tid) {
+  entries_.erase(tid);
+  auto range = dependents_.equal_range(tid);
+  for (auto it = range.first; it != range.second; ++it) {
+    entries_.erase(it->second);
+  }
+  dependents_.erase(range.first, range.second);
+  COUNTER_SET(CollectorStats::process_lineage_cache_size, entries_.size());
+}
+
+void ProcessLineageCache::Clear() {
+  entries_.clear();
+  dependents_.clear();
+  COUNTER_SET(CollectorStats::process_lineage_cache_size, 0);
+}
+
+}  // namespace collector
@@ -0,0 +1,76 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#ifndef _PROCESS_LINEAGE_CACHE_H_
+#define _PROCESS_LINEAGE_CACHE_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "storage/process_indicator.pb.h"
+
+namespace collector {
+
+// ProcessLineageCache keeps the lineage of the children of a process, i.e., the lineage obtained by walking up from the
+// process itself, such that it does not need to be computed again for each process started by the same parent.
+// Processes are identified by tid and clone timestamp, such that a reused tid does not hit a stale entry. An entry
+// depends on the state of all processes visited to compute it, and must be invalidated when any of them executes a new
+// program, changes its user (the lineage holds the uid of each ancestor) or exits.
+class ProcessLineageCache {
+ public:
+  using LineageInfo = storage::ProcessSignal_LineageInfo;
+
+  struct Entry {
+    uint64_t clone_ts = 0;
+    std::vector<LineageInfo> lineage;
+    // The tids of the processes whose state the lineage depends on.
+    std::vector<int64_t> ancestors;
+  };
+
+  static constexpr size_t kDefaultCapacity = 4096;
+
+  explicit ProcessLineageCache(size_t capacity = kDefaultCapacity) : capacity_(capacity) {}
+
+  // Returns the entry for the process, or nullptr if there is none.
+  const Entry* Find(int64_t tid, uint64_t clone_ts) const;
+  // Adds the entry for the process, replacing an existing one. Once the capacity is reached, the cache is cleared.
+  const Entry& Insert(int64_t tid, Entry entry);
+  // Removes all entries that depend on the state of the process.
+  void Invalidate(int64_t tid);
+  void Clear();
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  size_t capacity_;
+  std::unordered_map<int64_t, Entry> entries_;
+  // Maps the tid of each process to the entries depending on it. Links to removed entries are only dropped along with
+  // the process, hence the number of links is bounded as well.
+  std::unordered_multimap<int64_t, int64_t> dependents_;
+};
+
+}  // namespace collector
+
+#endif  // _PROCESS_LINEAGE_CACHE_H_
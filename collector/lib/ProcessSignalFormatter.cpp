@@ -23,8 +23,6 @@ You should have received a copy of the GNU General Public License along with thi
 
 #include "ProcessSignalFormatter.h"
 
-#include <uuid/uuid.h>
-
 #include <google/protobuf/util/time_util.h>
 
 #include "internalapi/sensor/signal_iservice.pb.h"
@@ -58,14 +56,58 @@ static EventMap<ProcessSignalType> process_signals = {
     ProcessSignalType::UNKNOWN_PROCESS_TYPE,
 };
 
-string extract_proc_args(sinsp_threadinfo* tinfo) {
-  if (tinfo->m_args.empty()) return "";
-  std::ostringstream args;
-  for (auto it = tinfo->m_args.begin(); it != tinfo->m_args.end();) {
-    args << *it++;
-    if (it != tinfo->m_args.end()) args << " ";
+// Returns whether a process name or path is known, i.e., neither empty nor "<NA>".
+bool IsAvailable(const std::string& value) {
+  return !value.empty() && value != "<NA>";
+}
+
+bool IsAvailable(const std::string* value) {
+  return value && IsAvailable(*value);
+}
+
+// Maximum number of ancestors in the lineage.
+constexpr size_t kMaxLineageSize = 10;
+
+// Adds the process to the lineage, and returns whether the walk up the process tree should continue.
+bool AddToLineage(sinsp_threadinfo* pt, ProcessLineageCache::Entry* entry) {
+  if (pt == NULL) return false;
+  entry->ancestors.push_back(pt->m_tid);
+  if (pt->m_pid == 0) return false;
+
+  //
+  // Collection of process lineage information should stop at the container
+  // boundary to avoid collecting host process information.
+  //
+  // In back-ported eBPF probes, `m_vpid` will not be set for containers
+  // running when collector comes online because /proc/{pid}/status does
+  // not contain namespace information, so `m_container_id` is checked
+  // instead. `m_container_id` is not enough on its own to identify
+  // containerized processes, because it is not guaranteed to be set on
+  // all platforms.
+  //
+  if (pt->m_vpid == 0) {
+    if (pt->m_container_id.empty()) {
+      return false;
+    }
+  } else if (pt->m_pid == pt->m_vpid) {
+    return false;
+  }
+
+  if (pt->m_vpid == -1) return false;
+
+  // Collapse parent child processes that have the same path
+  auto& lineage = entry->lineage;
+  if (lineage.empty() || (lineage.back().parent_exec_file_path() != pt->m_exepath)) {
+    LineageInfo info;
+    info.set_parent_uid(pt->m_user.uid);
+    info.set_parent_exec_file_path(pt->m_exepath);
+    lineage.push_back(info);
   }
-  return args.str();
+
+  // Limit max number of ancestors
+  if (lineage.size() >= kMaxLineageSize) return false;
+
+  return true;
 }
 
 }  // namespace
@@ -77,6 +119,9 @@ const SignalStreamMessage* ProcessSignalFormatter::ToProtoMessage(sinsp_evt* eve
 
   Reset();
 
+  // The process executed a new program, hence the lineage of its descendants changed.
+  lineage_cache_.Invalidate(event->get_tid());
+
   if (!ValidateProcessDetails(event)) {
     CLOG(INFO) << "Dropping process event: " << ProcessDetails(event);
     return nullptr;
@@ -85,13 +130,7 @@ const SignalStreamMessage* ProcessSignalFormatter::ToProtoMessage(sinsp_evt* eve
   ProcessSignal* process_signal = CreateProcessSignal(event);
   if (!process_signal) return nullptr;
 
-  Signal* signal = Allocate<Signal>();
-  signal->set_allocated_process_signal(process_signal);
-
-  SignalStreamMessage* signal_stream_message = AllocateRoot();
-  signal_stream_message->clear_collector_register_request();
-  signal_stream_message->set_allocated_signal(signal);
-  return signal_stream_message;
+  return CreateSignalStreamMessage(process_signal);
 }
 
 const SignalStreamMessage* ProcessSignalFormatter::ToProtoMessage(sinsp_threadinfo* tinfo) {
@@ -104,6 +143,16 @@ const SignalStreamMessage* ProcessSignalFormatter::ToProtoMessage(sinsp_threadin
   ProcessSignal* process_signal = CreateProcessSignal(tinfo);
   if (!process_signal) return nullptr;
 
+  return CreateSignalStreamMessage(process_signal);
+}
+
+const SignalStreamMessage* ProcessSignalFormatter::ToProtoMessage(const ProcessSnapshot& process) {
+  Reset();
+
+  return CreateSignalStreamMessage(CreateProcessSignal(process));
+}
+
+SignalStreamMessage* ProcessSignalFormatter::CreateSignalStreamMessage(ProcessSignal* process_signal) {
   Signal* signal = Allocate<Signal>();
   signal->set_allocated_process_signal(process_signal);
 
@@ -121,18 +170,20 @@ ProcessSignal* ProcessSignalFormatter::CreateProcessSignal(sinsp_evt* event) {
 
   const std::string* name = event_extractor_.get_comm(event);
   const std::string* exepath = event_extractor_.get_exepath(event);
+  bool has_name = IsAvailable(name);
+  bool has_exepath = IsAvailable(exepath);
 
   // set name (if name is missing or empty, try to use exec_file_path)
-  if (name && !name->empty() && *name != "<NA>") {
+  if (has_name) {
     signal->set_name(*name);
-  } else if (exepath && !exepath->empty() && *exepath != "<NA>") {
+  } else if (has_exepath) {
     signal->set_name(*exepath);
   }
 
   // set exec_file_path (if exec_file_path is missing or empty, try to use name)
-  if (exepath && !exepath->empty() && *exepath != "<NA>") {
+  if (has_exepath) {
     signal->set_exec_file_path(*exepath);
-  } else if (name && !name->empty() && *name != "<NA>") {
+  } else if (has_name) {
     signal->set_exec_file_path(*name);
   }
 
@@ -157,13 +208,7 @@ ProcessSignal* ProcessSignalFormatter::CreateProcessSignal(sinsp_evt* event) {
   }
 
   // set process lineage
-  std::vector<LineageInfo> lineage;
-  this->GetProcessLineage(event->get_thread_info(), lineage);
-  for (const auto& p : lineage) {
-    auto signal_lineage = signal->add_lineage_info();
-    signal_lineage->set_parent_exec_file_path(p.parent_exec_file_path());
-    signal_lineage->set_parent_uid(p.parent_uid());
-  }
+  AddLineageInfo(event->get_thread_info(), signal);
 
   CLOG(DEBUG) << "Process (" << signal->pid() << "): " << signal->name() << " " << signal->args();
 
@@ -176,20 +221,22 @@ ProcessSignal* ProcessSignalFormatter::CreateProcessSignal(sinsp_threadinfo* tin
   // set id
   signal->set_id(UUIDStr());
 
-  auto name = tinfo->get_comm();
-  auto exepath = tinfo->m_exepath;
+  const std::string& name = tinfo->m_comm;
+  const std::string& exepath = tinfo->m_exepath;
+  bool has_name = IsAvailable(name);
+  bool has_exepath = IsAvailable(exepath);
 
   // set name (if name is missing or empty, try to use exec_file_path)
-  if (!name.empty() && name != "<NA>") {
+  if (has_name) {
     signal->set_name(name);
-  } else if (!exepath.empty() && exepath != "<NA>") {
+  } else if (has_exepath) {
     signal->set_name(exepath);
   }
 
   // set exec_file_path (if exec_file_path is missing or empty, try to use name)
-  if (!exepath.empty() && exepath != "<NA>") {
+  if (has_exepath) {
     signal->set_exec_file_path(exepath);
-  } else if (!name.empty() && name != "<NA>") {
+  } else if (has_name) {
     signal->set_exec_file_path(name);
   }
 
@@ -197,7 +244,7 @@ ProcessSignal* ProcessSignalFormatter::CreateProcessSignal(sinsp_threadinfo* tin
   signal->set_scraped(true);
 
   // set process arguments
-  signal->set_args(extract_proc_args(tinfo));
+  JoinProcessArgs(tinfo->m_args, signal->mutable_args());
 
   // set pid
   signal->set_pid(tinfo->m_pid);
@@ -215,10 +262,62 @@ ProcessSignal* ProcessSignalFormatter::CreateProcessSignal(sinsp_threadinfo* tin
   signal->set_container_id(tinfo->m_container_id);
 
   // set process lineage
-  std::vector<LineageInfo> lineage;
-  GetProcessLineage(tinfo, lineage);
+  AddLineageInfo(tinfo, signal);
+
+  CLOG(DEBUG) << "Process (" << signal->pid() << "): " << signal->name() << " " << signal->args();
+
+  return signal;
+}
 
-  for (const auto& p : lineage) {
+bool ProcessSignalFormatter::TakeSnapshot(sinsp_threadinfo* tinfo, ProcessSnapshot* snapshot) {
+  if (!ValidateProcessDetails(tinfo)) {
+    CLOG(INFO) << "Dropping process event: " << tinfo;
+    return false;
+  }
+
+  const std::string& name = tinfo->m_comm;
+  const std::string& exepath = tinfo->m_exepath;
+  bool has_name = IsAvailable(name);
+  bool has_exepath = IsAvailable(exepath);
+
+  // name and exec_file_path fall back to each other, as for signals created from threads.
+  if (has_name || has_exepath) {
+    snapshot->name = has_name ? name : exepath;
+    snapshot->exec_file_path = has_exepath ? exepath : name;
+  }
+  JoinProcessArgs(tinfo->m_args, &snapshot->args);
+  snapshot->container_id = tinfo->m_container_id;
+  snapshot->pid = tinfo->m_pid;
+  snapshot->uid = tinfo->m_user.uid;
+  snapshot->gid = tinfo->m_group.gid;
+  snapshot->clone_ts = tinfo->m_clone_ts;
+  if (const auto* lineage = FindProcessLineage(tinfo)) {
+    snapshot->lineage = *lineage;
+  }
+
+  return true;
+}
+
+ProcessSignal* ProcessSignalFormatter::CreateProcessSignal(const ProcessSnapshot& process) {
+  auto signal = Allocate<ProcessSignal>();
+
+  signal->set_id(UUIDStr());
+  signal->set_name(process.name);
+  signal->set_exec_file_path(process.exec_file_path);
+  signal->set_scraped(true);
+  signal->set_args(process.args);
+  signal->set_pid(process.pid);
+  signal->set_uid(process.uid);
+  signal->set_gid(process.gid);
+
+  auto timestamp = Allocate<Timestamp>();
+  *timestamp = TimeUtil::NanosecondsToTimestamp(process.clone_ts);
+  signal->set_allocated_time(timestamp);
+
+  signal->set_container_id(process.container_id);
+
+  signal->mutable_lineage_info()->Reserve(process.lineage.size());
+  for (const auto& p : process.lineage) {
     auto signal_lineage = signal->add_lineage_info();
     signal_lineage->set_parent_exec_file_path(p.parent_exec_file_path());
     signal_lineage->set_parent_uid(p.parent_uid());
@@ -230,7 +329,7 @@ ProcessSignal* ProcessSignalFormatter::CreateProcessSignal(sinsp_threadinfo* tin
 }
 
 bool ProcessSignalFormatter::ValidateProcessDetails(sinsp_threadinfo* tinfo) {
-  if (tinfo->m_exepath == "<NA>" && tinfo->get_comm() == "<NA>") {
+  if (tinfo->m_exepath == "<NA>" && tinfo->m_comm == "<NA>") {
     return false;
   }
 
@@ -267,7 +366,7 @@ bool ProcessSignalFormatter::ValidateProcessDetails(sinsp_evt* event) {
 
 int ProcessSignalFormatter::GetTotalStringLength(const std::vector<LineageInfo>& lineage) {
   int totalStringLength = 0;
-  for (LineageInfo l : lineage) totalStringLength += l.parent_exec_file_path().size();
+  for (const LineageInfo& l : lineage) totalStringLength += l.parent_exec_file_path().size();
 
   return totalStringLength;
 }
@@ -282,54 +381,76 @@ void ProcessSignalFormatter::CountLineage(const std::vector<LineageInfo>& lineag
 
 void ProcessSignalFormatter::GetProcessLineage(sinsp_threadinfo* tinfo,
                                                std::vector<LineageInfo>& lineage) {
-  if (tinfo == NULL) return;
+  if (const auto* process_lineage = FindProcessLineage(tinfo)) {
+    lineage.insert(lineage.end(), process_lineage->begin(), process_lineage->end());
+  }
+}
+
+void ProcessSignalFormatter::AddLineageInfo(sinsp_threadinfo* tinfo, ProcessSignal* signal) {
+  const auto* lineage = FindProcessLineage(tinfo);
+  if (lineage == NULL) return;
+
+  signal->mutable_lineage_info()->Reserve(lineage->size());
+  for (const auto& p : *lineage) {
+    auto signal_lineage = signal->add_lineage_info();
+    signal_lineage->set_parent_exec_file_path(p.parent_exec_file_path());
+    signal_lineage->set_parent_uid(p.parent_uid());
+  }
+}
+
+const std::vector<LineageInfo>* ProcessSignalFormatter::FindProcessLineage(sinsp_threadinfo* tinfo) {
+  static const std::vector<LineageInfo> kEmptyLineage;
+
+  if (tinfo == NULL) return NULL;
   sinsp_threadinfo* mt = NULL;
   if (tinfo->is_main_thread()) {
     mt = tinfo;
   } else {
     mt = tinfo->get_main_thread();
-    if (mt == NULL) return;
+    if (mt == NULL) return NULL;
   }
-  sinsp_threadinfo::visitor_func_t visitor = [this, &lineage](sinsp_threadinfo* pt) {
-    if (pt == NULL) return false;
-    if (pt->m_pid == 0) return false;
-
-    //
-    // Collection of process lineage information should stop at the container
-    // boundary to avoid collecting host process information.
-    //
-    // In back-ported eBPF probes, `m_vpid` will not be set for containers
-    // running when collector comes online because /proc/{pid}/status does
-    // not contain namespace information, so `m_container_id` is checked
-    // instead. `m_container_id` is not enough on its own to identify
-    // containerized processes, because it is not guaranteed to be set on
-    // all platforms.
-    //
-    if (pt->m_vpid == 0) {
-      if (pt->m_container_id.empty()) {
-        return false;
-      }
-    } else if (pt->m_pid == pt->m_vpid) {
-      return false;
-    }
 
-    if (pt->m_vpid == -1) return false;
+  const std::vector<LineageInfo>* lineage = &kEmptyLineage;
+  sinsp_threadinfo* pt = mt->get_parent_thread();
+  if (pt != NULL && pt->m_tid != -1) {
+    lineage = &GetChildLineage(pt).lineage;
+  }
+  CountLineage(*lineage);
+  return lineage;
+}
 
-    // Collapse parent child processes that have the same path
-    if (lineage.empty() || (lineage.back().parent_exec_file_path() != pt->m_exepath)) {
-      LineageInfo info;
-      info.set_parent_uid(pt->m_user.uid);
-      info.set_parent_exec_file_path(pt->m_exepath);
-      lineage.push_back(info);
+const ProcessLineageCache::Entry& ProcessSignalFormatter::GetChildLineage(sinsp_threadinfo* pt) {
+  if (const auto* cached = lineage_cache_.Find(pt->m_tid, pt->m_clone_ts)) {
+    return *cached;
+  }
+
+  ProcessLineageCache::Entry entry;
+  entry.clone_ts = pt->m_clone_ts;
+  if (AddToLineage(pt, &entry)) {
+    // If the lineage of the parent's children is known, only this process needs to be prepended to it.
+    sinsp_threadinfo* gpt = pt->get_parent_thread();
+    const ProcessLineageCache::Entry* parent_entry = NULL;
+    if (gpt != NULL && gpt != pt && gpt->m_tid != -1) {
+      parent_entry = lineage_cache_.Find(gpt->m_tid, gpt->m_clone_ts);
     }
 
-    // Limit max number of ancestors
-    if (lineage.size() >= 10) return false;
+    if (parent_entry) {
+      for (const auto& info : parent_entry->lineage) {
+        if (entry.lineage.size() >= kMaxLineageSize) break;
+        if (info.parent_exec_file_path() != entry.lineage.back().parent_exec_file_path()) {
+          entry.lineage.push_back(info);
+        }
+      }
+      entry.ancestors.insert(entry.ancestors.end(), parent_entry->ancestors.begin(), parent_entry->ancestors.end());
+    } else {
+      sinsp_threadinfo::visitor_func_t visitor = [&entry](sinsp_threadinfo* ancestor) {
+        return AddToLineage(ancestor, &entry);
+      };
+      pt->traverse_parent_state(visitor);
+    }
+  }
 
-    return true;
-  };
-  mt->traverse_parent_state(visitor);
-  CountLineage(lineage);
+  return lineage_cache_.Insert(pt->m_tid, std::move(entry));
 }
 
 }  // namespace collector
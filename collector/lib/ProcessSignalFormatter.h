@@ -30,6 +30,7 @@ You should have received a copy of the GNU General Public License along with thi
 
 #include "CollectorStats.h"
 #include "EventNames.h"
+#include "ProcessLineageCache.h"
 #include "ProtoSignalFormatter.h"
 #include "SysdigEventExtractor.h"
 
@@ -48,7 +49,29 @@ class ProcessSignalFormatter : public ProtoSignalFormatter<sensor::SignalStreamM
   const sensor::SignalStreamMessage* ToProtoMessage(sinsp_evt* event) override;
   const sensor::SignalStreamMessage* ToProtoMessage(sinsp_threadinfo* tinfo);
 
+  // The fields of an existing process' signal, copied out of the thread table such that the signal can be formatted
+  // later, without access to the thread.
+  struct ProcessSnapshot {
+    std::string name;
+    std::string exec_file_path;
+    std::string args;
+    std::string container_id;
+    int64_t pid = 0;
+    uint32_t uid = 0;
+    uint32_t gid = 0;
+    uint64_t clone_ts = 0;
+    std::vector<LineageInfo> lineage;
+  };
+
+  // Copies the fields of the given process into snapshot. Returns false if the process has to be dropped.
+  bool TakeSnapshot(sinsp_threadinfo* tinfo, ProcessSnapshot* snapshot);
+  const sensor::SignalStreamMessage* ToProtoMessage(const ProcessSnapshot& process);
+
   void GetProcessLineage(sinsp_threadinfo* tinfo, std::vector<LineageInfo>& lineage);
+  // Drops the cached lineage depending on the given thread, which has exited.
+  void HandleProcessExit(int64_t tid) { lineage_cache_.Invalidate(tid); }
+  // Drops the cached lineage depending on the given thread, whose user changed, as it holds the former uid.
+  void HandleUserChange(int64_t tid) { lineage_cache_.Invalidate(tid); }
 
  private:
   Signal* CreateSignal(sinsp_evt* event);
@@ -58,12 +81,21 @@ class ProcessSignalFormatter : public ProtoSignalFormatter<sensor::SignalStreamM
 
   Signal* CreateSignal(sinsp_threadinfo* tinfo);
   ProcessSignal* CreateProcessSignal(sinsp_threadinfo* tinfo);
+  ProcessSignal* CreateProcessSignal(const ProcessSnapshot& process);
+  sensor::SignalStreamMessage* CreateSignalStreamMessage(ProcessSignal* process_signal);
   bool ValidateProcessDetails(sinsp_threadinfo* tinfo);
   int GetTotalStringLength(const std::vector<LineageInfo>& lineage);
   void CountLineage(const std::vector<LineageInfo>& lineage);
+  // Returns the lineage of the given thread's process without copying it, or NULL if its main thread is unknown.
+  // The result is only valid until the lineage cache is next modified.
+  const std::vector<LineageInfo>* FindProcessLineage(sinsp_threadinfo* tinfo);
+  void AddLineageInfo(sinsp_threadinfo* tinfo, ProcessSignal* signal);
+  // Returns the lineage of the children of the given process.
+  const ProcessLineageCache::Entry& GetChildLineage(sinsp_threadinfo* pt);
 
   const EventNames& event_names_;
   SysdigEventExtractor event_extractor_;
+  ProcessLineageCache lineage_cache_;
 };
 
 }  // namespace collector
@@ -23,83 +23,195 @@ You should have received a copy of the GNU General Public License along with thi
 
 #include "ProcessSignalHandler.h"
 
-#include <sstream>
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <initializer_list>
 
 #include "storage/process_indicator.pb.h"
 
+#include "EventNames.h"
+#include "Logging.h"
 #include "RateLimit.h"
 
 namespace collector {
 
-std::string compute_process_key(const ::storage::ProcessSignal& s) {
-  std::stringstream ss;
-  ss << s.container_id() << " " << s.name() << " ";
-  if (s.args().length() <= 256) {
-    ss << s.args();
-  } else {
-    ss.write(s.args().c_str(), 256);
+namespace {
+
+// How long sending existing processes pauses when the send queue is half full.
+constexpr std::chrono::milliseconds kExistingProcessesPause(10);
+
+using EventSet = std::bitset<PPM_EVENT_MAX>;
+
+EventSet GetEventSet(std::initializer_list<const char*> names) {
+  const EventNames& event_names = EventNames::GetInstance();
+  EventSet events;
+  for (const char* name : names) {
+    for (ppm_event_type event_id : event_names.GetEventIDs(name)) {
+      events.set(event_id);
+    }
   }
-  ss << " " << s.exec_file_path();
-  return ss.str();
+  return events;
+}
+
+// A name may resolve to several event types, e.g., "procexit" to the exit events of all driver versions.
+const EventSet& ProcessExitEvents() {
+  static const EventSet events = GetEventSet({"procexit"});
+  return events;
+}
+
+const EventSet& UserChangeEvents() {
+  static const EventSet events = GetEventSet({"setuid<", "setresuid<"});
+  return events;
+}
+
+}  // namespace
+
+uint64_t compute_process_key(const ::storage::ProcessSignal& s) {
+  RateLimitKeyHasher hasher;
+  hasher.Add(s.container_id()).Add(s.name());
+  hasher.Add(s.args().data(), std::min<size_t>(s.args().length(), 256));
+  hasher.Add(s.exec_file_path());
+  return hasher.key();
 }
 
 bool ProcessSignalHandler::Start() {
-  client_.Start();
+  {
+    std::lock_guard<std::mutex> lock(existing_mutex_);
+    stopping_ = false;
+  }
+  client_->Start();
+  existing_thread_.Start([this] { SendExistingProcesses(); });
   return true;
 }
 
 bool ProcessSignalHandler::Stop() {
-  client_.Stop();
+  {
+    std::lock_guard<std::mutex> lock(existing_mutex_);
+    stopping_ = true;
+  }
+  existing_cond_.notify_one();
+  existing_thread_.Stop();
+  client_->Stop();
+
+  std::lock_guard<std::mutex> lock(send_mutex_);
   rate_limiter_.ResetRateLimitCache();
   return true;
 }
 
 SignalHandler::Result ProcessSignalHandler::HandleSignal(sinsp_evt* evt) {
+  uint16_t type = evt->get_type();
+  if (ProcessExitEvents().test(type)) {
+    formatter_.HandleProcessExit(evt->get_tid());
+    return IGNORED;
+  }
+  if (UserChangeEvents().test(type)) {
+    formatter_.HandleUserChange(evt->get_tid());
+    return IGNORED;
+  }
+
+  if (TakeRefreshRequest()) {
+    return NEEDS_REFRESH;
+  }
+
   const auto* signal_msg = formatter_.ToProtoMessage(evt);
   if (!signal_msg) {
     ++(stats_->nProcessResolutionFailuresByEvt);
     return IGNORED;
   }
 
-  if (!rate_limiter_.Allow(compute_process_key(signal_msg->signal().process_signal()))) {
-    ++(stats_->nProcessRateLimitCount);
+  return SendSignal(*signal_msg);
+}
+
+SignalHandler::Result ProcessSignalHandler::HandleExistingProcess(sinsp_threadinfo* tinfo) {
+  ProcessSnapshot process;
+  if (!formatter_.TakeSnapshot(tinfo, &process)) {
+    ++(stats_->nProcessResolutionFailuresByTinfo);
     return IGNORED;
   }
 
-  auto result = client_.PushSignals(*signal_msg);
-  if (result == SignalHandler::PROCESSED) {
-    ++(stats_->nProcessSent);
-  } else if (result == SignalHandler::ERROR) {
-    ++(stats_->nProcessSendFailures);
+  snapshot_.push_back(std::move(process));
+  return PROCESSED;
+}
+
+void ProcessSignalHandler::FinishExistingProcesses() {
+  CLOG(INFO) << "Sending " << snapshot_.size() << " existing processes";
+  {
+    std::lock_guard<std::mutex> lock(existing_mutex_);
+    // A snapshot that has not been sent yet is outdated.
+    pending_snapshot_.swap(snapshot_);
+    has_pending_snapshot_ = true;
   }
+  existing_cond_.notify_one();
+  snapshot_.clear();
+}
 
-  return result;
+void ProcessSignalHandler::SendExistingProcesses() {
+  std::vector<ProcessSnapshot> processes;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(existing_mutex_);
+      existing_cond_.wait(lock, [this]() { return has_pending_snapshot_ || stopping_; });
+      if (stopping_) {
+        return;
+      }
+      processes.swap(pending_snapshot_);
+      pending_snapshot_.clear();
+      has_pending_snapshot_ = false;
+    }
+
+    for (const auto& process : processes) {
+      if (!WaitForQueueSpace()) break;
+
+      auto result = SendSignal(*existing_formatter_.ToProtoMessage(process));
+      if (result == NEEDS_REFRESH) {
+        // The stream was re-established, hence all existing processes need to be sent again.
+        refresh_requested_.store(true, std::memory_order_relaxed);
+        break;
+      }
+      if (result == ERROR) {
+        CLOG(WARNING) << "Failed to write existing process signals";
+        break;
+      }
+    }
+    processes.clear();
+  }
 }
 
-SignalHandler::Result ProcessSignalHandler::HandleExistingProcess(sinsp_threadinfo* tinfo) {
-  const auto* signal_msg = formatter_.ToProtoMessage(tinfo);
-  if (!signal_msg) {
-    ++(stats_->nProcessResolutionFailuresByTinfo);
-    return IGNORED;
+// Existing processes are only sent while the send queue is less than half full, such that they leave room for
+// signals of new processes. Returns false if sending has to stop, because a newer snapshot is pending or the handler
+// is stopping.
+bool ProcessSignalHandler::WaitForQueueSpace() {
+  size_t max_queued = std::max<size_t>(client_->max_queue_size() / 2, 1);
+  while (client_->queued_signals() >= max_queued) {
+    if (!existing_thread_.Pause(kExistingProcessesPause)) return false;
   }
 
-  if (!rate_limiter_.Allow(compute_process_key(signal_msg->signal().process_signal()))) {
+  std::lock_guard<std::mutex> lock(existing_mutex_);
+  return !has_pending_snapshot_ && !stopping_;
+}
+
+SignalHandler::Result ProcessSignalHandler::SendSignal(const sensor::SignalStreamMessage& msg) {
+  std::lock_guard<std::mutex> lock(send_mutex_);
+
+  if (!rate_limiter_.Allow(compute_process_key(msg.signal().process_signal()))) {
     ++(stats_->nProcessRateLimitCount);
     return IGNORED;
   }
 
-  auto result = client_.PushSignals(*signal_msg);
+  auto result = client_->PushSignals(msg);
   if (result == SignalHandler::PROCESSED) {
     ++(stats_->nProcessSent);
   } else if (result == SignalHandler::ERROR) {
     ++(stats_->nProcessSendFailures);
   }
+  stats_->nProcessSendQueueDrops = client_->dropped_signals();
 
   return result;
 }
 
 std::vector<std::string> ProcessSignalHandler::GetRelevantEvents() {
-  return {"execve<"};
+  return {"execve<", "procexit", "setuid<", "setresuid<"};
 }
 
 }  // namespace collector
@@ -24,7 +24,11 @@ You should have received a copy of the GNU General Public License along with thi
 #ifndef __PROCESS_SIGNAL_HANDLER_H__
 #define __PROCESS_SIGNAL_HANDLER_H__
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "libsinsp/sinsp.h"
 
@@ -34,27 +38,64 @@ You should have received a copy of the GNU General Public License along with thi
 #include "RateLimit.h"
 #include "SignalHandler.h"
 #include "SignalServiceClient.h"
+#include "StoppableThread.h"
 #include "SysdigService.h"
+#include "Utility.h"
 
 namespace collector {
 
 class ProcessSignalHandler : public SignalHandler {
  public:
-  ProcessSignalHandler(sinsp* inspector, std::shared_ptr<grpc::Channel> channel, SysdigStats* stats)
-      : client_(std::move(channel)), formatter_(inspector), stats_(stats) {}
+  ProcessSignalHandler(sinsp* inspector, std::shared_ptr<grpc::Channel> channel, SysdigStats* stats,
+                       grpc_compression_algorithm compression = GRPC_COMPRESS_NONE,
+                       size_t max_queue_size = SignalServiceClient::kDefaultMaxQueueSize,
+                       SignalServiceClient::OverflowPolicy overflow_policy = SignalServiceClient::OverflowPolicy::DROP_OLDEST)
+      : ProcessSignalHandler(inspector, MakeUnique<SignalServiceClient>(std::move(channel), compression, max_queue_size, overflow_policy), stats) {}
+
+  ProcessSignalHandler(sinsp* inspector, std::unique_ptr<ISignalServiceClient> client, SysdigStats* stats)
+      : client_(std::move(client)), formatter_(inspector), stats_(stats), refresh_requested_(false), existing_formatter_(inspector) {}
 
   bool Start() override;
   bool Stop() override;
   Result HandleSignal(sinsp_evt* evt) override;
   Result HandleExistingProcess(sinsp_threadinfo* tinfo) override;
+  void FinishExistingProcesses() override;
   std::string GetName() override { return "ProcessSignalHandler"; }
   std::vector<std::string> GetRelevantEvents() override;
 
+ protected:
+  // Returns whether existing processes need to be sent again, and clears the request.
+  bool TakeRefreshRequest() { return refresh_requested_.exchange(false, std::memory_order_relaxed); }
+
  private:
-  SignalServiceClient client_;
+  using ProcessSnapshot = ProcessSignalFormatter::ProcessSnapshot;
+
+  Result SendSignal(const sensor::SignalStreamMessage& msg);
+  void SendExistingProcesses();
+  bool WaitForQueueSpace();
+
+  std::unique_ptr<ISignalServiceClient> client_;
   ProcessSignalFormatter formatter_;
   SysdigStats* stats_;
+
+  // Guards the rate limiter and the send statistics, which are shared with the existing processes thread.
+  std::mutex send_mutex_;
   RateLimitCache rate_limiter_;
+
+  // Set when the stream was re-established while existing processes were being sent, such that the next event
+  // triggers another snapshot.
+  std::atomic<bool> refresh_requested_;
+
+  // Existing processes are snapshotted by the event thread, then formatted and sent by existing_thread_, paced by the
+  // send queue.
+  std::vector<ProcessSnapshot> snapshot_;
+  ProcessSignalFormatter existing_formatter_;
+  StoppableThread existing_thread_;
+  std::mutex existing_mutex_;
+  std::condition_variable existing_cond_;
+  std::vector<ProcessSnapshot> pending_snapshot_;
+  bool has_pending_snapshot_ = false;
+  bool stopping_ = false;
 };
 
 }  // namespace collector
@@ -23,20 +23,30 @@ You should have received a copy of the GNU General Public License along with thi
 
 #include "ProcfsScraper.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cerrno>
 #include <cinttypes>
 #include <cstring>
 #include <fcntl.h>
+#include <iterator>
+#include <unistd.h>
 
 #include <netinet/tcp.h>
+#include <sys/syscall.h>
 
+#include "CollectorStats.h"
 #include "Containers.h"
 #include "FileSystem.h"
 #include "Hash.h"
+#include "HexDecode.h"
 #include "Logging.h"
 #include "ProcfsScraper_internal.h"
+#include "SockDiag.h"
 #include "StringView.h"
 #include "Utility.h"
+#include "WorkerPool.h"
 
 namespace collector {
 
@@ -124,27 +134,98 @@ class SocketInfo {
   uint64_t pid_;
 };
 
-// GetSocketINodes returns a list of all socket inodes associated with open file descriptors of the process represented
-// by dirfd.
-bool GetSocketINodes(int dirfd, uint64_t pid, UnorderedSet<SocketInfo>* sock_inodes) {
-  DirHandle fd_dir = FDHandle(openat(dirfd, "fd", O_RDONLY));
+// Size of the per-thread buffer for reading fd directories with getdents64, which fits several thousand entries.
+constexpr size_t kDirentBufferSize = 64 * 1024;
+
+// LinuxDirent64 is the layout of the records returned by the getdents64 system call.
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[1];  // null-terminated, of variable length
+};
+
+// FDWalkStats counts the file descriptors visited by GetSocketINodes.
+struct FDWalkStats {
+  size_t resolved = 0;  // fds whose link was read
+  size_t skipped = 0;   // fds known not to refer to sockets
+};
+
+// GetSocketINodes adds the socket inodes associated with open file descriptors of the process represented by dirfd to
+// sock_inodes. The fd directory is listed with getdents64 into a large per-thread buffer, and only the links of fds
+// not contained in known_non_socket_fds (if given) are read. The fds not referring to sockets, including the skipped
+// ones, are stored in non_socket_fds, if given. Both lists are in ascending order.
+bool GetSocketINodes(int dirfd, uint64_t pid, const std::vector<int>* known_non_socket_fds,
+                     std::vector<int>* non_socket_fds, FDWalkStats* stats, UnorderedSet<SocketInfo>* sock_inodes) {
+  FDHandle fd_dir = openat(dirfd, "fd", O_RDONLY | O_DIRECTORY);
   if (!fd_dir.valid()) {
     CLOG(ERROR) << "could not open fd directory";
     return false;
   }
 
-  while (auto curr = fd_dir.read()) {
-    if (!std::isdigit(curr->d_name[0])) continue;  // only look at fd entries, ignore '.' and '..'.
-
-    ino_t inode;
-    if (!ReadINode(fd_dir.fd(), curr->d_name, "socket", &inode)) continue;  // ignore non-socket fds
+  thread_local std::vector<char> buffer(kDirentBufferSize);
+  for (;;) {
+    long nread = syscall(SYS_getdents64, fd_dir.get(), buffer.data(), buffer.size());
+    if (nread < 0) {
+      CLOG(ERROR) << "could not read fd directory: " << StrError();
+      return false;
+    }
+    if (nread == 0) break;
+
+    for (long pos = 0; pos < nread;) {
+      const auto* entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + pos);
+      pos += entry->d_reclen;
+      if (!std::isdigit(entry->d_name[0])) continue;  // only look at fd entries, ignore '.' and '..'.
+
+      int fd = static_cast<int>(strtol(entry->d_name, nullptr, 10));
+      if (known_non_socket_fds && std::binary_search(known_non_socket_fds->begin(), known_non_socket_fds->end(), fd)) {
+        stats->skipped++;
+        if (non_socket_fds) non_socket_fds->push_back(fd);
+        continue;
+      }
 
-    sock_inodes->emplace(inode, pid);
+      stats->resolved++;
+      ino_t inode;
+      if (ReadINode(fd_dir, entry->d_name, "socket", &inode)) {
+        sock_inodes->emplace(inode, pid);
+      } else if (non_socket_fds) {
+        non_socket_fds->push_back(fd);
+      }
+    }
   }
 
+  // procfs lists fds in ascending order, so this is usually a no-op.
+  if (non_socket_fds && !std::is_sorted(non_socket_fds->begin(), non_socket_fds->end())) {
+    std::sort(non_socket_fds->begin(), non_socket_fds->end());
+  }
   return true;
 }
 
+// GetStartTime reads the start time (in clock ticks after boot) of the process represented by dirfd from its stat
+// file.
+bool GetStartTime(int dirfd, uint64_t* starttime) {
+  FDHandle stat_fd = openat(dirfd, "stat", O_RDONLY);
+  if (!stat_fd.valid()) return false;
+
+  char buf[512];
+  ssize_t nread = read(stat_fd, buf, sizeof(buf) - 1);
+  if (nread <= 0) return false;
+  buf[nread] = '\0';
+
+  // The command name (field 2) is enclosed in parentheses and may itself contain spaces and parentheses, hence start
+  // after the last closing parenthesis, which is followed by field 3.
+  const char* p = strrchr(buf, ')');
+  if (!p || *++p != ' ') return false;
+  p = rep_nextfield(19, p + 1, buf + nread);
+  if (!p) return false;
+
+  // 22: starttime
+  char* endp;
+  *starttime = strtoull(p, &endp, 10);
+  return endp != p;
+}
+
 // IsContainerID returns whether the given string view represents a container ID.
 bool IsContainerID(StringView str) {
   if (str.size() != 64) return false;
@@ -154,67 +235,119 @@ bool IsContainerID(StringView str) {
   return true;
 }
 
-// GetContainerID retrieves the container ID of the process represented by dirfd. The container ID is extracted from
-// the cgroup.
-bool GetContainerID(int dirfd, std::string* container_id) {
-  FileHandle cgroups_file(FDHandle(openat(dirfd, "cgroup", O_RDONLY)), "r");
-  if (!cgroups_file.valid()) return false;
-
-  thread_local char* linebuf;
-  thread_local size_t linebuf_cap;
-
-  ssize_t line_len;
-  while ((line_len = getline(&linebuf, &linebuf_cap, cgroups_file.get())) != -1) {
-    if (!line_len) continue;
-    if (linebuf[line_len - 1] == '\n') line_len--;
+// Initial size of the buffer for reading `cgroup` files, which is grown as needed.
+constexpr size_t kCgroupBufferSize = 4096;
 
-    StringView line(linebuf, line_len);
-    auto short_container_id = ExtractContainerID(line);
-    if (!short_container_id) continue;
+// ReadCgroupFile reads the entire `cgroup` file of the process represented by dirfd into the given (reusable) buffer.
+bool ReadCgroupFile(int dirfd, std::vector<char>* buffer, StringView* contents) {
+  FDHandle cgroup_fd = openat(dirfd, "cgroup", O_RDONLY);
+  if (!cgroup_fd.valid()) return false;
 
-    *container_id = short_container_id.str();
-    return true;
+  if (buffer->size() < kCgroupBufferSize) {
+    buffer->resize(kCgroupBufferSize);
+  }
+  size_t len = 0;
+  for (;;) {
+    ssize_t nread = read(cgroup_fd, buffer->data() + len, buffer->size() - len);
+    if (nread < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    if (nread == 0) break;
+    len += nread;
+    if (len == buffer->size()) {
+      buffer->resize(2 * buffer->size());
+    }
   }
 
-  return false;
+  *contents = StringView(buffer->data(), len);
+  return true;
 }
 
-// Functions for parsing `net/tcp[6]` files
+// UnifiedCgroupPath returns the cgroup path of a process if the given `cgroup` file contents only list the unified
+// hierarchy (i.e., `0::<path>`, on pure cgroup v2 hosts), and an empty view otherwise.
+StringView UnifiedCgroupPath(StringView contents) {
+  if (contents.size() < 4 || contents[0] != '0' || contents[1] != ':' || contents[2] != ':') return {};
 
-// IsHexChar checks if the given character is an (uppercase) hexadecimal character.
-bool IsHexChar(char c) {
-  if (std::isdigit(c)) return true;
-  return c >= 'A' && c <= 'F';
+  auto eol = contents.find('\n');
+  if (eol != StringView::npos && eol != contents.size() - 1) return {};
+  return contents.substr(3, eol == StringView::npos ? StringView::npos : eol - 3);
 }
 
-// HexCharToVal returns the numeric value of a single (uppercase) hexadecimal digit.
-unsigned char HexCharToVal(char c) {
-  if (std::isdigit(c)) return c - '0';
-  return 10 + (c - 'A');
+// ExtractContainerIDFromCgroups tries to extract a container ID from any of the lines of a `cgroup` file.
+StringView ExtractContainerIDFromCgroups(StringView contents) {
+  while (contents) {
+    auto eol = contents.find('\n');
+    auto container_id = ExtractContainerID(contents.substr(0, eol));
+    if (container_id) return container_id;
+    if (eol == StringView::npos) break;
+    contents.remove_prefix(eol + 1);
+  }
+  return {};
 }
 
-// ReadHexBytes reads bytes in (uppercase) hexadecimal representation into buf. It does so in chunks of size chunk_size.
-// If reverse is true, the individual chunks are reversed (however, not the entire sequence of bytes). The return value
-// is the number of *bytes* read from the input (i.e., to correctly advance p after reading, it has to be incremented
-// by twice the return value).
-int ReadHexBytes(const char* p, const char* endp, void* buf, int chunk_size, int num_chunks, bool reverse) {
-  int i = 0;
-  int num_bytes = chunk_size * num_chunks;
-  auto bbuf = static_cast<uint8_t*>(buf);
+}  // namespace
+
+bool GetContainerID(int dirfd, ContainerIDCache* cache, std::string* container_id, std::string* cgroup_key) {
+  thread_local std::vector<char> buffer;
+  thread_local std::string key;
 
-  for (; i < num_bytes && p < endp - 2; i++) {
-    char high = *p++;
-    char low = *p++;
-    if (!IsHexChar(high) || !IsHexChar(low)) break;
-    *bbuf++ = HexCharToVal(high) << 4 | HexCharToVal(low);
+  StringView contents;
+  if (!ReadCgroupFile(dirfd, &buffer, &contents)) return false;
 
-    if (reverse && i % chunk_size == chunk_size - 1) {
-      // Reverse current chunk
-      std::reverse(bbuf - chunk_size, bbuf);
+  // On cgroup v2, the file consists of a single line with the cgroup path, which is all that needs to be looked at.
+  StringView unified_path = UnifiedCgroupPath(contents);
+
+  if (cache) {
+    StringView cache_key = unified_path ? unified_path : contents;
+    key.assign(cache_key.begin(), cache_key.size());
+    if (cgroup_key) *cgroup_key = key;
+    if (cache->Lookup(key, container_id)) {
+      return !container_id->empty();
     }
   }
 
-  return i;
+  StringView short_container_id = unified_path ? ExtractContainerID(contents.substr(0, 3 + unified_path.size()))
+                                               : ExtractContainerIDFromCgroups(contents);
+  if (cache) {
+    cache->Insert(key, short_container_id);
+  }
+  if (!short_container_id) return false;
+
+  *container_id = short_container_id.str();
+  return true;
+}
+
+namespace {
+
+// Functions for parsing `net/tcp[6]` files
+
+// HexCharToVal returns the numeric value of a single (uppercase) hexadecimal digit, or -1 if c is not one.
+int HexCharToVal(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'A' && c <= 'F') return 10 + (c - 'A');
+  return -1;
+}
+
+// ReadHexU16 reads a 16-bit value represented by 4 (uppercase) hexadecimal digits.
+bool ReadHexU16(const char* p, uint16_t* value) {
+  uint16_t result = 0;
+  for (int i = 0; i < 4; i++) {
+    int digit = HexCharToVal(p[i]);
+    if (digit < 0) return false;
+    result = result << 4 | digit;
+  }
+  *value = result;
+  return true;
+}
+
+// ReadHexU8 reads an 8-bit value represented by 2 (uppercase) hexadecimal digits.
+bool ReadHexU8(const char* p, uint8_t* value) {
+  int high = HexCharToVal(p[0]);
+  int low = HexCharToVal(p[1]);
+  if (high < 0 || low < 0) return false;
+  *value = high << 4 | low;
+  return true;
 }
 
 // ConnLineData is the interesting (for our purposes) subset of the data stored in a single (non-header) line of
@@ -226,66 +359,62 @@ struct ConnLineData {
   ino_t inode;
 };
 
-struct ConnInfo {
-  Endpoint local;
-  Endpoint remote;
-  L4Proto l4proto;
-  bool is_server;
-};
-
-struct EndpointInfo {
-  Endpoint endpoint;
-  L4Proto l4proto;
-};
+// EndpointFieldLength returns the length of an endpoint field (`<address>:<port>`) in the `net/tcp[6]` file.
+int EndpointFieldLength(Address::Family family) {
+  return 2 * Address::Length(family) + 1 + 4;
+}
 
-// ParseEndpoint parses an endpoint listed in the `net/tcp[6]` file.
-const char* ParseEndpoint(const char* p, const char* endp, Address::Family family, Endpoint* endpoint) {
+// ParseEndpoint parses an endpoint listed in the `net/tcp[6]` file. The caller has to make sure that p points to at
+// least EndpointFieldLength(family) characters.
+bool ParseEndpoint(const char* p, Address::Family family, Endpoint* endpoint) {
+  // The address is printed as a sequence of 32-bit words in host byte order.
   static bool needs_byteorder_swap = (htons(42) != 42);
 
   std::array<uint8_t, Address::kMaxLen> addr_data = {};
 
   int addr_len = Address::Length(family);
-  int nread = ReadHexBytes(p, endp, addr_data.data(), 4, addr_len / 4, needs_byteorder_swap);
-  if (nread != addr_len) return nullptr;
-  p += nread * 2;
-  if (*p++ != ':') return nullptr;
+  if (!DecodeHexWords(p, addr_len / 4, needs_byteorder_swap, addr_data.data())) return false;
+  p += 2 * addr_len;
+  if (*p++ != ':') return false;
 
   uint16_t port;
-  nread = ReadHexBytes(p, endp, &port, sizeof(port), 1, needs_byteorder_swap);
-  if (nread != sizeof(port)) return nullptr;
-  p += nread * 2;
+  if (!ReadHexU16(p, &port)) return false;
 
   *endpoint = Endpoint(Address(family, addr_data), port);
-  return p;
+  return true;
 }
 
-// ParseConnLine parses an entire line in the `net/tcp[6]` file.
+// ParseConnLine parses an entire line in the `net/tcp[6]` file, which has to be terminated by a newline or NUL
+// character at endp. Lines of sockets that are neither in ESTABLISHED nor in LISTEN state are skipped (returning false)
+// before decoding any addresses.
 bool ParseConnLine(const char* p, const char* endp, Address::Family family, ConnLineData* data) {
   // Strip leading spaces.
-  while (std::isspace(*p)) p++;
+  while (p < endp && std::isspace(*p)) p++;
 
   // 0: sl
 
   p = nextfield(p, endp);
   if (!p) return false;
-  // 1: local_address
-  p = ParseEndpoint(p, endp, family, &data->local);
-  if (!p) return false;
 
-  p = nextfield(p, endp);
-  if (!p) return false;
-  // 2: rem_address
-  p = ParseEndpoint(p, endp, family, &data->remote);
-  if (!p) return false;
+  // Fields 1 (local_address), 2 (rem_address) and 3 (st) have a fixed width, which allows inspecting the state
+  // before anything else.
+  int endpoint_len = EndpointFieldLength(family);
+  if (endp - p < 2 * (endpoint_len + 1) + 2) return false;
+  const char* local = p;
+  const char* remote = local + endpoint_len + 1;
+  const char* state = remote + endpoint_len + 1;
+  if (local[endpoint_len] != ' ' || remote[endpoint_len] != ' ') return false;
 
-  p = nextfield(p, endp);
-  if (!p) return false;
   // 3: st
-  int nread = ReadHexBytes(p, endp, &data->state, 1, 1, false);
-  if (nread != 1) return false;
-  p += nread * 2;
+  if (!ReadHexU8(state, &data->state)) return false;
+  if (data->state != TCP_ESTABLISHED && data->state != TCP_LISTEN) return false;
+
+  // 1: local_address
+  if (!ParseEndpoint(local, family, &data->local)) return false;
+  // 2: rem_address
+  if (!ParseEndpoint(remote, family, &data->remote)) return false;
 
-  p = rep_nextfield(6, p, endp);
+  p = rep_nextfield(6, state, endp);
   if (!p) return false;
   // 9: inode
   char* parse_endp;
@@ -311,52 +440,132 @@ bool LocalIsServer(const Endpoint& local, const Endpoint& remote, const Unordere
   return IsEphemeralPort(remote.port()) > IsEphemeralPort(local.port());
 }
 
-// ReadConnectionsFromFile reads all connections from a `net/tcp[6]` file and stores them by inode in the given map.
-bool ReadConnectionsFromFile(Address::Family family, L4Proto l4proto, std::FILE* f,
+}  // namespace
+
+bool ReadConnectionsFromFile(Address::Family family, L4Proto l4proto, int fd,
                              UnorderedMap<ino_t, ConnInfo>* connections, UnorderedMap<ino_t, EndpointInfo>* listen_endpoints) {
-  char line[512];
+  // Reused across calls, with one extra byte for a NUL terminator after the data.
+  thread_local std::vector<char> buf(kConnReadBufferSize + 1);
 
-  if (!std::fgets(line, sizeof(line), f)) return false;  // ignore the first *header) line.
+  bool header = true;  // the first line is a header line and is ignored.
+  bool eof = false;
+  size_t len = 0;
 
   UnorderedSet<Endpoint> all_listen_endpoints;
 
-  while (std::fgets(line, sizeof(line), f)) {
-    ConnLineData data;
-    if (!ParseConnLine(line, line + sizeof(line), family, &data)) continue;
-    if (data.state == TCP_LISTEN) {  // listen socket
-      all_listen_endpoints.insert(data.local);
-      if (data.inode && listen_endpoints) {
-        auto& endpoint_info = (*listen_endpoints)[data.inode];
-        endpoint_info.endpoint = data.local;
-        endpoint_info.l4proto = l4proto;
+  while (!eof) {
+    ssize_t nread = read(fd, buf.data() + len, kConnReadBufferSize - len);
+    if (nread < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    eof = (nread == 0);
+    len += nread;
+    buf[len] = '\0';
+
+    char* line = buf.data();
+    char* data_end = buf.data() + len;
+    while (line < data_end) {
+      char* line_end = static_cast<char*>(std::memchr(line, '\n', data_end - line));
+      if (!line_end) {
+        if (!eof) break;  // incomplete line, wait for more data.
+        line_end = data_end;
       }
-      continue;
+
+      ConnLineData data;
+      if (header) {
+        header = false;
+      } else if (ParseConnLine(line, line_end, family, &data)) {
+        if (data.state == TCP_LISTEN) {  // listen socket
+          all_listen_endpoints.insert(data.local);
+          if (data.inode && listen_endpoints) {
+            auto& endpoint_info = (*listen_endpoints)[data.inode];
+            endpoint_info.endpoint = data.local;
+            endpoint_info.l4proto = l4proto;
+          }
+        } else if (data.inode) {  // otherwise, the socket was closed or is otherwise unavailable
+          auto& conn_info = (*connections)[data.inode];
+          conn_info.local = data.local;
+          conn_info.remote = data.remote;
+          conn_info.l4proto = l4proto;
+          // Note that the layout of net/tcp guarantees that all listen sockets will be listed before all active or
+          // closed connections, hence we can assume listen_endpoint to have its final value at this point.
+          conn_info.is_server = LocalIsServer(data.local, data.remote, all_listen_endpoints);
+        }
+      }
+
+      line = line_end + 1;
     }
-    if (data.state != TCP_ESTABLISHED) {
-      continue;
+
+    // Move the incomplete last line (if any) to the front of the buffer.
+    len = line < data_end ? data_end - line : 0;
+    if (len == kConnReadBufferSize) {
+      return false;  // a single line exceeding the buffer, this is not a net/tcp file.
     }
+    std::memmove(buf.data(), line, len);
+  }
+
+  return !header;
+}
+
+namespace {
+
+// AddInetDiagSockets stores the given sockets obtained via sock_diag by inode in the given maps, analogously to
+// ReadConnectionsFromFile.
+void AddInetDiagSockets(L4Proto l4proto, const std::vector<InetDiagSocket>& sockets,
+                        UnorderedMap<ino_t, ConnInfo>* connections, UnorderedMap<ino_t, EndpointInfo>* listen_endpoints) {
+  // Unlike net/tcp[6], sock_diag does not guarantee that listen sockets are reported before established ones, hence
+  // collect all of them first.
+  UnorderedSet<Endpoint> all_listen_endpoints;
+  for (const auto& socket : sockets) {
+    if (socket.state != TCP_LISTEN) continue;
+    all_listen_endpoints.insert(socket.local);
+    if (socket.inode && listen_endpoints) {
+      auto& endpoint_info = (*listen_endpoints)[socket.inode];
+      endpoint_info.endpoint = socket.local;
+      endpoint_info.l4proto = l4proto;
+    }
+  }
 
-    if (!data.inode) continue;  // socket was closed or otherwise unavailable
-    auto& conn_info = (*connections)[data.inode];
-    conn_info.local = data.local;
-    conn_info.remote = data.remote;
+  for (const auto& socket : sockets) {
+    if (socket.state != TCP_ESTABLISHED) continue;
+    if (!socket.inode) continue;  // socket was closed or otherwise unavailable
+
+    auto& conn_info = (*connections)[socket.inode];
+    conn_info.local = socket.local;
+    conn_info.remote = socket.remote;
     conn_info.l4proto = l4proto;
-    // Note that the layout of net/tcp guarantees that all listen sockets will be listed before all active or closed
-    // connections, hence we can assume listen_endpoint to have its final value at this point.
-    conn_info.is_server = LocalIsServer(data.local, data.remote, all_listen_endpoints);
+    conn_info.is_server = LocalIsServer(socket.local, socket.remote, all_listen_endpoints);
+  }
+}
+
+// ReadConnectionsFromSockDiag reads all active connections and listen endpoints of the network namespace referred to
+// by netns_fd via NETLINK_SOCK_DIAG.
+bool ReadConnectionsFromSockDiag(int netns_fd, UnorderedMap<ino_t, ConnInfo>* connections, UnorderedMap<ino_t, EndpointInfo>* listen_endpoints) {
+  FDHandle diag_fd = OpenSockDiagSocket(netns_fd);
+  if (!diag_fd.valid()) {
+    CLOG_THROTTLED(WARNING, std::chrono::minutes(10))
+        << "Could not open sock_diag socket (" << StrError() << "), falling back to reading net/tcp[6]";
+    return false;
   }
 
+  std::vector<InetDiagSocket> sockets;
+  if (!DumpTcpSockets(diag_fd, Address::Family::IPV4, &sockets)) return false;
+  AddInetDiagSockets(L4Proto::TCP, sockets, connections, listen_endpoints);
+
+  sockets.clear();
+  if (!DumpTcpSockets(diag_fd, Address::Family::IPV6, &sockets)) return false;
+  AddInetDiagSockets(L4Proto::TCP, sockets, connections, listen_endpoints);
+
   return true;
 }
 
-// GetConnections reads all active connections (inode -> connection info mapping) for a given network NS, addressed by
-// the dir FD for a proc entry of a process in that network namespace.
-bool GetConnections(int dirfd, UnorderedMap<ino_t, ConnInfo>* connections, UnorderedMap<ino_t, EndpointInfo>* listen_endpoints) {
+// GetConnectionsFromProcfs reads all active connections from `net/tcp[6]`.
+bool GetConnectionsFromProcfs(int dirfd, UnorderedMap<ino_t, ConnInfo>* connections, UnorderedMap<ino_t, EndpointInfo>* listen_endpoints) {
   bool success = true;
   {
-    FDHandle net_tcp_fd = openat(dirfd, "net/tcp", O_RDONLY);
-    if (net_tcp_fd.valid()) {
-      FileHandle net_tcp(std::move(net_tcp_fd), "r");
+    FDHandle net_tcp = openat(dirfd, "net/tcp", O_RDONLY);
+    if (net_tcp.valid()) {
       success = ReadConnectionsFromFile(Address::Family::IPV4, L4Proto::TCP, net_tcp, connections, listen_endpoints) && success;
     } else {
       success = false;  // there should always be a net/tcp file
@@ -364,9 +573,8 @@ bool GetConnections(int dirfd, UnorderedMap<ino_t, ConnInfo>* connections, Unord
   }
 
   {
-    FDHandle net_tcp6_fd = openat(dirfd, "net/tcp6", O_RDONLY);
-    if (net_tcp6_fd.valid()) {
-      FileHandle net_tcp6(std::move(net_tcp6_fd), "r");
+    FDHandle net_tcp6 = openat(dirfd, "net/tcp6", O_RDONLY);
+    if (net_tcp6.valid()) {
       success = ReadConnectionsFromFile(Address::Family::IPV6, L4Proto::TCP, net_tcp6, connections, listen_endpoints) && success;
     } else {
       success = false;
@@ -376,6 +584,27 @@ bool GetConnections(int dirfd, UnorderedMap<ino_t, ConnInfo>* connections, Unord
   return success;
 }
 
+}  // namespace
+
+bool GetConnections(int dirfd, ConnectionSource source, UnorderedMap<ino_t, ConnInfo>* connections, UnorderedMap<ino_t, EndpointInfo>* listen_endpoints) {
+  if (source == ConnectionSource::SOCK_DIAG) {
+    FDHandle netns_fd = openat(dirfd, "ns/net", O_RDONLY | O_CLOEXEC);
+    if (netns_fd.valid()) {
+      UnorderedMap<ino_t, ConnInfo> diag_connections;
+      UnorderedMap<ino_t, EndpointInfo> diag_listen_endpoints;
+      if (ReadConnectionsFromSockDiag(netns_fd, &diag_connections, listen_endpoints ? &diag_listen_endpoints : nullptr)) {
+        *connections = std::move(diag_connections);
+        if (listen_endpoints) *listen_endpoints = std::move(diag_listen_endpoints);
+        return true;
+      }
+    }
+  }
+
+  return GetConnectionsFromProcfs(dirfd, connections, listen_endpoints);
+}
+
+namespace {
+
 struct NSNetworkData {
   UnorderedMap<ino_t, ConnInfo> connections;
   UnorderedMap<ino_t, EndpointInfo> listen_endpoints;
@@ -388,16 +617,26 @@ using SocketsByContainer = UnorderedMap<std::string, UnorderedMap<ino_t, Unorder
 
 // ResolveSocketInodes takes a netns -> (inode -> connection info) mapping and a
 // container id -> (netns -> socket) mapping, and synthesizes this to a list of (container id, connection info)
-// tuples.
+// tuples. If resolved_sockets is given, sockets contained in it are skipped, and all resolved sockets are added to it.
+// The originator processes of all listen endpoints are fetched from process_store at once.
 void ResolveSocketInodes(const SocketsByContainer& sockets_by_container, const ConnsByNS& conns_by_ns,
-                         std::shared_ptr<ProcessStore> process_store,
+                         std::shared_ptr<ProcessStore> process_store, UnorderedSet<ino_t>* resolved_sockets,
                          std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
+  struct PendingEndpoint {
+    const std::string* container_id;
+    const EndpointInfo* endpoint_info;
+    uint64_t pid;
+  };
+  std::vector<PendingEndpoint> pending_endpoints;
+
   for (const auto& container_sockets : sockets_by_container) {
     const auto& container_id = container_sockets.first;
     for (const auto& netns_sockets : container_sockets.second) {
       const auto* ns_network_data = Lookup(conns_by_ns, netns_sockets.first);
       if (!ns_network_data) continue;
       for (const auto& socket : netns_sockets.second) {
+        if (resolved_sockets && !resolved_sockets->insert(socket.inode()).second) continue;
+
         if (const auto* conn = Lookup(ns_network_data->connections, socket.inode())) {
           Connection connection(container_id, conn->local, conn->remote, conn->l4proto, conn->is_server);
           if (!IsRelevantConnection(connection)) continue;
@@ -406,142 +645,593 @@ void ResolveSocketInodes(const SocketsByContainer& sockets_by_container, const C
           if (const auto* ep = Lookup(ns_network_data->listen_endpoints, socket.inode())) {
             if (!IsRelevantEndpoint(ep->endpoint)) continue;
 
-            std::shared_ptr<Process> process;
-
-            if (process_store) {
-              process = process_store->Fetch(socket.pid());
-            }
-
-            listen_endpoints->emplace_back(container_id, ep->endpoint, ep->l4proto, process);
+            pending_endpoints.push_back({&container_id, ep, socket.pid()});
           }
         }
       }
     }
   }
+
+  if (pending_endpoints.empty()) return;
+
+  std::vector<std::shared_ptr<Process>> processes;
+  if (process_store) {
+    std::vector<uint64_t> pids;
+    pids.reserve(pending_endpoints.size());
+    for (const auto& pending : pending_endpoints) pids.push_back(pending.pid);
+    processes = process_store->FetchMany(pids);
+  }
+
+  listen_endpoints->reserve(listen_endpoints->size() + pending_endpoints.size());
+  for (size_t i = 0; i < pending_endpoints.size(); i++) {
+    const auto& pending = pending_endpoints[i];
+    listen_endpoints->emplace_back(*pending.container_id, pending.endpoint_info->endpoint, pending.endpoint_info->l4proto,
+                                   process_store ? processes[i] : nullptr);
+  }
 }
 
-// ReadContainerConnections reads all container connection info from the given `/proc`-like directory. All connections
-// from non-container processes are ignored.
-// process_store, when provided, is used to to link the originator process of a ContainerEndpoint.
-bool ReadContainerConnections(const char* proc_path, std::shared_ptr<ProcessStore> process_store,
-                              std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
+// InferredSocketOwner is a process assumed to own all sockets of its network namespace not found in the fd directory of
+// any other process.
+struct InferredSocketOwner {
+  ino_t netns_inode;
+  std::string container_id;
+  uint64_t pid;
+};
+
+// ProcWalkData is the information gathered from the `/proc/<pid>` directories visited by a single worker.
+struct ProcWalkData {
+  SocketsByContainer sockets_by_container_and_ns;
+  // netns -> pids of (some of the) processes owning sockets in that network namespace. Any of them can be used to read
+  // the connections of the namespace.
+  UnorderedMap<ino_t, std::vector<uint64_t>> netns_pids;
+  // New or changed entries for the pid metadata cache.
+  std::vector<std::pair<uint64_t, PidMetadata>> pid_cache_updates;
+  size_t pid_cache_hits = 0;
+  // Processes whose fd directory was not walked, and which are assumed to own all otherwise unowned sockets in their
+  // network namespace.
+  std::vector<InferredSocketOwner> inferred_owners;
+  FDWalkStats fd_stats;
+};
+
+// Maximum number of pids per network namespace and worker to remember for reading the connections of the namespace.
+// More than one is needed in case a process disappears before its namespace is read.
+constexpr size_t kMaxNetNSPids = 4;
+
+// Number of scrapes in which the fds of a process known not to refer to sockets are skipped, before all of its fds are
+// verified again. This bounds the delay for finding sockets opened on a reused fd.
+constexpr uint32_t kFDCacheMaxAge = 8;
+
+// Number of scrapes after reading the metadata of a process in which its cgroup is compared with the cached one. Processes
+// are usually only moved to a different cgroup right after they are started, e.g., when runc moves the init process of
+// a container into the container's cgroup.
+constexpr uint32_t kCgroupValidationScrapes = 2;
+
+// Number of `/proc/<pid>` entries a worker claims at a time.
+constexpr size_t kProcWalkChunkSize = 32;
+
+// ListPids returns the pids of all processes in the given `/proc`-like directory, in ascending order.
+bool ListPids(const char* proc_path, std::vector<uint64_t>* pids) {
   DirHandle procdir = opendir(proc_path);
   if (!procdir.valid()) {
     CLOG(ERROR) << "Could not open " << proc_path << ": " << StrError();
     return false;
   }
 
-  ConnsByNS conns_by_ns;
-  SocketsByContainer sockets_by_container_and_ns;
-
-  // Read all the information from proc.
   while (auto curr = procdir.read()) {
     if (!std::isdigit(curr->d_name[0])) continue;  // only look for <pid> entries
-    long long pid = strtoll(curr->d_name, 0, 10);
+    pids->push_back(strtoull(curr->d_name, 0, 10));
+  }
+  std::sort(pids->begin(), pids->end());
+  return true;
+}
+
+FDHandle OpenPidDir(int procfd, uint64_t pid) {
+  char pid_str[24];
+  snprintf(pid_str, sizeof(pid_str), "%" PRIu64, pid);
+  return openat(procfd, pid_str, O_RDONLY);
+}
 
-    FDHandle dirfd = procdir.openat(curr->d_name, O_RDONLY);
-    if (!dirfd.valid()) {
-      CLOG(DEBUG) << "Could not open process directory " << curr->d_name << ": " << StrError();
-      continue;
+// ReadPidMetadata reads the metadata of the process represented by dirfd.
+bool ReadPidMetadata(int dirfd, ContainerIDCache* container_id_cache, PidMetadata* metadata) {
+  metadata->in_container = GetContainerID(dirfd, container_id_cache, &metadata->container_id, &metadata->cgroup_key);
+
+  if (!GetNetworkNamespace(dirfd, &metadata->netns_inode)) {
+    if (!metadata->in_container) {
+      // The network namespace of a host process is only used to exclude it from socket owner inference.
+      metadata->netns_inode = 0;
+      return true;
     }
+    CLOG(ERROR) << "Could not determine network namespace: " << StrError();
+    return false;
+  }
+  return true;
+}
+
+// PidMetadataValid returns whether the cached metadata of the process represented by dirfd still applies. The network
+// namespace of a process can be changed at any time (setns), hence is compared in every scrape, at the cost of a single
+// readlink. The cgroup is only compared while the metadata is younger than kCgroupValidationScrapes scrapes.
+bool PidMetadataValid(int dirfd, ContainerIDCache* container_id_cache, const PidMetadata& metadata) {
+  ino_t netns_inode;
+  if (!GetNetworkNamespace(dirfd, &netns_inode)) {
+    if (metadata.netns_inode != 0) return false;
+  } else if (netns_inode != metadata.netns_inode) {
+    return false;
+  }
+
+  if (metadata.age >= kCgroupValidationScrapes) return true;
 
-    std::string container_id;
-    if (!GetContainerID(dirfd, &container_id)) continue;
+  std::string container_id;
+  bool in_container = GetContainerID(dirfd, container_id_cache, &container_id);
+  return in_container == metadata.in_container && (!in_container || container_id == metadata.container_id);
+}
+
+// WalkProc reads the container ID, network namespace and socket inodes of the given process into *data. If pid_cache
+// is given, the container ID and network namespace are taken from it, unless the pid was reused or they changed, and the
+// fds known not to refer to sockets are skipped. The cached fd information of the process is updated in place, hence every pid may be
+// visited by at most one worker at a time. Otherwise, the container ID is resolved through container_id_cache, if given.
+// If socket_owners (netns -> pid) is given and maps the network namespace of the process to its pid, the fd directory
+// is not walked, and the process is recorded as an inferred socket owner instead.
+void WalkProc(int procfd, uint64_t pid, PidMetadataCache* pid_cache, const UnorderedMap<ino_t, uint64_t>* socket_owners,
+              ContainerIDCache* container_id_cache, ProcWalkData* data) {
+  FDHandle dirfd = OpenPidDir(procfd, pid);
+  if (!dirfd.valid()) {
+    CLOG(DEBUG) << "Could not open process directory " << pid << ": " << StrError();
+    return;
+  }
+
+  PidMetadata new_metadata;
+  PidMetadata* metadata = nullptr;
+  bool cached = false;
+  if (pid_cache) {
+    if (!GetStartTime(dirfd, &new_metadata.starttime)) return;  // process is gone
+
+    metadata = Lookup(*pid_cache, pid);
+    if (metadata && metadata->starttime == new_metadata.starttime && PidMetadataValid(dirfd, container_id_cache, *metadata)) {
+      data->pid_cache_hits++;
+      metadata->age++;
+      cached = true;
+    } else {
+      if (!ReadPidMetadata(dirfd, container_id_cache, &new_metadata)) return;
+      metadata = &new_metadata;
+    }
+  } else {
+    if (!ReadPidMetadata(dirfd, container_id_cache, &new_metadata)) return;
+    metadata = &new_metadata;
+  }
 
-    uint64_t netns_inode;
-    if (!GetNetworkNamespace(dirfd, &netns_inode)) {
-      CLOG(ERROR) << "Could not determine network namespace: " << StrError();
-      continue;
+  if (metadata->in_container) {
+    const std::string& container_id = metadata->container_id;
+    uint64_t netns_inode = metadata->netns_inode;
+    bool use_fd_cache = cached && metadata->fd_cache_age < kFDCacheMaxAge;
+
+    const uint64_t* owner = socket_owners ? Lookup(*socket_owners, netns_inode) : nullptr;
+    if (use_fd_cache && owner && *owner == pid) {
+      metadata->fd_cache_age++;
+      data->inferred_owners.push_back({netns_inode, container_id, pid});
+      auto& pids = data->netns_pids[netns_inode];
+      if (pids.size() < kMaxNetNSPids) pids.push_back(pid);
+      return;
     }
 
-    auto& container_ns_sockets = sockets_by_container_and_ns[container_id][netns_inode];
-    bool no_sockets = container_ns_sockets.empty();
+    auto& container_ns_sockets = data->sockets_by_container_and_ns[container_id][netns_inode];
+    size_t num_sockets = container_ns_sockets.size();
 
-    if (!GetSocketINodes(dirfd, pid, &container_ns_sockets)) {
+    std::vector<int> non_socket_fds;
+    FDWalkStats fd_stats;
+    if (!GetSocketINodes(dirfd, pid, use_fd_cache ? &metadata->non_socket_fds : nullptr,
+                         pid_cache ? &non_socket_fds : nullptr, &fd_stats, &container_ns_sockets)) {
       CLOG(ERROR) << "Could not obtain socket inodes: " << StrError();
-      continue;
-    }
-
-    if (no_sockets && !container_ns_sockets.empty()) {
-      // These are the first sockets for this (container, netns) pair. Make sure we actually have the information about
-      // connections in this network namespace.
-      auto emplace_res = conns_by_ns.emplace(netns_inode, NSNetworkData());
-      if (emplace_res.second) {
-        auto& ns_network_data = emplace_res.first->second;
-
-        if (!GetConnections(dirfd, &ns_network_data.connections, listen_endpoints ? &ns_network_data.listen_endpoints : nullptr)) {
-          // If there was an error reading connections, that could be due to a number of reasons.
-          // We need to differentiate persistent errors (e.g., expected net/tcp6 file not found)
-          // from spurious/race condition errors caused by the process disappearing while reading
-          // the directory. To determine if the latter is the root cause, we reattempt to read the
-          // network namespace inode; if that succeeds, we assume that the process is still alive
-          // and any errors encountered are persistent.
-          uint64_t netns_inode2;
-          if (!GetNetworkNamespace(dirfd, &netns_inode2) || netns_inode2 != netns_inode) {
-            conns_by_ns.erase(emplace_res.first);
-            continue;
-          }
+      return;
+    }
+    data->fd_stats.resolved += fd_stats.resolved;
+    data->fd_stats.skipped += fd_stats.skipped;
+
+    metadata->non_socket_fds = std::move(non_socket_fds);
+    metadata->fd_cache_age = use_fd_cache ? metadata->fd_cache_age + 1 : 0;
+    metadata->num_fds = fd_stats.resolved + fd_stats.skipped;
+
+    if (container_ns_sockets.size() > num_sockets) {
+      // Make sure we actually read the information about connections in this network namespace.
+      auto& pids = data->netns_pids[netns_inode];
+      if (pids.size() < kMaxNetNSPids) pids.push_back(pid);
+    }
+  }
+
+  if (pid_cache && !cached) {
+    data->pid_cache_updates.emplace_back(pid, std::move(new_metadata));
+  }
+}
+
+// HostProcessNetNS returns the network namespaces shared with non-container processes, e.g., the host network namespace
+// of hostNetwork pods. As the fd directories of non-container processes are not walked, the sockets they own are not
+// owned by any process as far as the scraper can tell.
+UnorderedSet<ino_t> HostProcessNetNS(const PidMetadataCache& pid_cache) {
+  UnorderedSet<ino_t> host_netns;
+  for (const auto& entry : pid_cache) {
+    const auto& metadata = entry.second;
+    if (!metadata.in_container && metadata.netns_inode != 0) host_netns.insert(metadata.netns_inode);
+  }
+  return host_netns;
+}
+
+// SelectSocketOwners returns, for every network namespace not shared with non-container processes, the container
+// process with the most open files in the previous scrape, if it has at least kMinFDsForSocketInference of them.
+UnorderedMap<ino_t, uint64_t> SelectSocketOwners(const PidMetadataCache& pid_cache) {
+  UnorderedSet<ino_t> host_netns = HostProcessNetNS(pid_cache);
+  UnorderedMap<ino_t, const PidMetadataCache::value_type*> candidates;
+  for (const auto& entry : pid_cache) {
+    const auto& metadata = entry.second;
+    if (!metadata.in_container || metadata.num_fds < kMinFDsForSocketInference) continue;
+    if (Contains(host_netns, metadata.netns_inode)) continue;
+    auto& candidate = candidates[metadata.netns_inode];
+    if (!candidate || metadata.num_fds > candidate->second.num_fds) candidate = &entry;
+  }
+
+  UnorderedMap<ino_t, uint64_t> socket_owners;
+  for (const auto& candidate : candidates) {
+    socket_owners.emplace(candidate.first, candidate.second->first);
+  }
+  return socket_owners;
+}
+
+// OwnedSockets returns the inodes of all sockets found in the fd directory of any process.
+UnorderedSet<ino_t> OwnedSockets(const SocketsByContainer& sockets_by_container) {
+  UnorderedSet<ino_t> owned_sockets;
+  for (const auto& container_sockets : sockets_by_container) {
+    for (const auto& netns_sockets : container_sockets.second) {
+      for (const auto& socket : netns_sockets.second) {
+        owned_sockets.insert(socket.inode());
+      }
+    }
+  }
+  return owned_sockets;
+}
+
+// AddInferredSockets attributes all sockets in the network namespace of each inferred owner which are not contained in
+// owned_sockets to the owner, and adds them to owned_sockets. Returns the number of attributed sockets.
+size_t AddInferredSockets(const std::vector<InferredSocketOwner>& owners, const ConnsByNS& conns_by_ns,
+                          UnorderedSet<ino_t>* owned_sockets, SocketsByContainer* sockets_by_container) {
+  size_t num_inferred = 0;
+  for (const auto& owner : owners) {
+    const auto* ns_network_data = Lookup(conns_by_ns, owner.netns_inode);
+    if (!ns_network_data) continue;
+
+    auto& owner_sockets = (*sockets_by_container)[owner.container_id][owner.netns_inode];
+    auto add_socket = [&](ino_t inode) {
+      if (!owned_sockets->insert(inode).second) return;
+      owner_sockets.emplace(inode, owner.pid);
+      num_inferred++;
+    };
+    for (const auto& conn : ns_network_data->connections) add_socket(conn.first);
+    for (const auto& ep : ns_network_data->listen_endpoints) add_socket(ep.first);
+  }
+  return num_inferred;
+}
+
+// InvalidateFDCaches resets the fd caches of all processes in network namespaces containing sockets for which
+// is_owned returns false. Such a socket may have been opened on a reused fd previously known not to refer to a socket,
+// hence all fds of the processes in these namespaces are verified in the next scrape. Namespaces shared with
+// non-container processes always contain unowned sockets, hence the fds of container processes in them, e.g., of
+// hostNetwork pods, are verified in every scrape.
+template <typename F>
+void InvalidateFDCaches(const ConnsByNS& conns_by_ns, const F& is_owned, PidMetadataCache* pid_cache) {
+  UnorderedSet<ino_t> stale_netns = HostProcessNetNS(*pid_cache);
+  for (const auto& ns_network_data : conns_by_ns) {
+    if (Contains(stale_netns, ns_network_data.first)) continue;
+    for (const auto& conn : ns_network_data.second.connections) {
+      if (!is_owned(conn.first)) {
+        stale_netns.insert(ns_network_data.first);
+        break;
+      }
+    }
+    for (const auto& ep : ns_network_data.second.listen_endpoints) {
+      if (!is_owned(ep.first)) {
+        stale_netns.insert(ns_network_data.first);
+        break;
+      }
+    }
+  }
+  if (stale_netns.empty()) return;
+
+  for (auto& entry : *pid_cache) {
+    auto& metadata = entry.second;
+    if (metadata.in_container && Contains(stale_netns, metadata.netns_inode)) {
+      metadata.fd_cache_age = kFDCacheMaxAge;
+    }
+  }
+}
+
+// ReadNetNSConnections reads the connections of the network namespace with the given inode, using the first of the
+// given processes in that namespace that is still alive. Returns false if none of them is.
+bool ReadNetNSConnections(int procfd, ino_t netns_inode, const std::vector<uint64_t>& pids, ConnectionSource source,
+                          bool with_listen_endpoints, NSNetworkData* ns_network_data) {
+  for (uint64_t pid : pids) {
+    FDHandle dirfd = OpenPidDir(procfd, pid);
+    if (!dirfd.valid()) continue;
+
+    if (GetConnections(dirfd, source, &ns_network_data->connections, with_listen_endpoints ? &ns_network_data->listen_endpoints : nullptr)) {
+      return true;
+    }
+
+    // If there was an error reading connections, that could be due to a number of reasons.
+    // We need to differentiate persistent errors (e.g., expected net/tcp6 file not found)
+    // from spurious/race condition errors caused by the process disappearing while reading
+    // the directory. To determine if the latter is the root cause, we reattempt to read the
+    // network namespace inode; if that succeeds, we assume that the process is still alive
+    // and any errors encountered are persistent.
+    uint64_t netns_inode2;
+    if (GetNetworkNamespace(dirfd, &netns_inode2) && netns_inode2 == netns_inode) {
+      return true;
+    }
+
+    ns_network_data->connections.clear();
+    ns_network_data->listen_endpoints.clear();
+  }
+  return false;
+}
+
+// ApplyPidCacheUpdates applies the updates gathered by the workers to the pid metadata cache.
+void ApplyPidCacheUpdates(std::vector<ProcWalkData>* worker_data, PidMetadataCache* pid_cache) {
+  size_t hits = 0;
+  size_t misses = 0;
+  for (auto& data : *worker_data) {
+    hits += data.pid_cache_hits;
+    misses += data.pid_cache_updates.size();
+    for (auto& update : data.pid_cache_updates) {
+      (*pid_cache)[update.first] = std::move(update.second);
+    }
+    data.pid_cache_updates.clear();
+  }
+
+  COUNTER_ADD(CollectorStats::net_scrape_pid_cache_hits, hits);
+  COUNTER_ADD(CollectorStats::net_scrape_pid_cache_misses, misses);
+  COUNTER_SET(CollectorStats::net_scrape_pid_cache_size, pid_cache->size());
+}
+
+// PrunePidCache removes the entries of all processes which are not in the given (complete) list of pids from the pid
+// metadata cache.
+void PrunePidCache(const std::vector<uint64_t>& pids, PidMetadataCache* pid_cache) {
+  UnorderedSet<uint64_t> live_pids(pids.begin(), pids.end());
+  for (auto it = pid_cache->begin(); it != pid_cache->end();) {
+    if (Contains(live_pids, it->first)) {
+      ++it;
+    } else {
+      it = pid_cache->erase(it);
+    }
+  }
+}
+
+// MarkCgroupKeysUsed keeps the container ID cache entries of all processes in the pid metadata cache, which are not
+// looked up again as long as the processes live, from being swept.
+void MarkCgroupKeysUsed(const PidMetadataCache& pid_cache, ContainerIDCache* container_id_cache) {
+  for (const auto& entry : pid_cache) {
+    const auto& cgroup_key = entry.second.cgroup_key;
+    if (!cgroup_key.empty()) container_id_cache->MarkUsed(cgroup_key);
+  }
+}
+
+// MergeProcWalkData merges the information gathered by a single worker into *merged.
+void MergeProcWalkData(ProcWalkData* data, SocketsByContainer* merged_sockets, UnorderedMap<ino_t, std::vector<uint64_t>>* merged_netns_pids) {
+  if (merged_sockets->empty()) {
+    *merged_sockets = std::move(data->sockets_by_container_and_ns);
+  } else {
+    for (auto& container_sockets : data->sockets_by_container_and_ns) {
+      auto& merged_container_sockets = (*merged_sockets)[container_sockets.first];
+      for (auto& netns_sockets : container_sockets.second) {
+        auto& merged_netns_sockets = merged_container_sockets[netns_sockets.first];
+        if (merged_netns_sockets.empty()) {
+          merged_netns_sockets = std::move(netns_sockets.second);
+        } else {
+          merged_netns_sockets.insert(netns_sockets.second.begin(), netns_sockets.second.end());
+        }
+      }
+    }
+  }
+
+  for (auto& netns_pids : data->netns_pids) {
+    auto& merged_pids = (*merged_netns_pids)[netns_pids.first];
+    for (uint64_t pid : netns_pids.second) {
+      if (merged_pids.size() >= kMaxNetNSPids) break;
+      merged_pids.push_back(pid);
+    }
+  }
+}
+
+// ReadContainerConnections reads all container connection info of the processes with the given pids from the given
+// `/proc`-like directory. All connections from non-container processes are ignored.
+// process_store, when provided, is used to to link the originator process of a ContainerEndpoint.
+// pid_cache, when provided, is used and updated to avoid re-reading the metadata of known processes.
+// container_id_cache, when provided, is used to resolve the container IDs of processes not in pid_cache.
+// source determines how the connections of each network namespace are read. The connections of namespaces already
+// contained in conns_by_ns are not read again, and newly read ones are added to it.
+// resolved_sockets, when provided, is used to skip sockets already reported in a previous call.
+// socket_owners (netns -> pid), when provided, selects the processes whose sockets are inferred from their network
+// namespace instead of being read from their fd directory. It must only be given for complete scrapes.
+// The process directories are partitioned across the given workers. The connections of each network namespace are read
+// only once, after all process directories have been visited.
+bool ReadContainerConnections(const char* proc_path, const std::vector<uint64_t>& pids,
+                              std::shared_ptr<ProcessStore> process_store, PidMetadataCache* pid_cache,
+                              ContainerIDCache* container_id_cache, ConnectionSource source, WorkerPool* workers,
+                              ConnsByNS* conns_by_ns, UnorderedSet<ino_t>* resolved_sockets,
+                              const UnorderedMap<ino_t, uint64_t>* socket_owners,
+                              std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
+  DirHandle procdir = opendir(proc_path);
+  if (!procdir.valid()) {
+    CLOG(ERROR) << "Could not open " << proc_path << ": " << StrError();
+    return false;
+  }
+  int procfd = procdir.fd();
+
+  SocketsByContainer sockets_by_container_and_ns;
+  UnorderedMap<ino_t, std::vector<uint64_t>> netns_pids;
+  std::vector<InferredSocketOwner> inferred_owners;
+
+  // Read the container ID, network namespace and socket inodes of all processes.
+  WITH_TIMER(CollectorStats::net_scrape_proc_walk) {
+    std::vector<ProcWalkData> worker_data(workers->num_workers());
+    std::atomic<size_t> next_pid(0);
+    workers->Run([&](int worker) {
+      auto* data = &worker_data[worker];
+      for (;;) {
+        size_t begin = next_pid.fetch_add(kProcWalkChunkSize);
+        if (begin >= pids.size()) break;
+        size_t end = std::min(begin + kProcWalkChunkSize, pids.size());
+        for (size_t i = begin; i < end; i++) {
+          WalkProc(procfd, pids[i], pid_cache, socket_owners, container_id_cache, data);
         }
       }
+    });
+
+    if (pid_cache) {
+      ApplyPidCacheUpdates(&worker_data, pid_cache);
+    }
+
+    FDWalkStats fd_stats;
+    for (auto& data : worker_data) {
+      MergeProcWalkData(&data, &sockets_by_container_and_ns, &netns_pids);
+      fd_stats.resolved += data.fd_stats.resolved;
+      fd_stats.skipped += data.fd_stats.skipped;
+      std::move(data.inferred_owners.begin(), data.inferred_owners.end(), std::back_inserter(inferred_owners));
+    }
+    COUNTER_ADD(CollectorStats::net_scrape_fds_resolved, fd_stats.resolved);
+    COUNTER_ADD(CollectorStats::net_scrape_fds_skipped, fd_stats.skipped);
+  }
+
+  // Read the connections of every network namespace, once.
+  WITH_TIMER(CollectorStats::net_scrape_read_conns) {
+    std::vector<std::pair<ino_t, const std::vector<uint64_t>*>> netns_list;
+    netns_list.reserve(netns_pids.size());
+    for (const auto& entry : netns_pids) {
+      if (Contains(*conns_by_ns, entry.first)) continue;
+      netns_list.emplace_back(entry.first, &entry.second);
+    }
+
+    std::vector<NSNetworkData> ns_network_data(netns_list.size());
+    std::vector<char> ns_valid(netns_list.size());
+    std::atomic<size_t> next_netns(0);
+    workers->Run(static_cast<int>(std::min<size_t>(workers->num_workers(), netns_list.size())), [&](int worker) {
+      for (size_t i = next_netns++; i < netns_list.size(); i = next_netns++) {
+        ns_valid[i] = ReadNetNSConnections(procfd, netns_list[i].first, *netns_list[i].second, source,
+                                           listen_endpoints != nullptr, &ns_network_data[i]);
+      }
+    });
+
+    COUNTER_ADD(CollectorStats::net_scrape_netns_reads, netns_list.size());
+    for (size_t i = 0; i < netns_list.size(); i++) {
+      if (!ns_valid[i]) continue;
+      conns_by_ns->emplace(netns_list[i].first, std::move(ns_network_data[i]));
     }
   }
 
-  ResolveSocketInodes(sockets_by_container_and_ns, conns_by_ns, process_store, connections, listen_endpoints);
+  WITH_TIMER(CollectorStats::net_scrape_resolve) {
+    if (pid_cache && !resolved_sockets) {
+      UnorderedSet<ino_t> owned_sockets = OwnedSockets(sockets_by_container_and_ns);
+      if (!inferred_owners.empty()) {
+        size_t num_inferred = AddInferredSockets(inferred_owners, *conns_by_ns, &owned_sockets, &sockets_by_container_and_ns);
+        COUNTER_ADD(CollectorStats::net_scrape_inferred_sockets, num_inferred);
+      }
+      InvalidateFDCaches(
+          *conns_by_ns, [&](ino_t inode) { return Contains(owned_sockets, inode); }, pid_cache);
+    }
+
+    ResolveSocketInodes(sockets_by_container_and_ns, *conns_by_ns, process_store, resolved_sockets, connections, listen_endpoints);
+  }
   return true;
 }
 
-bool ReadProcessExe(const char* process_id, int dirfd, std::string& comm, std::string& exe_path) {
+// Initial size of the buffer for reading `cmdline` files, which is grown as needed.
+constexpr size_t kCmdlineBufferSize = 4096;
+
+bool ReadProcessExe(uint64_t pid, int dirfd, std::string* comm, std::string* exe_path) {
   char buffer[PATH_MAX];
 
   ssize_t nread = readlinkat(dirfd, "exe", buffer, sizeof(buffer));
   if (nread <= 0 || nread >= ssizeof(buffer)) {
-    CLOG(ERROR) << "Could not read 'exe' for " << process_id << ": " << StrError();
+    CLOG(ERROR) << "Could not read 'exe' for " << pid << ": " << StrError();
     return false;
   }
 
-  buffer[nread] = '\0';
+  exe_path->assign(buffer, nread);
 
-  comm = exe_path = buffer;
-
-  if (buffer[0] == '/')
-    comm = strrchr(buffer, '/') + 1;
+  if (buffer[0] == '/') {
+    const char* basename = static_cast<const char*>(memrchr(buffer, '/', nread)) + 1;
+    comm->assign(basename, buffer + nread - basename);
+  } else {
+    *comm = *exe_path;
+  }
 
   return true;
 }
 
-bool ReadProcessCmdline(const char* process_id, int dirfd, std::string& exe, std::string& args) {
-  FileHandle cmdline(FDHandle(openat(dirfd, "cmdline", O_RDONLY)), "r");
+// ReadProcessCmdline reads the `cmdline` file of the process represented by dirfd, using (and growing) the given
+// buffer, and splits it into the executable (argv[0]) and the space separated remaining arguments. Empty arguments
+// are skipped.
+bool ReadProcessCmdline(uint64_t pid, int dirfd, std::vector<char>* buffer, std::string* exe, std::string* args) {
+  FDHandle cmdline = openat(dirfd, "cmdline", O_RDONLY);
   if (!cmdline.valid()) {
-    CLOG(ERROR) << "Could not read 'cmdline' for " << process_id << ": " << StrError();
+    CLOG(ERROR) << "Could not read 'cmdline' for " << pid << ": " << StrError();
     return false;
   }
-  bool did_exe = false;
-  bool arg_completed = false;
-  std::stringbuf stringbuf;
-  int c;
 
-  while ((c = fgetc(cmdline)) != EOF) {
-    if (c != '\0') {
-      if (arg_completed) {
-        stringbuf.sputc(' ');
-        arg_completed = false;
-      }
-      stringbuf.sputc(c);
-    } else {
-      if (did_exe) {
-        arg_completed = true;
-      } else {
-        exe = stringbuf.str();
-        stringbuf = std::stringbuf();
-        did_exe = true;
-      }
+  if (buffer->size() < kCmdlineBufferSize) {
+    buffer->resize(kCmdlineBufferSize);
+  }
+  size_t len = 0;
+  for (;;) {
+    ssize_t nread = read(cmdline, buffer->data() + len, buffer->size() - len);
+    if (nread < 0) {
+      if (errno == EINTR) continue;
+      CLOG(ERROR) << "Could not read 'cmdline' for " << pid << ": " << StrError();
+      return false;
+    }
+    if (nread == 0) break;
+    len += nread;
+    if (len == buffer->size()) {
+      buffer->resize(2 * buffer->size());
+    }
+  }
+
+  const char* p = buffer->data();
+  const char* endp = p + len;
+
+  const char* exe_end = static_cast<const char*>(memchr(p, '\0', len));
+  if (exe_end) {
+    exe->assign(p, exe_end);
+    p = exe_end + 1;
+  } else {
+    exe->clear();
+  }
+
+  args->clear();
+  while (p < endp) {
+    const char* arg_end = static_cast<const char*>(memchr(p, '\0', endp - p));
+    if (!arg_end) arg_end = endp;
+    if (arg_end != p) {
+      if (!args->empty()) args->push_back(' ');
+      args->append(p, arg_end);
     }
+    p = arg_end + 1;
   }
-  args = stringbuf.str();
 
   return true;
 }
 
+// ScrapeProcess reads the information about the process with the given pid, using the given buffer for reading files.
+// Returns false if the process could not be read, or is not running in a container.
+bool ScrapeProcess(int procfd, uint64_t pid, ContainerIDCache* container_id_cache, std::vector<char>* buffer,
+                   ProcessScraper::ProcessInfo* process_info) {
+  FDHandle dirfd = OpenPidDir(procfd, pid);
+  if (!dirfd.valid()) {
+    return false;
+  }
+
+  process_info->pid = pid;
+
+  return GetContainerID(dirfd, container_id_cache, &process_info->container_id) &&
+         ReadProcessExe(pid, dirfd, &process_info->comm, &process_info->exe_path) &&
+         ReadProcessCmdline(pid, dirfd, buffer, &process_info->exe, &process_info->args);
+}
+
 }  // namespace
 
 StringView ExtractContainerID(StringView cgroup_line) {
@@ -562,26 +1252,111 @@ StringView ExtractContainerID(StringView cgroup_line) {
   return container_id_part.substr(0, 12);
 }
 
+bool IConnScraper::ScrapeSlice(int slice, int num_slices, std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
+  if (slice != 0) return true;
+  return Scrape(connections, listen_endpoints);
+}
+
+// SlicedScrapeState is the state of a time-sliced scrape, which is kept between the individual slices.
+struct SlicedScrapeState {
+  // All pids at the beginning of the scrape, in ascending order.
+  std::vector<uint64_t> pids;
+  // Connections of all network namespaces read so far.
+  ConnsByNS conns_by_ns;
+  // Sockets reported so far.
+  UnorderedSet<ino_t> resolved_sockets;
+};
+
 bool ConnScraper::Scrape(std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
-  return ReadContainerConnections(proc_path_.c_str(), process_store_, connections, listen_endpoints);
+  std::vector<uint64_t> pids;
+  if (!ListPids(proc_path_.c_str(), &pids)) return false;
+  PrunePidCache(pids, &pid_cache_);
+  MarkCgroupKeysUsed(pid_cache_, container_id_cache_.get());
+  container_id_cache_->Sweep();
+
+  UnorderedMap<ino_t, uint64_t> socket_owners;
+  if (infer_socket_owners_) {
+    socket_owners = SelectSocketOwners(pid_cache_);
+  }
+
+  ConnsByNS conns_by_ns;
+  return ReadContainerConnections(proc_path_.c_str(), pids, process_store_, &pid_cache_, container_id_cache_.get(), source_, workers_.get(),
+                                  &conns_by_ns, nullptr, infer_socket_owners_ ? &socket_owners : nullptr, connections, listen_endpoints);
 }
 
-bool ProcessScraper::Scrape(uint64_t pid, ProcessInfo& process_info) {
-  char process_path[64];
+bool ConnScraper::ScrapeSlice(int slice, int num_slices, std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) {
+  if (slice == 0) {
+    sliced_state_ = std::make_shared<SlicedScrapeState>();
+    if (!ListPids(proc_path_.c_str(), &sliced_state_->pids)) return false;
+    PrunePidCache(sliced_state_->pids, &pid_cache_);
+    MarkCgroupKeysUsed(pid_cache_, container_id_cache_.get());
+    container_id_cache_->Sweep();
+  }
+  if (!sliced_state_ || slice < 0 || slice >= num_slices) return false;
 
-  process_info.pid = pid;
+  // Slices are contiguous pid ranges with the same number of processes each.
+  const auto& pids = sliced_state_->pids;
+  std::vector<uint64_t> slice_pids(pids.begin() + pids.size() * slice / num_slices,
+                                   pids.begin() + pids.size() * (slice + 1) / num_slices);
 
-  snprintf(process_path, sizeof(process_path), "%s/%ld", proc_path_.c_str(), pid);
+  bool success = ReadContainerConnections(proc_path_.c_str(), slice_pids, process_store_, &pid_cache_, container_id_cache_.get(), source_, workers_.get(),
+                                          &sliced_state_->conns_by_ns, &sliced_state_->resolved_sockets, nullptr, connections, listen_endpoints);
 
-  FDHandle dirfd = open(process_path, O_DIRECTORY | O_RDONLY);
+  if (slice == num_slices - 1) {
+    const auto& resolved_sockets = sliced_state_->resolved_sockets;
+    InvalidateFDCaches(
+        sliced_state_->conns_by_ns, [&](ino_t inode) { return Contains(resolved_sockets, inode); }, &pid_cache_);
+    sliced_state_.reset();
+  }
+  return success;
+}
 
-  if (!dirfd.valid()) {
+bool ProcessScraper::Scrape(uint64_t pid, ProcessInfo& process_info) {
+  FDHandle procfd = open(proc_path_.c_str(), O_DIRECTORY | O_RDONLY);
+  if (!procfd.valid()) {
+    return false;
+  }
+
+  thread_local std::vector<char> buffer;
+  return ScrapeProcess(procfd, pid, container_id_cache_.get(), &buffer, &process_info);
+}
+
+bool ProcessScraper::ScrapeMany(const std::vector<uint64_t>& pids, std::vector<ProcessInfo>* process_infos) {
+  FDHandle procfd = open(proc_path_.c_str(), O_DIRECTORY | O_RDONLY);
+  if (!procfd.valid()) {
+    CLOG(ERROR) << "Could not open " << proc_path_ << ": " << StrError();
     return false;
   }
 
-  return GetContainerID(dirfd, &process_info.container_id) &&
-         ReadProcessExe(process_path, dirfd, process_info.comm, process_info.exe_path) &&
-         ReadProcessCmdline(process_path, dirfd, process_info.exe, process_info.args);
+  std::vector<ProcessInfo> results(pids.size());
+  std::vector<char> valid(pids.size());
+  std::atomic<size_t> next_pid(0);
+  workers_->Run([&](int worker) {
+    thread_local std::vector<char> buffer;
+    for (;;) {
+      size_t begin = next_pid.fetch_add(kProcWalkChunkSize);
+      if (begin >= pids.size()) break;
+      size_t end = std::min(begin + kProcWalkChunkSize, pids.size());
+      for (size_t i = begin; i < end; i++) {
+        valid[i] = ScrapeProcess(procfd, pids[i], container_id_cache_.get(), &buffer, &results[i]);
+      }
+    }
+  });
+
+  for (size_t i = 0; i < results.size(); i++) {
+    if (!valid[i]) continue;
+    process_infos->push_back(std::move(results[i]));
+  }
+  return true;
+}
+
+bool ProcessScraper::ScrapeAll(std::vector<ProcessInfo>* process_infos) {
+  std::vector<uint64_t> pids;
+  if (!ListPids(proc_path_.c_str(), &pids)) return false;
+  if (container_id_cache_) {
+    container_id_cache_->Sweep();
+  }
+  return ScrapeMany(pids, process_infos);
 }
 
 }  // namespace collector
@@ -24,54 +24,146 @@ You should have received a copy of the GNU General Public License along with thi
 #ifndef COLLECTOR_PROCFSSCRAPER_H
 #define COLLECTOR_PROCFSSCRAPER_H
 
+#include <chrono>
 #include <cstring>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "ContainerIDCache.h"
 #include "NetworkConnection.h"
+#include "Process.h"
+#include "Utility.h"
+#include "WorkerPool.h"
 
 namespace collector {
 
+// PidMetadata is the information about a process which rarely changes over its lifetime, and hence is cached across
+// scrapes, keyed by pid. The start time of the process is used to detect pid reuse, and the network namespace and cgroup
+// are re-validated as described in PidMetadataValid.
+struct PidMetadata {
+  uint64_t starttime;
+  uint32_t age = 0;  // number of scrapes since the metadata was read.
+  bool in_container;  // if false, this is a host process and only netns_inode is set, if it could be read.
+  std::string container_id;
+  std::string cgroup_key;  // key of the process in the ContainerIDCache, if one was used.
+  uint64_t netns_inode = 0;
+
+  // The following fields describe the open file descriptors of a container process as of the previous scrape, and are
+  // updated in place by every scrape.
+  std::vector<int> non_socket_fds;  // fds not referring to sockets, in ascending order.
+  uint32_t fd_cache_age = 0;        // number of scrapes since non_socket_fds was last fully verified.
+  size_t num_fds = 0;
+};
+
+using PidMetadataCache = UnorderedMap<uint64_t, PidMetadata>;
+
+// ConnectionSource determines how the connections of a network namespace are read.
+enum class ConnectionSource {
+  PROCFS,     // parse the `net/tcp[6]` files
+  SOCK_DIAG,  // query NETLINK_SOCK_DIAG, falling back to PROCFS on error
+};
+
 // Abstract interface for a ConnScraper. Useful to inject testing implementation.
 class IConnScraper {
  public:
   virtual bool Scrape(std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) = 0;
+
+  // ScrapeSlice scrapes one out of num_slices parts of the processes, such that a complete snapshot can be assembled
+  // from a sequence of calls for slices 0 to num_slices - 1, spread over time. Connections are appended to the given
+  // vectors. The default implementation scrapes everything in the first slice.
+  virtual bool ScrapeSlice(int slice, int num_slices, std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints);
+
+  // WorkerCPUTime returns the total CPU time spent scraping by threads other than the calling one.
+  virtual std::chrono::nanoseconds WorkerCPUTime() const { return std::chrono::nanoseconds(0); }
+
   virtual ~IConnScraper() {}
 };
 
+struct SlicedScrapeState;
+
 // ConnScraper is a class that allows scraping a `/proc`-like directory structure for active network connections.
 class ConnScraper : public IConnScraper {
  public:
-  explicit ConnScraper(std::string proc_path, std::shared_ptr<ProcessStore> process_store = 0)
-      : proc_path_(std::move(proc_path)),
-        process_store_(process_store) {}
-
-  // Scrape returns a snapshot of all active network connections in the given vector.
+  explicit ConnScraper(std::string proc_path, std::shared_ptr<ProcessStore> process_store = 0, int num_workers = 1)
+      : ConnScraper(std::move(proc_path), process_store, num_workers, ConnectionSource::PROCFS) {}
+
+  // If enabled, the fd directory of the process with the most open files in each network namespace is not walked in
+  // full scrapes. Instead, all sockets of the namespace which are not owned by any other process are attributed to it.
+  // Namespaces shared with non-container processes, such as the host network namespace, are excluded. This is only
+  // accurate if no short-lived process shares the namespace, hence it is off by default.
+  void SetInferSocketOwners(bool enable) { infer_socket_owners_ = enable; }
+
+  // SetContainerIDCache replaces the cache used to resolve the container IDs of new processes, such that it can be
+  // shared with other users, e.g., a ProcessScraper. Every scrape removes the entries of cgroups without any live
+  // process from it.
+  void SetContainerIDCache(std::shared_ptr<ContainerIDCache> container_id_cache) {
+    container_id_cache_ = std::move(container_id_cache);
+  }
+
+  // Scrape returns a snapshot of all active network connections in the given vector. The `/proc` directory is walked
+  // by num_workers workers, whose threads are kept across scrapes.
   bool Scrape(std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints);
 
+  // ScrapeSlice scrapes the processes of one out of num_slices pid ranges of equal size. The ranges are determined
+  // when scraping slice 0. Within the sequence of slices, the connections of each network namespace are read once.
+  bool ScrapeSlice(int slice, int num_slices, std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints);
+
+  std::chrono::nanoseconds WorkerCPUTime() const { return workers_->cpu_time(); }
+
+ protected:
+  ConnScraper(std::string proc_path, std::shared_ptr<ProcessStore> process_store, int num_workers, ConnectionSource source)
+      : proc_path_(std::move(proc_path)),
+        process_store_(process_store),
+        workers_(MakeUnique<WorkerPool>(num_workers)),
+        source_(source),
+        container_id_cache_(std::make_shared<ContainerIDCache>()) {}
+
  private:
   std::string proc_path_;
   std::shared_ptr<ProcessStore> process_store_;
+  std::unique_ptr<WorkerPool> workers_;
+  ConnectionSource source_;
+  PidMetadataCache pid_cache_;
+  std::shared_ptr<ContainerIDCache> container_id_cache_;
+  std::shared_ptr<SlicedScrapeState> sliced_state_;
+  bool infer_socket_owners_ = false;
+};
+
+// NetlinkConnScraper scrapes active network connections like ConnScraper, but obtains the sockets of each network
+// namespace via NETLINK_SOCK_DIAG instead of parsing `net/tcp[6]`. The `/proc`-like directory structure is still used
+// to attribute sockets to containers. If sock_diag is not usable for a network namespace (e.g., due to missing
+// privileges), the connections of that namespace are read from `net/tcp[6]` instead.
+class NetlinkConnScraper : public ConnScraper {
+ public:
+  explicit NetlinkConnScraper(std::string proc_path, std::shared_ptr<ProcessStore> process_store = 0, int num_workers = 1)
+      : ConnScraper(std::move(proc_path), process_store, num_workers, ConnectionSource::SOCK_DIAG) {}
 };
 
+// ProcessScraper reads information about processes from a `/proc`-like directory structure.
 class ProcessScraper {
  public:
-  ProcessScraper(std::string proc_path) : proc_path_(std::move(proc_path)) {}
-
-  class ProcessInfo {
-   public:
-    std::string container_id;
-    std::string comm;      // binary name
-    std::string exe;       // argv[0]
-    std::string exe_path;  // full binary path
-    std::string args;      // space separated concatenation of arguments
-    uint64_t pid;
-  };
+  // If container_id_cache is given, it is used to avoid parsing the cgroup files of processes in known cgroups. Bulk
+  // scrapes are run by num_workers workers, whose threads are kept across scrapes.
+  explicit ProcessScraper(std::string proc_path, std::shared_ptr<ContainerIDCache> container_id_cache = nullptr, int num_workers = 1)
+      : proc_path_(std::move(proc_path)), container_id_cache_(std::move(container_id_cache)), workers_(MakeUnique<WorkerPool>(num_workers)) {}
+
+  using ProcessInfo = collector::ProcessInfo;
 
   bool Scrape(uint64_t pid, ProcessInfo& pi);
 
+  // ScrapeMany scrapes the processes with the given pids, and appends the information of all container processes
+  // to process_infos, in the order of the given pids. Processes which exited or are not running in a container are
+  // skipped. Returns false if the `/proc` directory could not be opened.
+  bool ScrapeMany(const std::vector<uint64_t>& pids, std::vector<ProcessInfo>* process_infos);
+
+  // ScrapeAll scrapes all container processes, in ascending order of pids. Sweeps the container ID cache.
+  bool ScrapeAll(std::vector<ProcessInfo>* process_infos);
+
  private:
   std::string proc_path_;
+  std::shared_ptr<ContainerIDCache> container_id_cache_;
+  std::unique_ptr<WorkerPool> workers_;
 };
 
 }  // namespace collector
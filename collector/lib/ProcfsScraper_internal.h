@@ -24,13 +24,51 @@ You should have received a copy of the GNU General Public License along with thi
 #ifndef COLLECTOR_PROCFSSCRAPER_INTERNAL_H
 #define COLLECTOR_PROCFSSCRAPER_INTERNAL_H
 
+#include <sys/types.h>
+
+#include "Hash.h"
+#include "NetworkConnection.h"
+#include "ProcfsScraper.h"
 #include "StringView.h"
 
 namespace collector {
 
+struct ConnInfo {
+  Endpoint local;
+  Endpoint remote;
+  L4Proto l4proto;
+  bool is_server;
+};
+
+struct EndpointInfo {
+  Endpoint endpoint;
+  L4Proto l4proto;
+};
+
+// Minimum number of open files of a process for its sockets to be inferred from its network namespace, instead of
+// walking its fd directory.
+constexpr size_t kMinFDsForSocketInference = 1024;
+
+// Size of the buffer `net/tcp[6]` files are read into.
+constexpr size_t kConnReadBufferSize = 64 * 1024;
+
+// ReadConnectionsFromFile reads all connections from a `net/tcp[6]` file and stores them by inode in the given maps.
+// The file is read in large chunks into a reusable per-thread buffer, and parsed in place.
+bool ReadConnectionsFromFile(Address::Family family, L4Proto l4proto, int fd,
+                             UnorderedMap<ino_t, ConnInfo>* connections, UnorderedMap<ino_t, EndpointInfo>* listen_endpoints);
+
+// GetConnections reads all active connections and listen endpoints (inode -> info mapping) for a given network NS,
+// addressed by the dir FD for a proc entry of a process in that network namespace.
+bool GetConnections(int dirfd, ConnectionSource source, UnorderedMap<ino_t, ConnInfo>* connections, UnorderedMap<ino_t, EndpointInfo>* listen_endpoints);
+
 // ExtractContainerID tries to extract a container ID from a cgroup line.
 StringView ExtractContainerID(StringView cgroup_line);
 
+// GetContainerID retrieves the container ID of the process represented by dirfd from its `cgroup` file. Returns false
+// if the process is not running in a container. If cache is given, it is used to skip parsing the file for processes in
+// known cgroups. If cgroup_key is given, it is set to the key of the process in the cache.
+bool GetContainerID(int dirfd, ContainerIDCache* cache, std::string* container_id, std::string* cgroup_key = nullptr);
+
 }  // namespace collector
 
 #endif
@@ -24,14 +24,28 @@ You should have received a copy of the GNU General Public License along with thi
 #ifndef COLLECTOR_PROTOALLOCATOR_H
 #define COLLECTOR_PROTOALLOCATOR_H
 
+#include <algorithm>
+#include <cstdint>
+
 #ifdef USE_PROTO_ARENAS
 #  include <google/protobuf/arena.h>
 #endif
 
+#include "CollectorStats.h"
 #include "Logging.h"
 
 namespace collector {
 
+// ProtoAllocatorStats are statistics about the messages allocated by a ProtoAllocator since its creation.
+struct ProtoAllocatorStats {
+  uint64_t resets = 0;    // number of completed messages
+  uint64_t hits = 0;      // messages which fit into the pre-allocated pool
+  uint64_t grows = 0;     // number of times the pool was grown
+  uint64_t shrinks = 0;   // number of times the pool was shrunk
+  size_t pool_size = 0;   // current size of the pre-allocated pool
+  size_t high_water = 0;  // decaying maximum of the bytes used per message
+};
+
 namespace internal {
 
 #ifdef USE_PROTO_ARENAS
@@ -43,30 +57,54 @@ inline google::protobuf::ArenaOptions ArenaOptionsForInitialBlock(char* storage,
   return opts;
 }
 
+// ArenaProtoAllocator allocates messages in an arena with a pre-allocated initial block (the pool), which is reused
+// for every message. The pool is sized to the recent maximum message size: it grows when a message did not fit, and
+// shrinks again once the maximum has decayed after a spike. It never shrinks below its initial size, nor grows beyond
+// max_pool_size; larger messages are allocated in additional arena blocks, which are released on Reset.
 template <typename Message>
 class ArenaProtoAllocator {
  public:
   static constexpr size_t kDefaultPoolSize = 524288;
+  static constexpr size_t kDefaultMaxPoolSize = 16 * 1024 * 1024;
+  // The pool size is rounded up to a multiple of this.
+  static constexpr size_t kPoolGranularity = 65536;
 
   ArenaProtoAllocator() : ArenaProtoAllocator(kDefaultPoolSize) {}
 
-  explicit ArenaProtoAllocator(size_t pool_size)
-      : pool_(new char[pool_size]), pool_size_(pool_size), arena_(ArenaOptionsForInitialBlock(pool_.get(), pool_size_)) {}
+  explicit ArenaProtoAllocator(size_t pool_size, size_t max_pool_size = kDefaultMaxPoolSize)
+      : pool_(new char[pool_size]),
+        pool_size_(pool_size),
+        min_pool_size_(std::min(pool_size, max_pool_size)),
+        max_pool_size_(max_pool_size),
+        arena_(ArenaOptionsForInitialBlock(pool_.get(), pool_size_)) {}
 
   void Reset() {
-    google::protobuf::uint64 bytes_used = arena_.Reset();
-    if (bytes_used > pool_size_) {
-      size_t new_pool_size = (bytes_used / kDefaultPoolSize + 1) * kDefaultPoolSize;
-      CLOG(WARNING) << "Used " << bytes_used << " bytes in the arena, which is more than the pre-allocated "
-                    << pool_size_ << " bytes. Increasing arena size to " << new_pool_size << " bytes.";
-
-      // This looks weird but is correct (search for `placement new/delete` on Google).
-      arena_.~Arena();
-
-      pool_.reset(new char[new_pool_size]);
-      pool_size_ = new_pool_size;
+    size_t bytes_used = arena_.SpaceUsed();
+    google::protobuf::uint64 bytes_allocated = arena_.Reset();
+
+    stats_.resets++;
+    bool hit = bytes_allocated <= pool_size_;
+    if (hit) {
+      stats_.hits++;
+      COUNTER_INC(CollectorStats::proto_arena_hits);
+    } else {
+      COUNTER_INC(CollectorStats::proto_arena_misses);
+    }
 
-      new (&arena_) google::protobuf::Arena(ArenaOptionsForInitialBlock(pool_.get(), pool_size_));
+    // The high-water mark decays by 1/8 per message, such that a single spike is forgotten after a few dozen messages.
+    high_water_ = std::max(bytes_used, high_water_ - high_water_ / 8);
+
+    size_t target_size = TargetPoolSize();
+    if (!hit && target_size > pool_size_) {
+      CLOG(DEBUG) << "Used " << bytes_allocated << " bytes in the arena, which is more than the pre-allocated "
+                  << pool_size_ << " bytes. Increasing arena size to " << target_size << " bytes.";
+      ResizePool(target_size);
+      stats_.grows++;
+      COUNTER_INC(CollectorStats::proto_arena_grows);
+    } else if (target_size <= pool_size_ / 2) {
+      ResizePool(target_size);
+      stats_.shrinks++;
+      COUNTER_INC(CollectorStats::proto_arena_shrinks);
     }
   }
 
@@ -79,9 +117,38 @@ class ArenaProtoAllocator {
     return google::protobuf::Arena::CreateMessage<Message>(&arena_);
   }
 
+  ProtoAllocatorStats allocator_stats() const {
+    ProtoAllocatorStats stats = stats_;
+    stats.pool_size = pool_size_;
+    stats.high_water = high_water_;
+    return stats;
+  }
+
  private:
+  // TargetPoolSize returns the pool size for the recent maximum message size, with 25% headroom.
+  size_t TargetPoolSize() const {
+    size_t size = high_water_ + high_water_ / 4;
+    size = (size + kPoolGranularity - 1) / kPoolGranularity * kPoolGranularity;
+    return std::min(std::max(size, min_pool_size_), max_pool_size_);
+  }
+
+  // ResizePool replaces the pool with one of the given size. Must only be called while the arena is empty.
+  void ResizePool(size_t pool_size) {
+    // This looks weird but is correct (search for `placement new/delete` on Google).
+    arena_.~Arena();
+
+    pool_.reset(new char[pool_size]);
+    pool_size_ = pool_size;
+
+    new (&arena_) google::protobuf::Arena(ArenaOptionsForInitialBlock(pool_.get(), pool_size_));
+  }
+
   std::unique_ptr<char[]> pool_;
   size_t pool_size_;
+  size_t min_pool_size_;
+  size_t max_pool_size_;
+  size_t high_water_ = 0;
+  ProtoAllocatorStats stats_;
   google::protobuf::Arena arena_;
 };
 
@@ -92,9 +159,9 @@ class HeapProtoAllocator {
  public:
   HeapProtoAllocator() {}
 
-  HeapProtoAllocator(size_t) : HeapProtoAllocator() {}
+  explicit HeapProtoAllocator(size_t, size_t = 0) : HeapProtoAllocator() {}
 
-  void Reset() {}
+  void Reset() { stats_.resets++; }
 
   template <typename T, typename... Args>
   T* Allocate(Args&&... args) { return new T(std::forward<Args>(args)...); }
@@ -104,8 +171,11 @@ class HeapProtoAllocator {
     return &message_;
   }
 
+  ProtoAllocatorStats allocator_stats() const { return stats_; }
+
  private:
   Message message_;
+  ProtoAllocatorStats stats_;
 };
 
 }  // namespace internal
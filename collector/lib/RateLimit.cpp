@@ -23,8 +23,9 @@ You should have received a copy of the GNU General Public License along with thi
 
 #include "RateLimit.h"
 
+#include <algorithm>
+
 #include "CollectorStats.h"
-#include "Logging.h"
 #include "TimeUtil.h"
 #include "Utility.h"
 
@@ -69,26 +70,85 @@ void Limiter::fill_bucket(TokenBucket* b) {
   b->tokens = burst_size_;
 }
 
+namespace {
+
+size_t TableSize(size_t capacity) {
+  size_t size = 1;
+  while (size < 2 * capacity) size <<= 1;
+  return size;
+}
+
+}  // namespace
+
 // RateLimitCache Defaults: Limit duplicate events to rate of 10 every 30 min
 RateLimitCache::RateLimitCache()
-    : capacity_(4096), limiter_(new Limiter(10, 30 * 60)) {}
+    : RateLimitCache(4096, 10, 30 * 60) {}
 
 RateLimitCache::RateLimitCache(size_t capacity, int64_t burst_size, int64_t refill_time)
-    : capacity_(capacity), limiter_(new Limiter(burst_size, refill_time)) {}
+    : capacity_(std::max<size_t>(capacity, 1)), limiter_(new Limiter(burst_size, refill_time)), table_(TableSize(capacity_)) {}
 
 void RateLimitCache::ResetRateLimitCache() {
   limiter_.reset();
 }
 
-bool RateLimitCache::Allow(std::string key) {
-  auto pair = cache_.emplace(std::make_pair(key, TokenBucket()));
-  if (pair.second && cache_.size() > capacity_) {
-    CLOG(INFO) << "Flushing rate limiting cache";
-    cache_.clear();
-    COUNTER_INC(CollectorStats::rate_limit_flushing_counts);
-    return true;
+size_t RateLimitCache::Find(uint64_t key) const {
+  size_t mask = table_.size() - 1;
+  size_t i = key & mask;
+  while (table_[i].key != 0 && table_[i].key != key) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+void RateLimitCache::EvictOne() {
+  // Terminates within two rounds, as the first round clears all referenced flags.
+  size_t mask = table_.size() - 1;
+  for (;; clock_hand_ = (clock_hand_ + 1) & mask) {
+    Entry& entry = table_[clock_hand_];
+    if (entry.key == 0) continue;
+    if (entry.referenced) {
+      entry.referenced = false;
+      continue;
+    }
+    Erase(clock_hand_);
+    return;
+  }
+}
+
+void RateLimitCache::Erase(size_t i) {
+  size_t mask = table_.size() - 1;
+  for (size_t j = (i + 1) & mask; table_[j].key != 0; j = (j + 1) & mask) {
+    // The entry at j can fill the gap at i, unless its home slot lies cyclically in (i, j].
+    size_t home = table_[j].key & mask;
+    bool stays = (i < j) ? (i < home && home <= j) : (i < home || home <= j);
+    if (!stays) {
+      table_[i] = table_[j];
+      i = j;
+    }
+  }
+  table_[i] = Entry();
+  size_--;
+}
+
+bool RateLimitCache::Allow(uint64_t key) {
+  // 0 marks empty entries.
+  if (key == 0) key = 1;
+
+  size_t i = Find(key);
+  if (table_[i].key == 0) {
+    if (size_ >= capacity_) {
+      EvictOne();
+      COUNTER_INC(CollectorStats::rate_limit_evictions);
+      i = Find(key);
+    }
+    table_[i].key = key;
+    table_[i].referenced = false;
+    table_[i].bucket = TokenBucket();
+    size_++;
+  } else {
+    table_[i].referenced = true;
   }
-  return limiter_->Allow(&pair.first->second);
+  return limiter_->Allow(&table_[i].bucket);
 }
 
 }  // namespace collector
@@ -24,6 +24,11 @@ You should have received a copy of the GNU General Public License along with thi
 #ifndef _RATE_LIMIT_H_
 #define _RATE_LIMIT_H_
 
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
 #include "Utility.h"
 
 namespace collector {
@@ -49,17 +54,83 @@ class Limiter {
   int64_t refill_time_;  // amount of time between refill in microseconds
 };
 
+// RateLimitKeyHasher computes a 64-bit rate limiting key from a sequence of fields, without concatenating them. Each
+// field is terminated by its length, such that ("ab", "c") and ("a", "bc") result in different keys.
+class RateLimitKeyHasher {
+ public:
+  RateLimitKeyHasher& Add(const char* data, size_t len) {
+    const char* end = data + len;
+    for (; end - data >= 8; data += 8) {
+      uint64_t word;
+      std::memcpy(&word, data, 8);
+      Mix(word);
+    }
+    if (data != end) {
+      uint64_t word = 0;
+      std::memcpy(&word, data, end - data);
+      Mix(word);
+    }
+    Mix(len);
+    return *this;
+  }
+
+  RateLimitKeyHasher& Add(const std::string& str) {
+    return Add(str.data(), str.size());
+  }
+
+  uint64_t key() const {
+    // Finalizer of MurmurHash3, such that all bits of the state affect the low bits used to index the table.
+    uint64_t h = state_;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+ private:
+  void Mix(uint64_t word) {
+    state_ = (state_ ^ word) * 0x9e3779b97f4a7c15ULL;
+    state_ ^= state_ >> 29;
+  }
+
+  uint64_t state_ = 0x243f6a8885a308d3ULL;
+};
+
+// RateLimitCache keeps a token bucket per key, in a flat open-addressing table with room for capacity keys. Once the
+// table is full, a key is evicted for each new one with the CLOCK algorithm: keys that have been seen again since the
+// clock hand last passed them get a second chance, such that frequent keys stay in the table while one-off keys are
+// evicted.
 class RateLimitCache {
  public:
   RateLimitCache();
   RateLimitCache(size_t capacity, int64_t burst_size, int64_t refill_time);
   void ResetRateLimitCache();
-  bool Allow(std::string key);
+  bool Allow(uint64_t key);
+  bool Allow(const std::string& key) {
+    return Allow(RateLimitKeyHasher().Add(key).key());
+  }
 
  private:
+  struct Entry {
+    uint64_t key;  // 0 if the entry is empty
+    bool referenced;
+    TokenBucket bucket;
+  };
+
+  // Returns the index of the entry for the key, or of the empty entry where it would be inserted.
+  size_t Find(uint64_t key) const;
+  void EvictOne();
+  // Removes the entry at index i, and moves subsequent entries back such that probe sequences stay intact.
+  void Erase(size_t i);
+
   size_t capacity_;
   std::unique_ptr<Limiter> limiter_;
-  unordered_map<std::string, TokenBucket> cache_;
+  // Power of two of at least twice the capacity, such that probe sequences stay short.
+  std::vector<Entry> table_;
+  size_t size_ = 0;
+  size_t clock_hand_ = 0;
 };
 }  // namespace collector
 
@@ -0,0 +1,66 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include "ScrapeScheduler.h"
+
+#include <algorithm>
+#include <random>
+
+namespace collector {
+
+namespace {
+
+std::chrono::microseconds RandomOffset(std::chrono::microseconds interval) {
+  if (interval.count() <= 0) return std::chrono::microseconds(0);
+
+  std::random_device rd;
+  std::uniform_int_distribution<int64_t> dist(0, interval.count() - 1);
+  return std::chrono::microseconds(dist(rd));
+}
+
+}  // namespace
+
+ScrapeScheduler::ScrapeScheduler(std::chrono::microseconds interval, int num_slices, int cpu_budget_percent)
+    : ScrapeScheduler(interval, num_slices, cpu_budget_percent, RandomOffset(interval)) {}
+
+ScrapeScheduler::ScrapeScheduler(std::chrono::microseconds interval, int num_slices, int cpu_budget_percent, std::chrono::microseconds start_offset)
+    : interval_(interval),
+      num_slices_(std::max(num_slices, 1)),
+      cpu_budget_percent_(cpu_budget_percent),
+      start_offset_(start_offset) {}
+
+ScrapeScheduler::clock::time_point ScrapeScheduler::NextSliceTime(clock::time_point cycle_start, int next_slice, clock::time_point now, clock::duration last_slice_duration,
+                                                                  std::chrono::nanoseconds last_slice_cpu_time) const {
+  // Spread the slices evenly across the interval.
+  auto next_time = cycle_start + std::chrono::duration_cast<clock::duration>(interval_ * next_slice / num_slices_);
+
+  // Idle long enough after the last slice for the CPU time spent scraping to stay within the budget over the time
+  // from the start of the last slice until the next one. With several workers, the CPU time may exceed the duration.
+  if (cpu_budget_percent_ > 0 && cpu_budget_percent_ < 100) {
+    auto budget_time = std::chrono::duration_cast<clock::duration>(last_slice_cpu_time * 100 / cpu_budget_percent_);
+    next_time = std::max(next_time, now + (budget_time - last_slice_duration));
+  }
+  return next_time;
+}
+
+}  // namespace collector
@@ -0,0 +1,64 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#ifndef COLLECTOR_SCRAPESCHEDULER_H
+#define COLLECTOR_SCRAPESCHEDULER_H
+
+#include <chrono>
+
+namespace collector {
+
+// ScrapeScheduler determines when the slices of a time-sliced connection scrape are run. The slices of a scrape cycle
+// are spread evenly across the scrape interval, and are delayed further if needed to keep the CPU time spent scraping
+// (summed over all scrape workers) within the given budget. In addition, it provides a random offset for the start of the first scrape, to
+// avoid scrapes on many nodes happening at the same time.
+class ScrapeScheduler {
+ public:
+  using clock = std::chrono::system_clock;
+
+  // Creates a scheduler for the given number of slices per interval. cpu_budget_percent is the maximum CPU time spent
+  // scraping while a scrape cycle is in progress, as a percentage of the elapsed time (i.e., of a single CPU); 0 (or
+  // 100) means unlimited. The start offset is chosen
+  // randomly in [0, interval).
+  ScrapeScheduler(std::chrono::microseconds interval, int num_slices, int cpu_budget_percent);
+
+  ScrapeScheduler(std::chrono::microseconds interval, int num_slices, int cpu_budget_percent, std::chrono::microseconds start_offset);
+
+  int num_slices() const { return num_slices_; }
+  std::chrono::microseconds start_offset() const { return start_offset_; }
+
+  // NextSliceTime returns the earliest time at which slice next_slice of the scrape cycle started at cycle_start may
+  // run, given that the previous slice finished at now, took last_slice_duration, and consumed last_slice_cpu_time.
+  clock::time_point NextSliceTime(clock::time_point cycle_start, int next_slice, clock::time_point now, clock::duration last_slice_duration,
+                                  std::chrono::nanoseconds last_slice_cpu_time) const;
+
+ private:
+  std::chrono::microseconds interval_;
+  int num_slices_;
+  int cpu_budget_percent_;
+  std::chrono::microseconds start_offset_;
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_SCRAPESCHEDULER_H
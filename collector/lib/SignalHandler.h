@@ -44,9 +44,12 @@ class SignalHandler {
   virtual bool Start() { return true; }
   virtual bool Stop() { return true; }
   virtual Result HandleSignal(sinsp_evt* evt) = 0;
+  // Called for each existing process while the thread table is locked, hence should return quickly.
   virtual Result HandleExistingProcess(sinsp_threadinfo* tinfo) {
     return IGNORED;
   }
+  // Called once HandleExistingProcess was called for all existing processes, after the thread table is unlocked.
+  virtual void FinishExistingProcesses() {}
   virtual std::vector<std::string> GetRelevantEvents() = 0;
 };
 
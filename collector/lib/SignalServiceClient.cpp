@@ -32,17 +32,16 @@ You should have received a copy of the GNU General Public License along with thi
 
 namespace collector {
 
+constexpr size_t SignalServiceClient::kDefaultMaxQueueSize;
+
 bool SignalServiceClient::EstablishGRPCStreamSingle() {
-  std::mutex mtx;
-  std::unique_lock<std::mutex> lock(mtx);
-  stream_interrupted_.wait(lock, [this]() { return !stream_active_.load(std::memory_order_acquire) || thread_.should_stop(); });
   if (thread_.should_stop()) {
     return false;
   }
 
   CLOG(INFO) << "Trying to establish GRPC stream for signals ...";
 
-  if (!WaitForChannelReady(channel_, [this]() { return thread_.should_stop(); })) {
+  if (!WaitUntilChannelReady([this]() { return thread_.should_stop(); })) {
     return false;
   }
   if (thread_.should_stop()) {
@@ -51,7 +50,8 @@ bool SignalServiceClient::EstablishGRPCStreamSingle() {
 
   // stream writer
   context_ = MakeUnique<grpc::ClientContext>();
-  writer_ = DuplexClient::CreateWithReadsIgnored(&SignalService::Stub::AsyncPushSignals, channel_, context_.get());
+  context_->set_compression_algorithm(compression_);
+  writer_ = CreateWriter(context_.get());
   if (!writer_->WaitUntilStarted(std::chrono::seconds(30))) {
     CLOG(ERROR) << "Signal stream not ready after 30 seconds. Retrying ...";
     CLOG(ERROR) << "Error message: " << writer_->FinishNow().error_message();
@@ -60,9 +60,18 @@ bool SignalServiceClient::EstablishGRPCStreamSingle() {
   }
   CLOG(INFO) << "Successfully established GRPC stream for signals.";
 
-  first_write_ = true;
+  first_write_.store(true, std::memory_order_release);
   stream_active_.store(true, std::memory_order_release);
-  return true;
+
+  return SendQueuedSignals();
+}
+
+bool SignalServiceClient::WaitUntilChannelReady(const std::function<bool()>& check_stop) {
+  return WaitForChannelReady(channel_, check_stop);
+}
+
+std::unique_ptr<IDuplexClientWriter<SignalServiceClient::SignalStreamMessage>> SignalServiceClient::CreateWriter(grpc::ClientContext* context) {
+  return DuplexClient::CreateWithReadsIgnored(&SignalService::Stub::AsyncPushSignals, channel_, context);
 }
 
 void SignalServiceClient::EstablishGRPCStream() {
@@ -71,15 +80,87 @@ void SignalServiceClient::EstablishGRPCStream() {
   CLOG(INFO) << "Signal service client terminating.";
 }
 
+bool SignalServiceClient::SendQueuedSignals() {
+  std::deque<SignalStreamMessage> batch;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_cond_.wait(lock, [this]() { return !queue_.empty() || stopping_; });
+      if (stopping_) {
+        return false;
+      }
+      batch.swap(queue_);
+    }
+
+    // Signals that piled up while the previous batch was written are sent with a buffer hint, such that gRPC can
+    // coalesce them into fewer writes. The last one of a batch flushes them.
+    grpc::WriteOptions buffered;
+    buffered.set_buffer_hint();
+    for (size_t i = 0; i < batch.size(); i++) {
+      bool last = (i + 1 == batch.size());
+      if (!WaitUntilWritable() || !writer_->WriteAsync(batch[i], last ? grpc::WriteOptions() : buffered)) {
+        HandleStreamFailure(batch.size() - i);
+        return true;
+      }
+    }
+    batch.clear();
+  }
+}
+
+bool SignalServiceClient::WaitUntilWritable() {
+  // Waits in steps, such that a stalled stream does not prevent stopping the client.
+  for (;;) {
+    auto res = writer_->WaitUntilWritable(std::chrono::seconds(1));
+    if (res) return true;
+    if (!res.IsTimeout() || thread_.should_stop()) return false;
+  }
+}
+
+void SignalServiceClient::HandleStreamFailure(size_t unsent) {
+  if (thread_.should_stop()) {
+    return;
+  }
+
+  auto status = writer_->FinishNow();
+  if (!status.ok()) {
+    CLOG(ERROR) << "GRPC writes failed: " << status.error_message();
+  }
+  writer_.reset();
+
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stream_active_.store(false, std::memory_order_release);
+    unsent += queue_.size();
+    queue_.clear();
+  }
+  dropped_signals_.fetch_add(unsent, std::memory_order_relaxed);
+  CLOG(ERROR) << "GRPC stream interrupted";
+}
+
 void SignalServiceClient::Start() {
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stopping_ = false;
+  }
   thread_.Start([this] { EstablishGRPCStream(); });
 }
 
 void SignalServiceClient::Stop() {
-  stream_interrupted_.notify_one();
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stopping_ = true;
+  }
+  queue_cond_.notify_one();
   thread_.Stop();
-  context_->TryCancel();
-  context_.reset();
+  if (context_) {
+    context_->TryCancel();
+    context_.reset();
+  }
+}
+
+size_t SignalServiceClient::queued_signals() {
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  return queue_.size();
 }
 
 SignalHandler::Result SignalServiceClient::PushSignals(const SignalStreamMessage& msg) {
@@ -89,23 +170,25 @@ SignalHandler::Result SignalServiceClient::PushSignals(const SignalStreamMessage
     return SignalHandler::ERROR;
   }
 
-  if (first_write_) {
-    first_write_ = false;
+  if (first_write_.exchange(false, std::memory_order_acq_rel)) {
     return SignalHandler::NEEDS_REFRESH;
   }
 
-  if (!writer_->Write(msg)) {
-    auto status = writer_->FinishNow();
-    if (!status.ok()) {
-      CLOG(ERROR) << "GRPC writes failed: " << status.error_message();
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (!stream_active_.load(std::memory_order_relaxed)) {
+      return SignalHandler::ERROR;
     }
-    writer_.reset();
-
-    stream_active_.store(false, std::memory_order_release);
-    CLOG(ERROR) << "GRPC stream interrupted";
-    stream_interrupted_.notify_one();
-    return SignalHandler::ERROR;
+    if (queue_.size() >= max_queue_size_) {
+      dropped_signals_.fetch_add(1, std::memory_order_relaxed);
+      if (overflow_policy_ == OverflowPolicy::DROP_NEWEST) {
+        return SignalHandler::IGNORED;
+      }
+      queue_.pop_front();
+    }
+    queue_.push_back(msg);
   }
+  queue_cond_.notify_one();
 
   return SignalHandler::PROCESSED;
 }
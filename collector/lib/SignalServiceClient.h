@@ -27,6 +27,12 @@ You should have received a copy of the GNU General Public License along with thi
 // SIGNAL_SERVICE_CLIENT.h
 // This class defines our GRPC client abstraction
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <mutex>
 
 #include <grpc/grpc.h>
@@ -43,34 +49,87 @@ You should have received a copy of the GNU General Public License along with thi
 
 namespace collector {
 
-class SignalServiceClient {
+// The client through which process signals are sent to Sensor.
+class ISignalServiceClient {
+ public:
+  virtual ~ISignalServiceClient() {}
+
+  virtual void Start() = 0;
+  virtual void Stop() = 0;
+
+  virtual SignalHandler::Result PushSignals(const sensor::SignalStreamMessage& msg) = 0;
+
+  virtual uint64_t dropped_signals() const = 0;
+  virtual size_t queued_signals() = 0;
+  virtual size_t max_queue_size() const = 0;
+};
+
+// Signals are sent asynchronously: PushSignals adds them to a bounded queue, which the stream thread drains. The stream
+// thread takes all queued signals at once, hence up to twice the queue size of signals may be buffered: a full queue,
+// and the batch being written.
+class SignalServiceClient : public ISignalServiceClient {
  public:
   using SignalService = sensor::SignalService;
   using SignalStreamMessage = sensor::SignalStreamMessage;
 
-  explicit SignalServiceClient(std::shared_ptr<grpc::Channel> channel)
-      : channel_(std::move(channel)), stream_active_(false) {}
+  // Which signal is dropped when the queue is full.
+  enum class OverflowPolicy {
+    DROP_OLDEST,
+    DROP_NEWEST,
+  };
 
-  void Start();
-  void Stop();
+  static constexpr size_t kDefaultMaxQueueSize = 4096;
 
-  SignalHandler::Result PushSignals(const SignalStreamMessage& msg);
+  explicit SignalServiceClient(std::shared_ptr<grpc::Channel> channel, grpc_compression_algorithm compression = GRPC_COMPRESS_NONE,
+                               size_t max_queue_size = kDefaultMaxQueueSize, OverflowPolicy overflow_policy = OverflowPolicy::DROP_OLDEST)
+      : channel_(std::move(channel)), compression_(compression), stream_active_(false), max_queue_size_(std::max<size_t>(max_queue_size, 1)), overflow_policy_(overflow_policy), dropped_signals_(0), first_write_(false) {}
+
+  void Start() override;
+  void Stop() override;
+
+  // Queues the message for sending. Returns NEEDS_REFRESH instead for the first message after a stream has been
+  // established, ERROR if there is no stream, and IGNORED if the message was dropped because the queue is full.
+  SignalHandler::Result PushSignals(const SignalStreamMessage& msg) override;
+
+  // Number of signals dropped because the queue was full, or because the stream failed before they were sent.
+  uint64_t dropped_signals() const override { return dropped_signals_.load(std::memory_order_relaxed); }
+  // Number of signals waiting to be sent.
+  size_t queued_signals() override;
+  size_t max_queue_size() const override { return max_queue_size_; }
+
+ protected:
+  // Waits until the channel is ready, or until check_stop returns true. Returns false in the latter case.
+  virtual bool WaitUntilChannelReady(const std::function<bool()>& check_stop);
+  // Opens a new stream for pushing signals.
+  virtual std::unique_ptr<IDuplexClientWriter<SignalStreamMessage>> CreateWriter(grpc::ClientContext* context);
 
  private:
   void EstablishGRPCStream();
   bool EstablishGRPCStreamSingle();
+  // Sends queued signals until the stream fails or the client is stopped. Returns false in the latter case.
+  bool SendQueuedSignals();
+  bool WaitUntilWritable();
+  void HandleStreamFailure(size_t unsent);
 
   std::shared_ptr<grpc::Channel> channel_;
+  grpc_compression_algorithm compression_;
 
   StoppableThread thread_;
   std::atomic<bool> stream_active_;
-  std::condition_variable stream_interrupted_;
 
   // This needs to have the same lifetime as the class.
   std::unique_ptr<grpc::ClientContext> context_;
   std::unique_ptr<IDuplexClientWriter<SignalStreamMessage>> writer_;
 
-  bool first_write_;
+  std::mutex queue_mutex_;
+  std::condition_variable queue_cond_;
+  std::deque<SignalStreamMessage> queue_;
+  bool stopping_ = false;
+  size_t max_queue_size_;
+  OverflowPolicy overflow_policy_;
+  std::atomic<uint64_t> dropped_signals_;
+
+  std::atomic<bool> first_write_;
 };
 
 }  // namespace collector
@@ -0,0 +1,180 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include "SockDiag.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sched.h>
+
+#include <arpa/inet.h>
+#include <linux/inet_diag.h>
+#include <linux/netlink.h>
+#include <linux/sock_diag.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "Logging.h"
+#include "Utility.h"
+
+namespace collector {
+
+namespace {
+
+// Only ESTABLISHED and LISTEN sockets are of interest, let the kernel filter out everything else.
+constexpr uint32_t kTcpStates = (1U << TCP_ESTABLISHED) | (1U << TCP_LISTEN);
+
+// The kernel sizes dump responses based on the receive buffer, 32KB allows for batches of a few hundred sockets.
+constexpr size_t kRecvBufferSize = 32 * 1024;
+
+FDHandle CreateSockDiagSocket() {
+  return socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+}
+
+bool SendDumpRequest(int diag_fd, int af, uint32_t seq) {
+  struct {
+    struct nlmsghdr nlh;
+    struct inet_diag_req_v2 req;
+  } request;
+  std::memset(&request, 0, sizeof(request));
+
+  request.nlh.nlmsg_len = sizeof(request);
+  request.nlh.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+  request.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  request.nlh.nlmsg_seq = seq;
+  request.req.sdiag_family = af;
+  request.req.sdiag_protocol = IPPROTO_TCP;
+  request.req.idiag_states = kTcpStates;
+
+  struct sockaddr_nl kernel;
+  std::memset(&kernel, 0, sizeof(kernel));
+  kernel.nl_family = AF_NETLINK;
+
+  ssize_t nsent;
+  do {
+    nsent = sendto(diag_fd, &request, sizeof(request), 0, reinterpret_cast<struct sockaddr*>(&kernel), sizeof(kernel));
+  } while (nsent < 0 && errno == EINTR);
+
+  return nsent == sizeof(request);
+}
+
+InetDiagSocket ToInetDiagSocket(Address::Family family, const struct inet_diag_msg& msg) {
+  // Addresses and ports are reported in network byte order, which is what Address expects.
+  std::array<uint8_t, Address::kMaxLen> local_data = {};
+  std::array<uint8_t, Address::kMaxLen> remote_data = {};
+  std::memcpy(local_data.data(), msg.id.idiag_src, Address::Length(family));
+  std::memcpy(remote_data.data(), msg.id.idiag_dst, Address::Length(family));
+
+  InetDiagSocket socket;
+  socket.local = Endpoint(Address(family, local_data), ntohs(msg.id.idiag_sport));
+  socket.remote = Endpoint(Address(family, remote_data), ntohs(msg.id.idiag_dport));
+  socket.state = msg.idiag_state;
+  socket.inode = static_cast<ino_t>(msg.idiag_inode);
+  return socket;
+}
+
+}  // namespace
+
+FDHandle OpenSockDiagSocket(int netns_fd) {
+  if (netns_fd < 0) {
+    return CreateSockDiagSocket();
+  }
+
+  FDHandle own_netns = open("/proc/thread-self/ns/net", O_RDONLY | O_CLOEXEC);
+  if (!own_netns.valid()) {
+    CLOG(ERROR) << "Could not open own network namespace: " << StrError();
+    return -1;
+  }
+
+  if (setns(netns_fd, CLONE_NEWNET) != 0) {
+    return -1;
+  }
+
+  // A netlink socket is bound to the network namespace it was created in, so it can be used after switching back.
+  FDHandle diag_fd = CreateSockDiagSocket();
+  int saved_errno = errno;
+
+  if (setns(own_netns, CLONE_NEWNET) != 0) {
+    CLOG(FATAL) << "Could not restore network namespace: " << StrError();
+  }
+
+  errno = saved_errno;
+  return diag_fd;
+}
+
+bool DumpTcpSockets(int diag_fd, Address::Family family, std::vector<InetDiagSocket>* sockets) {
+  int af;
+  switch (family) {
+    case Address::Family::IPV4:
+      af = AF_INET;
+      break;
+    case Address::Family::IPV6:
+      af = AF_INET6;
+      break;
+    default:
+      return false;
+  }
+
+  static thread_local uint32_t last_seq;
+  uint32_t seq = ++last_seq;
+
+  if (!SendDumpRequest(diag_fd, af, seq)) {
+    CLOG(ERROR) << "Could not send sock_diag request: " << StrError();
+    return false;
+  }
+
+  alignas(struct nlmsghdr) char buf[kRecvBufferSize];
+
+  for (;;) {
+    ssize_t nread = recv(diag_fd, buf, sizeof(buf), 0);
+    if (nread < 0) {
+      if (errno == EINTR) continue;
+      CLOG(ERROR) << "Could not receive sock_diag response: " << StrError();
+      return false;
+    }
+    if (nread == 0) return false;
+
+    int len = static_cast<int>(nread);
+    for (auto* nlh = reinterpret_cast<struct nlmsghdr*>(buf); NLMSG_OK(nlh, len); nlh = NLMSG_NEXT(nlh, len)) {
+      if (nlh->nlmsg_seq != seq) continue;
+
+      if (nlh->nlmsg_type == NLMSG_DONE) return true;
+
+      if (nlh->nlmsg_type == NLMSG_ERROR) {
+        const auto* err = static_cast<const struct nlmsgerr*>(NLMSG_DATA(nlh));
+        CLOG(ERROR) << "sock_diag request failed: " << StrError(-err->error);
+        return false;
+      }
+
+      if (nlh->nlmsg_type != SOCK_DIAG_BY_FAMILY) continue;
+      if (nlh->nlmsg_len < NLMSG_LENGTH(sizeof(struct inet_diag_msg))) continue;
+
+      const auto* msg = static_cast<const struct inet_diag_msg*>(NLMSG_DATA(nlh));
+      sockets->push_back(ToInetDiagSocket(family, *msg));
+    }
+  }
+}
+
+}  // namespace collector
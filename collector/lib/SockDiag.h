@@ -0,0 +1,56 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#ifndef COLLECTOR_SOCKDIAG_H
+#define COLLECTOR_SOCKDIAG_H
+
+#include <sys/types.h>
+
+#include <vector>
+
+#include "FileSystem.h"
+#include "NetworkConnection.h"
+
+namespace collector {
+
+// InetDiagSocket is the interesting (for our purposes) subset of the information the kernel reports about a single
+// TCP socket via the NETLINK_SOCK_DIAG interface.
+struct InetDiagSocket {
+  Endpoint local;
+  Endpoint remote;
+  uint8_t state;
+  ino_t inode;
+};
+
+// OpenSockDiagSocket opens a NETLINK_SOCK_DIAG socket in the network namespace referred to by netns_fd, or in the
+// network namespace of the calling thread if netns_fd is negative. Entering the namespace temporarily switches the
+// network namespace of the calling thread, which requires CAP_SYS_ADMIN. Returns an invalid handle on error.
+FDHandle OpenSockDiagSocket(int netns_fd = -1);
+
+// DumpTcpSockets appends all TCP sockets of the given address family in ESTABLISHED or LISTEN state to *sockets,
+// using the given NETLINK_SOCK_DIAG socket. Returns false if the dump could not be completed.
+bool DumpTcpSockets(int diag_fd, Address::Family family, std::vector<InetDiagSocket>* sockets);
+
+}  // namespace collector
+
+#endif  // COLLECTOR_SOCKDIAG_H
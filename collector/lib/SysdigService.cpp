@@ -56,7 +56,9 @@ void SysdigService::Init(const CollectorConfig& config, std::shared_ptr<Connecti
   }
 
   if (config.grpc_channel) {
-    AddSignalHandler(MakeUnique<ProcessSignalHandler>(inspector_.get(), config.grpc_channel, &userspace_stats_));
+    auto overflow_policy = config.SignalQueueDropNewest() ? SignalServiceClient::OverflowPolicy::DROP_NEWEST : SignalServiceClient::OverflowPolicy::DROP_OLDEST;
+    AddSignalHandler(MakeUnique<ProcessSignalHandler>(inspector_.get(), config.grpc_channel, &userspace_stats_, config.SignalGRPCCompression(),
+                                                      config.SignalQueueSize(), overflow_policy));
   }
 
   if (signal_handlers_.empty()) {
@@ -235,29 +237,35 @@ void SysdigService::Run(const std::atomic<ControlValue>& control) {
 }
 
 bool SysdigService::SendExistingProcesses(SignalHandler* handler) {
-  std::lock_guard<std::mutex> lock(libsinsp_mutex_);
+  bool success;
+  {
+    std::lock_guard<std::mutex> lock(libsinsp_mutex_);
 
-  if (!inspector_ || !chisel_) {
-    throw CollectorException("Invalid state: SysdigService was not initialized");
-  }
+    if (!inspector_ || !chisel_) {
+      throw CollectorException("Invalid state: SysdigService was not initialized");
+    }
 
-  auto threads = inspector_->m_thread_manager->get_threads();
-  if (!threads) {
-    CLOG(WARNING) << "Null thread manager";
-    return false;
-  }
+    auto threads = inspector_->m_thread_manager->get_threads();
+    if (!threads) {
+      CLOG(WARNING) << "Null thread manager";
+      return false;
+    }
 
-  return threads->loop([&](sinsp_threadinfo& tinfo) {
-    if (!tinfo.m_container_id.empty() && tinfo.is_main_thread()) {
-      auto result = handler->HandleExistingProcess(&tinfo);
-      if (result == SignalHandler::ERROR || result == SignalHandler::NEEDS_REFRESH) {
-        CLOG(WARNING) << "Failed to write existing process signal: " << &tinfo;
-        return false;
+    success = threads->loop([&](sinsp_threadinfo& tinfo) {
+      if (!tinfo.m_container_id.empty() && tinfo.is_main_thread()) {
+        auto result = handler->HandleExistingProcess(&tinfo);
+        if (result == SignalHandler::ERROR || result == SignalHandler::NEEDS_REFRESH) {
+          CLOG(WARNING) << "Failed to write existing process signal: " << &tinfo;
+          return false;
+        }
+        CLOG(DEBUG) << "Found existing process: " << &tinfo;
       }
-      CLOG(DEBUG) << "Found existing process: " << &tinfo;
-    }
-    return true;
-  });
+      return true;
+    });
+  }
+
+  handler->FinishExistingProcesses();
+  return success;
 }
 
 void SysdigService::CleanUp() {
@@ -25,6 +25,7 @@ You should have received a copy of the GNU General Public License along with thi
 #define COLLECTOR_TIME_UTIL_H
 
 #include <chrono>
+#include <ctime>
 
 namespace collector {
 
@@ -33,6 +34,13 @@ inline int64_t NowMicros() {
   return std::chrono::system_clock::now().time_since_epoch() / std::chrono::microseconds(1);
 }
 
+// ThreadCPUTime returns the CPU time consumed by the calling thread so far.
+inline std::chrono::nanoseconds ThreadCPUTime() {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return std::chrono::nanoseconds(0);
+  return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+}
+
 }  // namespace collector
 
 #endif  // COLLECTOR_TIME_UTIL_H
@@ -34,10 +34,13 @@ extern "C" {
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/random.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
-#include <uuid/uuid.h>
 }
 
+#include <chrono>
+
 #include <fstream>
 #include <regex>
 
@@ -147,6 +150,62 @@ std::string normalizeReleaseString(HostInfo& host) {
   return kernel.release;
 }
 
+// A xoshiro256** pseudo-random number generator (https://prng.di.unimi.it/), seeded from the kernel's random source
+// on construction.
+class UUIDRandom {
+ public:
+  UUIDRandom() {
+    if (!ReadSeed()) {
+      // getrandom may only fail on kernels before 3.17. Fall back to a seed that is unique per thread.
+      uint64_t seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+      seed ^= static_cast<uint64_t>(syscall(SYS_gettid)) << 32;
+      for (auto& s : state_) s = SplitMix64(&seed);
+    }
+  }
+
+  uint64_t Next() {
+    const uint64_t result = Rotl(state_[1] * 5, 7) * 9;
+    const uint64_t t = state_[1] << 17;
+
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = Rotl(state_[3], 45);
+
+    return result;
+  }
+
+ private:
+  static uint64_t Rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+  static uint64_t SplitMix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  bool ReadSeed() {
+    char* buf = reinterpret_cast<char*>(state_);
+    size_t len = sizeof(state_);
+    while (len > 0) {
+      ssize_t n = getrandom(buf, len, 0);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        return false;
+      }
+      buf += n;
+      len -= n;
+    }
+    // The all-zero state is the one state the generator never leaves.
+    return (state_[0] | state_[1] | state_[2] | state_[3]) != 0;
+  }
+
+  uint64_t state_[4];
+};
+
 }  // namespace
 
 static constexpr int kMsgBufSize = 4096;
@@ -188,12 +247,37 @@ std::ostream& operator<<(std::ostream& os, const sinsp_threadinfo* t) {
   return os;
 }
 
+void JoinProcessArgs(const std::vector<std::string>& args, std::string* out) {
+  out->clear();
+  if (args.empty()) return;
+
+  size_t size = args.size() - 1;
+  for (const auto& arg : args) size += arg.size();
+  out->reserve(size);
+
+  for (auto it = args.begin(); it != args.end(); ++it) {
+    if (it != args.begin()) out->push_back(' ');
+    out->append(*it);
+  }
+}
+
 const char* UUIDStr() {
-  uuid_t uuid;
-  constexpr int kUuidStringLength = 36;  // uuid_unparse manpage says so.
+  static const char kHexDigits[] = "0123456789abcdef";
+  constexpr int kUuidStringLength = 36;
+  thread_local UUIDRandom random;
   thread_local char uuid_str[kUuidStringLength + 1];
-  uuid_generate_time_safe(uuid);
-  uuid_unparse_lower(uuid, uuid_str);
+
+  // Set the version (4, random) and the variant (RFC 4122) bits.
+  uint64_t words[2] = {random.Next(), random.Next()};
+  words[0] = (words[0] & ~0xf000ULL) | 0x4000ULL;
+  words[1] = (words[1] & ~(3ULL << 62)) | (2ULL << 62);
+
+  char* out = uuid_str;
+  for (int i = 0; i < 32; i++) {
+    if (i == 8 || i == 12 || i == 16 || i == 20) *out++ = '-';
+    *out++ = kHexDigits[(words[i / 16] >> (60 - 4 * (i % 16))) & 0xf];
+  }
+  *out = '\0';
 
   return uuid_str;
 }
@@ -32,6 +32,7 @@ You should have received a copy of the GNU General Public License along with thi
 #include <mutex>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 #include "libsinsp/sinsp.h"
 
@@ -99,7 +100,11 @@ std::string Str(Args&&... args) {
 
 std::ostream& operator<<(std::ostream& os, const sinsp_threadinfo* t);
 
-// UUIDStr returns UUID in string format.
+// Joins the process arguments, separated by spaces, into out, replacing its contents.
+void JoinProcessArgs(const std::vector<std::string>& args, std::string* out);
+
+// UUIDStr returns a random (version 4) UUID in string format. The returned buffer is owned by the calling thread and
+// overwritten by its next call.
 const char* UUIDStr();
 
 namespace internal {
@@ -0,0 +1,102 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+#include "TimeUtil.h"
+
+namespace collector {
+
+WorkerPool::WorkerPool(int num_workers) {
+  for (int worker = 1; worker < num_workers; worker++) {
+    threads_.emplace_back(&WorkerPool::WorkerLoop, this, worker);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  start_cond_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkerPool::Run(int max_workers, const std::function<void(int)>& fn) {
+  int num_active = std::max(1, std::min(max_workers, num_workers()));
+  if (num_active == 1) {
+    fn(0);
+    return;
+  }
+
+  std::lock_guard<std::mutex> run_lock(run_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fn_ = &fn;
+    active_workers_ = num_active;
+    running_workers_ = num_active - 1;
+    generation_++;
+  }
+  start_cond_.notify_all();
+
+  fn(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cond_.wait(lock, [this]() { return running_workers_ == 0; });
+  fn_ = nullptr;
+}
+
+std::chrono::nanoseconds WorkerPool::cpu_time() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return cpu_time_;
+}
+
+void WorkerPool::WorkerLoop(int worker) {
+  uint64_t last_generation = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    start_cond_.wait(lock, [this, last_generation]() { return stopping_ || generation_ != last_generation; });
+    if (stopping_) return;
+    last_generation = generation_;
+    if (worker >= active_workers_) continue;
+
+    const auto* fn = fn_;
+    lock.unlock();
+    auto start_cpu_time = ThreadCPUTime();
+    (*fn)(worker);
+    auto fn_cpu_time = ThreadCPUTime() - start_cpu_time;
+    lock.lock();
+    cpu_time_ += fn_cpu_time;
+
+    if (--running_workers_ == 0) {
+      done_cond_.notify_one();
+    }
+  }
+}
+
+}  // namespace collector
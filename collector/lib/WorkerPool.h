@@ -0,0 +1,80 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#ifndef COLLECTOR_WORKERPOOL_H
+#define COLLECTOR_WORKERPOOL_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace collector {
+
+// WorkerPool runs a function on a fixed number of workers in parallel. The calling thread acts as worker 0, the other
+// workers are threads which are kept across calls of Run, such that their per-thread state (e.g., thread_local
+// buffers) is retained. Calls of Run are serialized.
+class WorkerPool {
+ public:
+  explicit WorkerPool(int num_workers);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  int num_workers() const { return static_cast<int>(threads_.size()) + 1; }
+
+  // Run invokes fn(worker) for every worker index in [0, min(max_workers, num_workers())), and waits for all of these
+  // invocations to finish.
+  void Run(int max_workers, const std::function<void(int)>& fn);
+  void Run(const std::function<void(int)>& fn) { Run(num_workers(), fn); }
+
+  // cpu_time returns the total CPU time the threads of the pool spent running functions. The time spent by the calling
+  // thread of Run (worker 0) is not included.
+  std::chrono::nanoseconds cpu_time() const;
+
+ private:
+  void WorkerLoop(int worker);
+
+  std::vector<std::thread> threads_;
+
+  std::mutex run_mutex_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable start_cond_;
+  std::condition_variable done_cond_;
+  uint64_t generation_ = 0;
+  const std::function<void(int)>* fn_ = nullptr;
+  int active_workers_ = 0;
+  int running_workers_ = 0;
+  bool stopping_ = false;
+  std::chrono::nanoseconds cpu_time_{0};
+};
+
+}  // namespace collector
+
+#endif  // COLLECTOR_WORKERPOOL_H
@@ -21,6 +21,18 @@ You should have received a copy of the GNU General Public License along with thi
 * version.
 */
 
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <ftw.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+
+#include "CollectorStats.h"
+#include "FakeProcDir.h"
+#include "FileSystem.h"
+#include "Hash.h"
 #include "ProcfsScraper_internal.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -67,6 +79,474 @@ TEST(ConnScraperTest, TestExtractContainerID) {
   }
 }
 
+TEST(ConnScraperTest, TestGetContainerID) {
+  struct TestCase {
+    std::string cgroup;
+    bool in_container;
+    std::string container_id;
+  };
+
+  TestCase cases[] = {
+      // cgroup v1
+      {"12:pids:/docker/951e643e3c241b225b6284ef2b79a37c13fc64cbf65b5d46bda95fcb98fe63a4\n"
+       "11:cpu,cpuacct:/docker/951e643e3c241b225b6284ef2b79a37c13fc64cbf65b5d46bda95fcb98fe63a4\n"
+       "0::/system.slice/containerd.service\n",
+       true, "951e643e3c24"},
+      {"12:pids:/\n11:cpu,cpuacct:/user.slice\n", false, ""},
+      // cgroup v2
+      {"0::/kubepods.slice/kubepods-burstable.slice/kubepods-burstable-podce705797_e47e_11e9_bd71_42010a000002.slice/cri-containerd-6525e65814a99d431b6978e8f8c895013176c6c58173b56639d4b020c14e6022.scope\n",
+       true, "6525e65814a9"},
+      {"0::/init.scope\n", false, ""},
+      {"0::/system.slice/docker-c3bfd81b7da0be97190a74a7d459f4dfa18f57c88765cde2613af112020a1c4b.scope", true, "c3bfd81b7da0"},
+  };
+
+  char dir_template[] = "/tmp/collector-cgroup-XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  std::string cgroup_path = std::string(dir_template) + "/cgroup";
+  FDHandle dirfd = open(dir_template, O_RDONLY | O_DIRECTORY);
+  ASSERT_TRUE(dirfd.valid());
+
+  ContainerIDCache cache;
+  for (int pass = 0; pass < 2; pass++) {
+    for (const auto& c : cases) {
+      std::FILE* f = std::fopen(cgroup_path.c_str(), "w");
+      ASSERT_NE(f, nullptr);
+      std::fputs(c.cgroup.c_str(), f);
+      std::fclose(f);
+
+      for (ContainerIDCache* container_id_cache : {static_cast<ContainerIDCache*>(nullptr), &cache}) {
+        std::string container_id;
+        EXPECT_EQ(GetContainerID(dirfd, container_id_cache, &container_id), c.in_container) << c.cgroup;
+        if (c.in_container) {
+          EXPECT_EQ(container_id, c.container_id);
+        }
+      }
+    }
+    EXPECT_EQ(cache.size(), 5);
+  }
+
+  // Entries not used since the previous sweep are removed.
+  cache.Sweep();
+  EXPECT_EQ(cache.size(), 5);
+  cache.Sweep();
+  EXPECT_EQ(cache.size(), 0);
+
+  unlink(cgroup_path.c_str());
+  rmdir(dir_template);
+}
+
+// WriteTempFile returns a file descriptor of an unlinked temporary file with the given contents.
+int WriteTempFile(const std::string& contents) {
+  std::FILE* f = std::tmpfile();
+  std::fputs(contents.c_str(), f);
+  std::fflush(f);
+  int fd = dup(fileno(f));
+  std::fclose(f);
+  lseek(fd, 0, SEEK_SET);
+  return fd;
+}
+
+const char kNetTcpHeader[] = "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n";
+
+std::string NetTcpLine(int sl, const char* local, const char* remote, const char* state, int inode) {
+  char line[256];
+  snprintf(line, sizeof(line), "%4d: %s %s %s 00000000:00000000 00:00000000 00000000     0        0 %d 1 0000000000000000 100 0 0 10 0\n",
+           sl, local, remote, state, inode);
+  return line;
+}
+
+TEST(ConnScraperTest, TestReadConnectionsFromFile) {
+  std::string contents = kNetTcpHeader;
+  contents += NetTcpLine(0, "0100000A:0050", "00000000:0000", "0A", 100);   // 10.0.0.1:80, LISTEN
+  contents += NetTcpLine(1, "0100000A:0050", "0200000A:C350", "01", 101);   // ESTABLISHED, server side
+  contents += NetTcpLine(2, "0100000A:C351", "0300000A:01BB", "01", 102);   // ESTABLISHED, client side
+  contents += NetTcpLine(3, "0100000A:C352", "0300000A:01BB", "06", 0);     // TIME_WAIT
+  contents += NetTcpLine(4, "0100000A:C353", "0300000A:01BB", "01", 0);     // ESTABLISHED, no inode
+  contents += NetTcpLine(5, "0100000A:C35X", "0300000A:01BB", "01", 105);   // invalid port
+
+  FDHandle fd = WriteTempFile(contents);
+  UnorderedMap<ino_t, ConnInfo> connections;
+  UnorderedMap<ino_t, EndpointInfo> listen_endpoints;
+  ASSERT_TRUE(ReadConnectionsFromFile(Address::Family::IPV4, L4Proto::TCP, fd, &connections, &listen_endpoints));
+
+  ASSERT_EQ(listen_endpoints.size(), 1);
+  EXPECT_EQ(listen_endpoints[100].endpoint, Endpoint(Address(10, 0, 0, 1), 80));
+
+  ASSERT_EQ(connections.size(), 2);
+  EXPECT_EQ(connections[101].local, Endpoint(Address(10, 0, 0, 1), 80));
+  EXPECT_EQ(connections[101].remote, Endpoint(Address(10, 0, 0, 2), 50000));
+  EXPECT_TRUE(connections[101].is_server);
+  EXPECT_EQ(connections[102].local, Endpoint(Address(10, 0, 0, 1), 50001));
+  EXPECT_EQ(connections[102].remote, Endpoint(Address(10, 0, 0, 3), 443));
+  EXPECT_FALSE(connections[102].is_server);
+}
+
+TEST(ConnScraperTest, TestReadConnectionsFromFileIPv6) {
+  std::string contents = kNetTcpHeader;
+  // [fd00::1]:443 -> [fd00::2]:50000
+  contents += NetTcpLine(0, "000000FD000000000000000001000000:01BB", "000000FD000000000000000002000000:C350", "01", 200);
+
+  FDHandle fd = WriteTempFile(contents);
+  UnorderedMap<ino_t, ConnInfo> connections;
+  ASSERT_TRUE(ReadConnectionsFromFile(Address::Family::IPV6, L4Proto::TCP, fd, &connections, nullptr));
+
+  ASSERT_EQ(connections.size(), 1);
+  EXPECT_EQ(connections[200].local, Endpoint(Address(htonll(0xfd00000000000000ULL), htonll(1ULL)), 443));
+  EXPECT_EQ(connections[200].remote, Endpoint(Address(htonll(0xfd00000000000000ULL), htonll(2ULL)), 50000));
+}
+
+TEST(ConnScraperTest, TestReadConnectionsFromFileMultipleChunks) {
+  // Make sure lines crossing the boundary of read chunks are handled correctly.
+  std::string contents = kNetTcpHeader;
+  int num_lines = 3 * kConnReadBufferSize / NetTcpLine(0, "0100000A:0050", "0200000A:C350", "01", 1).size();
+  for (int i = 0; i < num_lines; i++) {
+    char remote[24];
+    snprintf(remote, sizeof(remote), "0200000A:%04X", 1024 + i);
+    contents += NetTcpLine(i, "0100000A:0050", remote, "01", 1000 + i);
+  }
+  // No trailing newline after the last line.
+  contents += NetTcpLine(num_lines, "0100000A:0050", "0300000A:0400", "01", 1000 + num_lines);
+  contents.pop_back();
+
+  FDHandle fd = WriteTempFile(contents);
+  UnorderedMap<ino_t, ConnInfo> connections;
+  ASSERT_TRUE(ReadConnectionsFromFile(Address::Family::IPV4, L4Proto::TCP, fd, &connections, nullptr));
+
+  ASSERT_EQ(connections.size(), num_lines + 1);
+  for (int i = 0; i < num_lines; i++) {
+    EXPECT_EQ(connections[1000 + i].remote, Endpoint(Address(10, 0, 0, 2), 1024 + i));
+  }
+  EXPECT_EQ(connections[1000 + num_lines].remote, Endpoint(Address(10, 0, 0, 3), 1024));
+}
+
+int RemoveEntry(const char* path, const struct stat* sb, int typeflag, struct FTW* ftwbuf) {
+  return remove(path);
+}
+
+TEST(ConnScraperTest, TestNonSocketFDReuse) {
+  char dir_template[] = "/tmp/collector-proc-XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  std::string proc_path = dir_template;
+  std::string pid_path = proc_path + "/42";
+  ASSERT_EQ(mkdir(pid_path.c_str(), 0755), 0);
+  ASSERT_EQ(mkdir((pid_path + "/fd").c_str(), 0755), 0);
+  ASSERT_EQ(mkdir((pid_path + "/ns").c_str(), 0755), 0);
+  ASSERT_EQ(mkdir((pid_path + "/net").c_str(), 0755), 0);
+  ASSERT_EQ(symlink("net:[4026532000]", (pid_path + "/ns/net").c_str()), 0);
+  std::ofstream(pid_path + "/cgroup") << "0::/system.slice/docker-c3bfd81b7da0be97190a74a7d459f4dfa18f57c88765cde2613af112020a1c4b.scope\n";
+  std::ofstream(pid_path + "/stat") << "42 (server) S 1 1 1 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 1 0 1000 0 0\n";
+  std::ofstream(pid_path + "/net/tcp6") << kNetTcpHeader;
+
+  std::string net_tcp = kNetTcpHeader;
+  net_tcp += NetTcpLine(0, "0100000A:0050", "0200000A:C350", "01", 100);
+  std::ofstream(pid_path + "/net/tcp") << net_tcp;
+  ASSERT_EQ(symlink("/dev/null", (pid_path + "/fd/0").c_str()), 0);
+  ASSERT_EQ(symlink("socket:[100]", (pid_path + "/fd/1").c_str()), 0);
+  ASSERT_EQ(symlink("/dev/null", (pid_path + "/fd/2").c_str()), 0);
+
+  ConnScraper scraper(proc_path);
+  for (int i = 0; i < 2; i++) {
+    std::vector<Connection> connections;
+    std::vector<ContainerEndpoint> listen_endpoints;
+    ASSERT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+    EXPECT_EQ(connections.size(), 1);
+  }
+
+  // fd 2 is reused for a socket. It is still known not to refer to a socket, but the socket is not owned by any process
+  // in the network namespace, hence the fds of all processes in the namespace are verified in the next scrape.
+  net_tcp += NetTcpLine(1, "0100000A:C351", "0300000A:01BB", "01", 101);
+  std::ofstream(pid_path + "/net/tcp") << net_tcp;
+  ASSERT_EQ(unlink((pid_path + "/fd/2").c_str()), 0);
+  ASSERT_EQ(symlink("socket:[101]", (pid_path + "/fd/2").c_str()), 0);
+
+  std::vector<Connection> connections;
+  std::vector<ContainerEndpoint> listen_endpoints;
+  ASSERT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+  EXPECT_EQ(connections.size(), 1);
+
+  connections.clear();
+  ASSERT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+  EXPECT_EQ(connections.size(), 2);
+
+  nftw(proc_path.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// MakeFakeProcess creates the `/proc/<pid>` entry of a process in the network namespace with the given inode, running
+// in the container with the given ID, or on the host if it is empty. The process has num_fds open files, none of which
+// is a socket, and its network namespace has no connections.
+void MakeFakeProcess(const std::string& proc_path, uint64_t pid, const std::string& container_id, uint64_t netns_inode,
+                     int num_fds) {
+  std::string pid_path = proc_path + "/" + std::to_string(pid);
+  ASSERT_EQ(mkdir(pid_path.c_str(), 0755), 0);
+  ASSERT_EQ(mkdir((pid_path + "/fd").c_str(), 0755), 0);
+  ASSERT_EQ(mkdir((pid_path + "/ns").c_str(), 0755), 0);
+  ASSERT_EQ(mkdir((pid_path + "/net").c_str(), 0755), 0);
+  std::string netns = "net:[" + std::to_string(netns_inode) + "]";
+  ASSERT_EQ(symlink(netns.c_str(), (pid_path + "/ns/net").c_str()), 0);
+  if (container_id.empty()) {
+    std::ofstream(pid_path + "/cgroup") << "0::/init.scope\n";
+  } else {
+    std::ofstream(pid_path + "/cgroup") << "0::/system.slice/docker-" << container_id << ".scope\n";
+  }
+  std::ofstream(pid_path + "/stat") << pid << " (server) S 1 1 1 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 1 0 1000 0 0\n";
+  std::ofstream(pid_path + "/net/tcp") << kNetTcpHeader;
+  std::ofstream(pid_path + "/net/tcp6") << kNetTcpHeader;
+  for (int fd = 0; fd < num_fds; fd++) {
+    ASSERT_EQ(symlink("/dev/null", (pid_path + "/fd/" + std::to_string(fd)).c_str()), 0);
+  }
+}
+
+TEST(ConnScraperTest, TestNonSocketFDReuseHostNetwork) {
+  char dir_template[] = "/tmp/collector-proc-XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  std::string proc_path = dir_template;
+
+  // A hostNetwork pod, sharing the network namespace with a host process.
+  const std::string container_id = "c3bfd81b7da0be97190a74a7d459f4dfa18f57c88765cde2613af112020a1c4b";
+  MakeFakeProcess(proc_path, 1, "", 4026531992, 3);
+  MakeFakeProcess(proc_path, 60, container_id, 4026531992, 3);
+
+  ConnScraper scraper(proc_path);
+  std::vector<Connection> connections;
+  std::vector<ContainerEndpoint> listen_endpoints;
+  for (int i = 0; i < 2; i++) {
+    ASSERT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+    EXPECT_TRUE(connections.empty());
+  }
+
+  // fd 2 of the container process is reused for a socket. The host network namespace always contains sockets not owned
+  // by any container process, hence the fds of container processes in it are verified in every scrape.
+  std::string net_tcp = kNetTcpHeader;
+  net_tcp += NetTcpLine(0, "0100000A:C351", "0300000A:01BB", "01", 101);
+  std::ofstream(proc_path + "/1/net/tcp") << net_tcp;
+  std::ofstream(proc_path + "/60/net/tcp") << net_tcp;
+  ASSERT_EQ(unlink((proc_path + "/60/fd/2").c_str()), 0);
+  ASSERT_EQ(symlink("socket:[101]", (proc_path + "/60/fd/2").c_str()), 0);
+
+  ASSERT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+  ASSERT_EQ(connections.size(), 1);
+  EXPECT_EQ(connections[0].container(), container_id.substr(0, 12));
+
+  nftw(proc_path.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+TEST(ConnScraperTest, TestInferSocketOwners) {
+  char dir_template[] = "/tmp/collector-proc-XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  std::string proc_path = dir_template;
+
+  const std::string container_a = "c3bfd81b7da0be97190a74a7d459f4dfa18f57c88765cde2613af112020a1c4b";
+  const std::string container_b = "0be97190a74a7d459f4dfa18f57c88765cde2613af112020a1c4bc3bfd81b7da";
+  const std::string container_c = "a74a7d459f4dfa18f57c88765cde2613af112020a1c4bc3bfd81b7da0be97190";
+  const std::string container_d = "f57c88765cde2613af112020a1c4bc3bfd81b7da0be97190a74a7d459f4dfa18";
+
+  // A pod with two containers with many open files. The process with the most of them is assumed to own the sockets.
+  MakeFakeProcess(proc_path, 42, container_a, 4026532001, kMinFDsForSocketInference + 10);
+  MakeFakeProcess(proc_path, 43, container_b, 4026532001, kMinFDsForSocketInference);
+  // A process with too few open files for inference.
+  MakeFakeProcess(proc_path, 50, container_c, 4026532002, 10);
+  // A hostNetwork pod, sharing the network namespace with host processes.
+  MakeFakeProcess(proc_path, 1, "", 4026531992, 10);
+  MakeFakeProcess(proc_path, 60, container_d, 4026531992, kMinFDsForSocketInference + 10);
+
+  ConnScraper scraper(proc_path);
+  scraper.SetInferSocketOwners(true);
+  std::vector<Connection> connections;
+  std::vector<ContainerEndpoint> listen_endpoints;
+  ASSERT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+  EXPECT_TRUE(connections.empty());
+
+  // New connections show up in every network namespace, but their sockets are not found in any fd directory walked.
+  auto add_connection = [&](uint64_t pid, int inode) {
+    std::string net_tcp = kNetTcpHeader;
+    net_tcp += NetTcpLine(0, "0100000A:C350", "0200000A:0050", "01", inode);
+    std::ofstream(proc_path + "/" + std::to_string(pid) + "/net/tcp") << net_tcp;
+  };
+  add_connection(42, 101);
+  add_connection(43, 101);
+  add_connection(50, 201);
+  add_connection(1, 301);
+  add_connection(60, 301);
+
+  connections.clear();
+  ASSERT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+  ASSERT_EQ(connections.size(), 1);
+  EXPECT_EQ(connections[0].container(), container_a.substr(0, 12));
+
+  nftw(proc_path.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+TEST(ConnScraperTest, TestPidCacheValidation) {
+  char dir_template[] = "/tmp/collector-proc-XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  std::string proc_path = dir_template;
+  std::string pid_path = proc_path + "/42";
+
+  const std::string container_a = "c3bfd81b7da0be97190a74a7d459f4dfa18f57c88765cde2613af112020a1c4b";
+  const std::string container_b = "0be97190a74a7d459f4dfa18f57c88765cde2613af112020a1c4bc3bfd81b7da";
+  MakeFakeProcess(proc_path, 42, container_a, 4026532001, 2);
+  ASSERT_EQ(symlink("socket:[100]", (pid_path + "/fd/2").c_str()), 0);
+  std::ofstream(pid_path + "/net/tcp") << kNetTcpHeader << NetTcpLine(0, "0100000A:0050", "0200000A:C350", "01", 100);
+
+  ConnScraper scraper(proc_path);
+  auto& stats = CollectorStats::GetOrCreate();
+  auto scrape = [&]() {
+    CollectorStats::Reset();
+    std::vector<Connection> connections;
+    std::vector<ContainerEndpoint> listen_endpoints;
+    EXPECT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+    EXPECT_EQ(connections.size(), 1);
+    return connections.empty() ? std::string() : connections[0].container();
+  };
+
+  EXPECT_EQ(scrape(), container_a.substr(0, 12));
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_scrape_pid_cache_misses), 1);
+  EXPECT_EQ(scrape(), container_a.substr(0, 12));
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_scrape_pid_cache_hits), 1);
+
+  // The pid is reused by a process in another container.
+  std::ofstream(pid_path + "/stat") << "42 (server) S 1 1 1 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 1 0 2000 0 0\n";
+  std::ofstream(pid_path + "/cgroup") << "0::/system.slice/docker-" << container_b << ".scope\n";
+  EXPECT_EQ(scrape(), container_b.substr(0, 12));
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_scrape_pid_cache_misses), 1);
+
+  // A new process is moved to a different cgroup, e.g., by the container runtime.
+  std::ofstream(pid_path + "/cgroup") << "0::/system.slice/docker-" << container_a << ".scope\n";
+  EXPECT_EQ(scrape(), container_a.substr(0, 12));
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_scrape_pid_cache_misses), 1);
+
+  // The process changes its network namespace.
+  ASSERT_EQ(unlink((pid_path + "/ns/net").c_str()), 0);
+  ASSERT_EQ(symlink("net:[4026532002]", (pid_path + "/ns/net").c_str()), 0);
+  EXPECT_EQ(scrape(), container_a.substr(0, 12));
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_scrape_pid_cache_misses), 1);
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_scrape_pid_cache_hits), 0);
+
+  // Entries of processes which are gone are removed.
+  MakeFakeProcess(proc_path, 43, container_b, 4026532003, 2);
+  scrape();
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_scrape_pid_cache_size), 2);
+  nftw((proc_path + "/43").c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+  scrape();
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_scrape_pid_cache_size), 1);
+  EXPECT_EQ(stats.GetCounter(CollectorStats::net_scrape_pid_cache_hits), 1);
+
+  nftw(proc_path.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+TEST(ConnScraperTest, TestContainerIDCacheLongLivedProcess) {
+  char dir_template[] = "/tmp/collector-proc-XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  std::string proc_path = dir_template;
+
+  const std::string container_id = "c3bfd81b7da0be97190a74a7d459f4dfa18f57c88765cde2613af112020a1c4b";
+  MakeFakeProcess(proc_path, 42, container_id, 4026532001, 3);
+
+  auto container_id_cache = std::make_shared<ContainerIDCache>();
+  ConnScraper scraper(proc_path);
+  scraper.SetContainerIDCache(container_id_cache);
+  std::vector<Connection> connections;
+  std::vector<ContainerEndpoint> listen_endpoints;
+  // After the first scrape, the container ID of the process is taken from the pid cache.
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+  }
+  EXPECT_EQ(container_id_cache->size(), 1);
+
+  // A new process in the same cgroup is resolved through the container ID cache.
+  MakeFakeProcess(proc_path, 43, container_id, 4026532001, 3);
+  CollectorStats::Reset();
+  ASSERT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+  auto& stats = CollectorStats::GetOrCreate();
+  EXPECT_EQ(stats.GetCounter(CollectorStats::container_id_cache_hits), 1);
+  EXPECT_EQ(stats.GetCounter(CollectorStats::container_id_cache_misses), 0);
+
+  nftw(proc_path.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+TEST(ConnScraperTest, TestMultipleWorkers) {
+  FakeProcSpec spec;
+  spec.num_pids = 200;
+  spec.num_host_pids = 20;
+  spec.num_containers = 10;
+  spec.num_namespaces = 20;
+  auto dir = FakeProcDir::Create(spec);
+  ASSERT_NE(dir, nullptr);
+
+  auto scrape = [&](int num_workers, UnorderedSet<Connection>* connection_set,
+                    UnorderedSet<ContainerEndpoint>* endpoint_set) {
+    ConnScraper scraper(dir->path(), nullptr, num_workers);
+    // The second scrape is served from the pid cache.
+    for (int i = 0; i < 2; i++) {
+      CollectorStats::Reset();
+      std::vector<Connection> connections;
+      std::vector<ContainerEndpoint> listen_endpoints;
+      ASSERT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+      EXPECT_EQ(connections.size(), dir->num_connections());
+      EXPECT_EQ(listen_endpoints.size(), dir->num_listen_endpoints());
+      // The connections of each network namespace are read exactly once.
+      EXPECT_EQ(CollectorStats::GetOrCreate().GetCounter(CollectorStats::net_scrape_netns_reads), spec.num_namespaces);
+
+      connection_set->clear();
+      connection_set->insert(connections.begin(), connections.end());
+      EXPECT_EQ(connection_set->size(), connections.size());
+      endpoint_set->clear();
+      endpoint_set->insert(listen_endpoints.begin(), listen_endpoints.end());
+      EXPECT_EQ(endpoint_set->size(), listen_endpoints.size());
+    }
+  };
+
+  UnorderedSet<Connection> expected_connections;
+  UnorderedSet<ContainerEndpoint> expected_endpoints;
+  scrape(1, &expected_connections, &expected_endpoints);
+
+  for (int num_workers : {2, 4, 7}) {
+    UnorderedSet<Connection> connections;
+    UnorderedSet<ContainerEndpoint> endpoints;
+    scrape(num_workers, &connections, &endpoints);
+    EXPECT_TRUE(connections == expected_connections) << "num_workers = " << num_workers;
+    EXPECT_TRUE(endpoints == expected_endpoints) << "num_workers = " << num_workers;
+  }
+}
+
+TEST(ConnScraperTest, TestScrapeSlices) {
+  FakeProcSpec spec;
+  spec.num_pids = 200;
+  spec.num_host_pids = 20;
+  spec.num_containers = 10;
+  spec.num_namespaces = 20;
+  auto dir = FakeProcDir::Create(spec);
+  ASSERT_NE(dir, nullptr);
+
+  std::vector<Connection> connections;
+  std::vector<ContainerEndpoint> listen_endpoints;
+  ConnScraper scraper(dir->path(), nullptr, 2);
+  ASSERT_TRUE(scraper.Scrape(&connections, &listen_endpoints));
+  UnorderedSet<Connection> expected_connections(connections.begin(), connections.end());
+  UnorderedSet<ContainerEndpoint> expected_endpoints(listen_endpoints.begin(), listen_endpoints.end());
+  ASSERT_EQ(expected_connections.size(), dir->num_connections());
+  ASSERT_EQ(expected_endpoints.size(), dir->num_listen_endpoints());
+
+  for (int num_slices : {1, 3, 8}) {
+    // The second cycle is served from the pid cache.
+    ConnScraper sliced_scraper(dir->path(), nullptr, 2);
+    for (int i = 0; i < 2; i++) {
+      CollectorStats::Reset();
+      connections.clear();
+      listen_endpoints.clear();
+      for (int slice = 0; slice < num_slices; slice++) {
+        ASSERT_TRUE(sliced_scraper.ScrapeSlice(slice, num_slices, &connections, &listen_endpoints));
+      }
+      EXPECT_EQ(connections.size(), expected_connections.size()) << "num_slices = " << num_slices;
+      EXPECT_EQ(listen_endpoints.size(), expected_endpoints.size()) << "num_slices = " << num_slices;
+      EXPECT_TRUE(UnorderedSet<Connection>(connections.begin(), connections.end()) == expected_connections);
+      EXPECT_TRUE(UnorderedSet<ContainerEndpoint>(listen_endpoints.begin(), listen_endpoints.end()) == expected_endpoints);
+      // The connections of each network namespace are read once per cycle.
+      EXPECT_EQ(CollectorStats::GetOrCreate().GetCounter(CollectorStats::net_scrape_netns_reads), spec.num_namespaces);
+    }
+  }
+}
+
 }  // namespace
 
 }  // namespace collector
@@ -0,0 +1,114 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include <cstring>
+#include <string>
+
+#include "HexDecode.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+using DecodeFunc = bool (*)(const char*, int, bool, uint8_t*);
+
+std::vector<std::pair<std::string, DecodeFunc>> Implementations() {
+  std::vector<std::pair<std::string, DecodeFunc>> impls = {
+      {"dispatch", DecodeHexWords},
+      {"scalar", internal::DecodeHexWordsScalar},
+  };
+#ifdef __x86_64__
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("ssse3")) impls.emplace_back("ssse3", internal::DecodeHexWordsSSSE3);
+  if (__builtin_cpu_supports("avx2")) impls.emplace_back("avx2", internal::DecodeHexWordsAVX2);
+#endif
+  return impls;
+}
+
+TEST(HexDecodeTest, TestDecodeIPv4) {
+  for (const auto& impl : Implementations()) {
+    uint8_t out[4];
+    ASSERT_TRUE(impl.second("0100000A", 1, false, out)) << impl.first;
+    EXPECT_THAT(out, ::testing::ElementsAre(0x01, 0x00, 0x00, 0x0a)) << impl.first;
+
+    ASSERT_TRUE(impl.second("C0A8FE09", 1, true, out)) << impl.first;
+    EXPECT_THAT(out, ::testing::ElementsAre(0x09, 0xfe, 0xa8, 0xc0)) << impl.first;
+  }
+}
+
+TEST(HexDecodeTest, TestDecodeIPv6) {
+  const char hex[] = "0123456789ABCDEFFEDCBA9876543210";
+  for (const auto& impl : Implementations()) {
+    uint8_t out[16];
+    ASSERT_TRUE(impl.second(hex, 4, false, out)) << impl.first;
+    EXPECT_THAT(out, ::testing::ElementsAre(0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+                                            0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10))
+        << impl.first;
+
+    ASSERT_TRUE(impl.second(hex, 4, true, out)) << impl.first;
+    EXPECT_THAT(out, ::testing::ElementsAre(0x67, 0x45, 0x23, 0x01, 0xef, 0xcd, 0xab, 0x89,
+                                            0x98, 0xba, 0xdc, 0xfe, 0x10, 0x32, 0x54, 0x76))
+        << impl.first;
+  }
+}
+
+TEST(HexDecodeTest, TestRejectInvalid) {
+  const char valid[] = "0123456789ABCDEFFEDCBA9876543210";
+  const char invalid_chars[] = {'a', 'f', 'G', '/', ':', '@', ' ', '\0', '\x80'};
+
+  for (const auto& impl : Implementations()) {
+    for (size_t pos = 0; pos < 32; pos++) {
+      for (char c : invalid_chars) {
+        std::string hex(valid);
+        hex[pos] = c;
+        uint8_t out[16];
+        EXPECT_FALSE(impl.second(hex.data(), 4, false, out)) << impl.first << " pos " << pos << " char " << int(c);
+        if (pos < 8) {
+          EXPECT_FALSE(impl.second(hex.data(), 1, false, out)) << impl.first << " pos " << pos << " char " << int(c);
+        }
+      }
+    }
+  }
+}
+
+TEST(HexDecodeTest, TestAllByteValues) {
+  for (const auto& impl : Implementations()) {
+    for (int i = 0; i < 256; i += 4) {
+      char hex[33];
+      for (int j = 0; j < 16; j++) {
+        snprintf(hex + 2 * j, 3, "%02X", (i + j) & 0xff);
+      }
+      uint8_t out[16];
+      ASSERT_TRUE(impl.second(hex, 4, false, out)) << impl.first;
+      for (int j = 0; j < 16; j++) {
+        EXPECT_EQ(out[j], (i + j) & 0xff) << impl.first;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,172 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include <google/protobuf/util/message_differencer.h>
+#include <google/protobuf/util/time_util.h>
+#include <grpcpp/support/proto_buffer_reader.h>
+
+#include "internalapi/sensor/network_connection_iservice.pb.h"
+
+#include "NetworkConnectionInfoEncoder.h"
+#include "Process.h"
+#include "ProtoUtil.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+using google::protobuf::util::MessageDifferencer;
+using google::protobuf::util::TimeUtil;
+
+sensor::SocketFamily SocketFamily(const Endpoint& endpoint) {
+  switch (endpoint.address().family()) {
+    case Address::Family::IPV4:
+      return sensor::SOCKET_FAMILY_IPV4;
+    case Address::Family::IPV6:
+      return sensor::SOCKET_FAMILY_IPV6;
+    default:
+      return sensor::SOCKET_FAMILY_UNKNOWN;
+  }
+}
+
+storage::L4Protocol Protocol(L4Proto proto) {
+  return proto == L4Proto::TCP ? storage::L4_PROTOCOL_TCP : storage::L4_PROTOCOL_UDP;
+}
+
+// The expected messages are built with the generated code, in the same way as the network status notifier used to.
+void SetAddress(const Endpoint& endpoint, sensor::NetworkAddress* addr_proto) {
+  auto addr_length = endpoint.address().length();
+  if (endpoint.network().IsAddress()) {
+    addr_proto->set_address_data(endpoint.address().data(), addr_length);
+  }
+  if (endpoint.network().bits() > 0) {
+    std::string network(static_cast<const char*>(endpoint.network().address().data()), addr_length);
+    network.push_back(static_cast<char>(endpoint.network().bits()));
+    addr_proto->set_ip_network(network);
+  }
+  addr_proto->set_port(endpoint.port());
+}
+
+void AddExpectedConnection(const Connection& conn, const ConnStatus& status, sensor::NetworkConnectionInfo* info) {
+  auto* conn_proto = info->add_updated_connections();
+  conn_proto->set_container_id(conn.container());
+  conn_proto->set_role(conn.is_server() ? sensor::ROLE_SERVER : sensor::ROLE_CLIENT);
+  conn_proto->set_protocol(Protocol(conn.l4proto()));
+  conn_proto->set_socket_family(SocketFamily(conn.local()));
+  if (!conn.local().IsNull()) SetAddress(conn.local(), conn_proto->mutable_local_address());
+  if (!conn.remote().IsNull()) SetAddress(conn.remote(), conn_proto->mutable_remote_address());
+  if (!status.IsActive()) {
+    *conn_proto->mutable_close_timestamp() = TimeUtil::MicrosecondsToTimestamp(status.LastActiveTime());
+  }
+}
+
+void AddExpectedEndpoint(const ContainerEndpoint& cep, const ConnStatus& status, sensor::NetworkConnectionInfo* info) {
+  auto* endpoint_proto = info->add_updated_endpoints();
+  endpoint_proto->set_container_id(cep.container());
+  endpoint_proto->set_protocol(Protocol(cep.l4proto()));
+  endpoint_proto->set_socket_family(SocketFamily(cep.endpoint()));
+  if (!cep.endpoint().IsNull()) SetAddress(cep.endpoint(), endpoint_proto->mutable_listen_address());
+  if (cep.originator()) {
+    auto* process_proto = endpoint_proto->mutable_originator();
+    process_proto->set_process_name(cep.originator()->comm());
+    process_proto->set_process_exec_file_path(cep.originator()->exe_path());
+    process_proto->set_process_args(cep.originator()->args());
+  }
+  if (!status.IsActive()) {
+    *endpoint_proto->mutable_close_timestamp() = TimeUtil::MicrosecondsToTimestamp(status.LastActiveTime());
+  }
+}
+
+// Parses the serialized message with the generated parser.
+bool Parse(const grpc::ByteBuffer& buffer, sensor::NetworkConnectionInfoMessage* msg) {
+  grpc::ByteBuffer copy(buffer);
+  grpc::ProtoBufferReader reader(&copy);
+  return msg->ParseFromZeroCopyStream(&reader);
+}
+
+TEST(NetworkConnectionInfoEncoderTest, RoundTrip) {
+  std::vector<std::pair<Connection, ConnStatus>> conns = {
+      {Connection("0123456789ab", Endpoint(Address(192, 168, 0, 1), 80), Endpoint(Address(10, 1, 1, 8), 33452), L4Proto::TCP, true),
+       ConnStatus(1234567, true)},
+      {Connection("0123456789ab", Endpoint(IPNet(Address(), 0, true), 0), Endpoint(IPNet(Address(35, 127, 0, 0), 16), 443), L4Proto::TCP, false),
+       ConnStatus(1234567, false)},
+      {Connection("", Endpoint(Address(0xfe80000000000000ULL, 0x1ULL), 5353), Endpoint(Address(0xfe80000000000000ULL, 0x2ULL), 53), L4Proto::UDP, false),
+       ConnStatus(0, false)},
+  };
+  std::vector<std::pair<ContainerEndpoint, ConnStatus>> ceps = {
+      {ContainerEndpoint("0123456789ab", Endpoint(IPNet(Address()), 8080), L4Proto::TCP, nullptr), ConnStatus(7654321, true)},
+      {ContainerEndpoint("ba9876543210", Endpoint(Address(127, 0, 0, 1), 9090), L4Proto::UDP, std::make_shared<Process>(42)),
+       ConnStatus(7654321000, false)},
+  };
+
+  NetworkConnectionInfoEncoder encoder;
+  sensor::NetworkConnectionInfoMessage expected;
+  auto* info = expected.mutable_info();
+
+  // The encoder is reused, such that the second message is encoded into the buffer of the first.
+  for (int i = 0; i < 2; i++) {
+    encoder.Reset();
+    info->Clear();
+
+    size_t entries_size = 0;
+    for (const auto& conn : conns) {
+      entries_size += encoder.AddConnection(conn.first, conn.second);
+      AddExpectedConnection(conn.first, conn.second, info);
+    }
+    for (const auto& cep : ceps) {
+      entries_size += encoder.AddContainerEndpoint(cep.first, cep.second);
+      AddExpectedEndpoint(cep.first, cep.second, info);
+    }
+    *info->mutable_time() = CurrentTimeProto();
+
+    EXPECT_EQ(encoder.num_entries(), conns.size() + ceps.size());
+    EXPECT_EQ(encoder.entries_size(), entries_size);
+
+    grpc::ByteBuffer buffer = encoder.Finish(info->time());
+    EXPECT_EQ(buffer.Length(), expected.ByteSizeLong());
+
+    sensor::NetworkConnectionInfoMessage actual;
+    ASSERT_TRUE(Parse(buffer, &actual));
+    EXPECT_TRUE(MessageDifferencer::Equals(actual, expected)) << actual.DebugString() << "\nvs.\n"
+                                                              << expected.DebugString();
+  }
+}
+
+TEST(NetworkConnectionInfoEncoderTest, EmptyMessage) {
+  NetworkConnectionInfoEncoder encoder;
+  auto time = CurrentTimeProto();
+
+  sensor::NetworkConnectionInfoMessage actual;
+  ASSERT_TRUE(Parse(encoder.Finish(time), &actual));
+
+  ASSERT_TRUE(actual.has_info());
+  EXPECT_EQ(actual.info().updated_connections_size(), 0);
+  EXPECT_EQ(actual.info().updated_endpoints_size(), 0);
+  EXPECT_TRUE(MessageDifferencer::Equals(actual.info().time(), time));
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,140 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include "NetworkStateCheckpoint.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+using ::testing::UnorderedElementsAre;
+
+NetworkState MakeState() {
+  Endpoint a(Address(192, 168, 0, 1), 80);
+  Endpoint b(Address(192, 168, 1, 10), 9999);
+  Endpoint c(IPNet(Address(10, 0, 0, 0), 8), 443);
+  Endpoint d(Address(0xfd00000000000000ULL, 0x1ULL), 8080);
+
+  NetworkState state;
+  state.tracker_conns.emplace(Connection("xyz", a, b, L4Proto::TCP, true), ConnStatus(1000, true));
+  state.tracker_conns.emplace(Connection("xzy", b, c, L4Proto::UDP, false), ConnStatus(2000, false));
+  state.tracker_endpoints.emplace(ContainerEndpoint("xyz", d, L4Proto::TCP, nullptr), ConnStatus(3000, true));
+  state.reported_conns.emplace(Connection("xyz", a, b, L4Proto::TCP, true), ConnStatus(1000, true));
+  state.reported_endpoints.emplace(ContainerEndpoint("abc", a, L4Proto::UDP, nullptr), ConnStatus(500, false));
+  state.time_at_last_scrape = 4000;
+  return state;
+}
+
+void ExpectStateEq(const NetworkState& expected, const NetworkState& actual) {
+  EXPECT_EQ(expected.tracker_conns, actual.tracker_conns);
+  EXPECT_EQ(expected.tracker_endpoints, actual.tracker_endpoints);
+  EXPECT_EQ(expected.reported_conns, actual.reported_conns);
+  EXPECT_EQ(expected.reported_endpoints, actual.reported_endpoints);
+  EXPECT_EQ(expected.time_at_last_scrape, actual.time_at_last_scrape);
+}
+
+TEST(NetworkStateCheckpointTest, TestRoundTrip) {
+  NetworkState state = MakeState();
+  std::string data = NetworkStateCheckpoint::Serialize(state, 10000);
+
+  NetworkState restored;
+  ASSERT_TRUE(NetworkStateCheckpoint::Deserialize(data.data(), data.size(), 10000, 1000000, &restored));
+  ExpectStateEq(state, restored);
+  EXPECT_EQ(10000, restored.created_micros);
+}
+
+TEST(NetworkStateCheckpointTest, TestEmptyRoundTrip) {
+  std::string data = NetworkStateCheckpoint::Serialize(NetworkState(), 10000);
+
+  NetworkState restored = MakeState();
+  ASSERT_TRUE(NetworkStateCheckpoint::Deserialize(data.data(), data.size(), 10000, 1000000, &restored));
+  ExpectStateEq(NetworkState(), restored);
+}
+
+TEST(NetworkStateCheckpointTest, TestRejectStale) {
+  std::string data = NetworkStateCheckpoint::Serialize(MakeState(), 10000);
+
+  NetworkState restored;
+  EXPECT_FALSE(NetworkStateCheckpoint::Deserialize(data.data(), data.size(), 10000 + 1000001, 1000000, &restored));
+  EXPECT_TRUE(restored.tracker_conns.empty());
+}
+
+TEST(NetworkStateCheckpointTest, TestRejectFuture) {
+  std::string data = NetworkStateCheckpoint::Serialize(MakeState(), 10000);
+
+  NetworkState restored;
+  EXPECT_FALSE(NetworkStateCheckpoint::Deserialize(data.data(), data.size(), 9999, 1000000, &restored));
+  EXPECT_TRUE(restored.tracker_conns.empty());
+}
+
+TEST(NetworkStateCheckpointTest, TestRejectCorrupt) {
+  std::string data = NetworkStateCheckpoint::Serialize(MakeState(), 10000);
+  NetworkState restored;
+
+  std::string corrupt = data;
+  corrupt[corrupt.size() - 1] ^= 0x1;
+  EXPECT_FALSE(NetworkStateCheckpoint::Deserialize(corrupt.data(), corrupt.size(), 10000, 1000000, &restored));
+
+  std::string truncated = data.substr(0, data.size() - 1);
+  EXPECT_FALSE(NetworkStateCheckpoint::Deserialize(truncated.data(), truncated.size(), 10000, 1000000, &restored));
+
+  std::string wrong_version = data;
+  wrong_version[4] ^= 0x7f;
+  EXPECT_FALSE(NetworkStateCheckpoint::Deserialize(wrong_version.data(), wrong_version.size(), 10000, 1000000, &restored));
+
+  EXPECT_FALSE(NetworkStateCheckpoint::Deserialize(data.data(), 3, 10000, 1000000, &restored));
+  EXPECT_TRUE(restored.tracker_conns.empty());
+}
+
+TEST(NetworkStateCheckpointTest, TestSaveLoad) {
+  char dir_template[] = "/tmp/collector-checkpoint-XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  std::string path = std::string(dir_template) + "/network-state";
+
+  NetworkStateCheckpoint checkpoint(path, 1000, 1000000);
+  NetworkState restored;
+  EXPECT_FALSE(checkpoint.Load(&restored, 10000));
+
+  NetworkState state = MakeState();
+  ASSERT_TRUE(checkpoint.Save(state, 10000));
+  ASSERT_TRUE(checkpoint.Load(&restored, 20000));
+  ExpectStateEq(state, restored);
+
+  // A stale checkpoint is discarded and removed.
+  NetworkState stale;
+  EXPECT_FALSE(checkpoint.Load(&stale, 10000 + 2000000));
+  EXPECT_NE(access(path.c_str(), F_OK), 0);
+
+  rmdir(dir_template);
+}
+
+}  // namespace
+
+}  // namespace collector
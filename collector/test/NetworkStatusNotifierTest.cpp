@@ -22,16 +22,23 @@ You should have received a copy of the GNU General Public License along with thi
 */
 
 #include <chrono>
+#include <cstdlib>
 #include <mutex>
 #include <string>
+#include <thread>
+
+#include <unistd.h>
 
 #include <google/protobuf/util/time_util.h>
+#include <grpcpp/support/proto_buffer_reader.h>
 
 #include "internalapi/sensor/network_connection_iservice.grpc.pb.h"
 
 #include "CollectorConfig.h"
+#include "CollectorStats.h"
 #include "DuplexGRPC.h"
 #include "NetworkStatusNotifier.h"
+#include "TimeUtil.h"
 #include "Utility.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -42,6 +49,7 @@ namespace {
 
 using grpc_duplex_impl::Result;
 using grpc_duplex_impl::Status;
+using ::testing::ElementsAre;
 using ::testing::Invoke;
 using ::testing::Return;
 using ::testing::ReturnPointee;
@@ -101,10 +109,24 @@ class MockConnScraper : public IConnScraper {
   MOCK_METHOD(bool, Scrape, (std::vector<Connection> * connections, std::vector<ContainerEndpoint>* listen_endpoints), (override));
 };
 
-class MockDuplexClientWriter : public IDuplexClientWriter<sensor::NetworkConnectionInfoMessage> {
+class MockDuplexClientWriter : public IDuplexClientWriter<grpc::ByteBuffer> {
  public:
-  MOCK_METHOD(grpc_duplex_impl::Result, Write, (const sensor::NetworkConnectionInfoMessage& obj, const gpr_timespec& deadline), (override));
-  MOCK_METHOD(grpc_duplex_impl::Result, WriteAsync, (const sensor::NetworkConnectionInfoMessage& obj), (override));
+  // Messages are written in serialized form; they are parsed and passed to the WriteAsync mock for the message type.
+  grpc_duplex_impl::Result WriteAsync(const grpc::ByteBuffer& obj) override {
+    grpc::ByteBuffer buffer(obj);
+    grpc::ProtoBufferReader reader(&buffer);
+    sensor::NetworkConnectionInfoMessage msg;
+    EXPECT_TRUE(msg.ParseFromZeroCopyStream(&reader));
+    return WriteAsync(msg);
+  }
+
+  grpc_duplex_impl::Result WriteAsync(const grpc::ByteBuffer& obj, const grpc::WriteOptions& options) override {
+    return WriteAsync(obj);
+  }
+
+  MOCK_METHOD(grpc_duplex_impl::Result, Write, (const grpc::ByteBuffer& obj, const gpr_timespec& deadline), (override));
+  MOCK_METHOD(grpc_duplex_impl::Result, WriteAsync, (const sensor::NetworkConnectionInfoMessage& obj));
+  MOCK_METHOD(grpc_duplex_impl::Result, WaitUntilWritable, (const gpr_timespec& deadline), (override));
   MOCK_METHOD(grpc_duplex_impl::Result, WaitUntilStarted, (const gpr_timespec& deadline), (override));
   MOCK_METHOD(bool, Sleep, (const gpr_timespec& deadline), (override));
   MOCK_METHOD(grpc_duplex_impl::Result, WritesDoneAsync, (), (override));
@@ -123,7 +145,7 @@ class MockNetworkConnectionInfoServiceComm : public INetworkConnectionInfoServic
   MOCK_METHOD(bool, WaitForConnectionReady, (const std::function<bool()>& check_interrupted), (override));
   MOCK_METHOD(void, TryCancel, (), (override));
   MOCK_METHOD(sensor::NetworkConnectionInfoService::StubInterface*, GetStub, (), (override));
-  MOCK_METHOD(std::unique_ptr<IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>>, PushNetworkConnectionInfoOpenStream, (std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func), (override));
+  MOCK_METHOD(std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>>, PushNetworkConnectionInfoOpenStream, (std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func), (override));
 };
 
 /* gRPC payload objects are not strictly the ones of our internal model.
@@ -220,11 +242,11 @@ TEST(NetworkStatusNotifier, SimpleStartStop) {
      We return an object that will get called when connections and endpoints are reported */
   EXPECT_CALL(*comm, PushNetworkConnectionInfoOpenStream)
       .Times(1)
-      .WillOnce([&sem, &running](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>> {
+      .WillOnce([&sem, &running](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> {
         auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
 
         // the service is sending Sensor a message
-        EXPECT_CALL(*duplex_writer, Write).WillRepeatedly([&sem, &running](const sensor::NetworkConnectionInfoMessage& msg, const gpr_timespec& deadline) -> Result {
+        EXPECT_CALL(*duplex_writer, WriteAsync).WillRepeatedly([&sem, &running](const sensor::NetworkConnectionInfoMessage& msg) -> Result {
           for (auto cnx : msg.info().updated_connections()) {
             std::cout << cnx.container_id() << std::endl;
           }
@@ -233,6 +255,7 @@ TEST(NetworkStatusNotifier, SimpleStartStop) {
         });
         EXPECT_CALL(*duplex_writer, Sleep).WillRepeatedly(ReturnPointee(&running));
         EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, WaitUntilWritable).WillRepeatedly(Return(Result(Status::OK)));
 
         return duplex_writer;
       });
@@ -296,18 +319,18 @@ TEST(NetworkStatusNotifier, UpdateIPnoAfterglow) {
                  &running,
                  &conn2,
                  &conn3,
-                 &network_flows_callback](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<sensor::NetworkConnectionInfoMessage>> {
+                 &network_flows_callback](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> {
         auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
         network_flows_callback = receive_func;
 
         // the service is sending Sensor a message
-        EXPECT_CALL(*duplex_writer, Write)
-            .WillOnce([&conn2, &sem](const sensor::NetworkConnectionInfoMessage& msg, const gpr_timespec& deadline) -> Result {
+        EXPECT_CALL(*duplex_writer, WriteAsync)
+            .WillOnce([&conn2, &sem](const sensor::NetworkConnectionInfoMessage& msg) -> Result {
               // the connection reported by the scrapper is annouced as generic public
               EXPECT_THAT(NetworkConnectionInfoMessageParser(msg).get_updated_connections(), UnorderedElementsAre(std::make_pair(conn2, true)));
               return Result(Status::OK);
             })
-            .WillOnce([&conn2, &conn3, &sem](const sensor::NetworkConnectionInfoMessage& msg, const gpr_timespec& deadline) -> Result {
+            .WillOnce([&conn2, &conn3, &sem](const sensor::NetworkConnectionInfoMessage& msg) -> Result {
               // after the network is declared, the connection switches to the new state
               // conn3 appears and conn2 is destroyed
               EXPECT_THAT(NetworkConnectionInfoMessageParser(msg).get_updated_connections(), UnorderedElementsAre(std::make_pair(conn3, true), std::make_pair(conn2, false)));
@@ -336,6 +359,7 @@ TEST(NetworkStatusNotifier, UpdateIPnoAfterglow) {
             .WillRepeatedly(ReturnPointee(&running));
 
         EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, WaitUntilWritable).WillRepeatedly(Return(Result(Status::OK)));
 
         return duplex_writer;
       });
@@ -361,6 +385,461 @@ TEST(NetworkStatusNotifier, UpdateIPnoAfterglow) {
   net_status_notifier->Stop();
 }
 
+/* Large deltas are split into several messages with a bounded number of entries */
+TEST(NetworkStatusNotifier, SplitsLargeDeltas) {
+  bool running = true;
+  CollectorConfig config_(0);
+  std::shared_ptr<MockConnScraper> conn_scraper = std::make_shared<MockConnScraper>();
+  auto conn_tracker = std::make_shared<ConnectionTracker>();
+  auto comm = std::make_shared<MockNetworkConnectionInfoServiceComm>();
+  Semaphore sem(0);  // to wait for the service to accomplish its job.
+  std::vector<int> message_sizes;
+
+  EXPECT_CALL(*comm, WaitForConnectionReady).WillRepeatedly(Return(true));
+  EXPECT_CALL(*comm, TryCancel).Times(1).WillOnce([&running] { running = false; });
+
+  EXPECT_CALL(*comm, PushNetworkConnectionInfoOpenStream)
+      .Times(1)
+      .WillOnce([&sem, &running, &message_sizes](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> {
+        auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
+
+        EXPECT_CALL(*duplex_writer, WriteAsync).WillRepeatedly([&sem, &message_sizes](const sensor::NetworkConnectionInfoMessage& msg) -> Result {
+          message_sizes.push_back(msg.info().updated_connections_size());
+          if (message_sizes.size() == 3) {
+            sem.release();
+          }
+          return Result(Status::OK);
+        });
+        EXPECT_CALL(*duplex_writer, Sleep).WillRepeatedly(ReturnPointee(&running));
+        EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, WaitUntilWritable).WillRepeatedly(Return(Result(Status::OK)));
+
+        return duplex_writer;
+      });
+
+  EXPECT_CALL(*conn_scraper, Scrape).WillRepeatedly([](std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) -> bool {
+    for (int i = 0; i < 5; i++) {
+      connections->emplace_back("containerId", Endpoint(Address(10, 0, 1, 32), 40000 + i), Endpoint(Address(139, 45, 27, 4), 1000 + i), L4Proto::TCP, false);
+    }
+    return true;
+  });
+
+  NetworkStatusNotifierOptions options;
+  options.max_message_entries = 2;
+
+  auto net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper,
+                                                               config_.ScrapeInterval(), config_.ScrapeListenEndpoints(),
+                                                               config_.TurnOffScrape(),
+                                                               conn_tracker,
+                                                               config_.AfterglowPeriod(), config_.EnableAfterglow(),
+                                                               comm, options);
+
+  net_status_notifier->Start();
+
+  EXPECT_TRUE(sem.try_acquire_for(std::chrono::seconds(5)));
+
+  net_status_notifier->Stop();
+
+  EXPECT_THAT(message_sizes, ElementsAre(2, 2, 1));
+}
+
+/* Connection updates from events are flushed before the next scrape once enough of them are pending */
+TEST(NetworkStatusNotifier, EarlyFlush) {
+  bool running = true;
+  MockCollectorConfig config;
+  std::shared_ptr<MockConnScraper> conn_scraper = std::make_shared<MockConnScraper>();
+  auto conn_tracker = std::make_shared<ConnectionTracker>();
+  auto comm = std::make_shared<MockNetworkConnectionInfoServiceComm>();
+  Semaphore sem(0);  // to wait for the service to accomplish its job.
+
+  Connection conn("containerId", Endpoint(Address(10, 0, 1, 32), 1024), Endpoint(Address(139, 45, 27, 4), 999), L4Proto::TCP, true);
+  Connection norm_conn("containerId", Endpoint(Address(), 1024), Endpoint(Address(255, 255, 255, 255), 0), L4Proto::TCP, true);
+
+  config.DisableAfterglow();
+
+  EXPECT_CALL(*comm, WaitForConnectionReady).WillRepeatedly(Return(true));
+  EXPECT_CALL(*comm, TryCancel).Times(1).WillOnce([&running] { running = false; });
+
+  EXPECT_CALL(*comm, PushNetworkConnectionInfoOpenStream)
+      .Times(1)
+      .WillOnce([&](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> {
+        auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
+
+        // the first scrape is empty, hence the first message is the early flush
+        EXPECT_CALL(*duplex_writer, WriteAsync)
+            .WillOnce([&](const sensor::NetworkConnectionInfoMessage& msg) -> Result {
+              EXPECT_THAT(NetworkConnectionInfoMessageParser(msg).get_updated_connections(), UnorderedElementsAre(std::make_pair(norm_conn, true)));
+              sem.release();
+              return Result(Status::OK);
+            })
+            .WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, Sleep)
+            .WillOnce(ReturnPointee(&running))  // before the first scrape
+            .WillOnce([&](const gpr_timespec& deadline) {
+              // a connection is observed from an event after the first scrape
+              conn_tracker->AddConnection(conn, NowMicros());
+              return running;
+            })
+            .WillRepeatedly(ReturnPointee(&running));
+        EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, WaitUntilWritable).WillRepeatedly(Return(Result(Status::OK)));
+
+        return duplex_writer;
+      });
+
+  EXPECT_CALL(*conn_scraper, Scrape).WillRepeatedly(Return(true));
+
+  NetworkStatusNotifierOptions options;
+  options.flush_pending_updates = 1;
+
+  auto net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper,
+                                                               config.ScrapeInterval(), config.ScrapeListenEndpoints(),
+                                                               config.TurnOffScrape(),
+                                                               conn_tracker,
+                                                               config.AfterglowPeriod(), config.EnableAfterglow(),
+                                                               comm, options);
+
+  net_status_notifier->Start();
+
+  // The scrape interval is much longer than this.
+  EXPECT_TRUE(sem.try_acquire_for(std::chrono::seconds(5)));
+
+  net_status_notifier->Stop();
+}
+
+/* After the stream fails, the state reported so far is retained, and the next stream only sends what changed since,
+   along with the updates that could not be sent on the failed stream.
+   - the first stream reports conn_a, and then fails to report conn_c
+   - the second stream reports conn_b and conn_c, but not conn_a again */
+TEST(NetworkStatusNotifier, ResyncAfterReconnect) {
+  bool running = true;
+  MockCollectorConfig config;
+  std::shared_ptr<MockConnScraper> conn_scraper = std::make_shared<MockConnScraper>();
+  auto conn_tracker = std::make_shared<ConnectionTracker>();
+  auto comm = std::make_shared<MockNetworkConnectionInfoServiceComm>();
+  Semaphore sem(0);  // to wait for the service to accomplish its job.
+  int num_scrapes = 0;
+
+  Connection conn_a("containerId", Endpoint(Address(10, 0, 1, 32), 1024), Endpoint(Address(139, 45, 27, 4), 999), L4Proto::TCP, true);
+  Connection conn_b("containerId", Endpoint(Address(10, 0, 1, 32), 1025), Endpoint(Address(139, 45, 27, 4), 999), L4Proto::TCP, true);
+  Connection conn_c("containerId", Endpoint(Address(10, 0, 1, 32), 1026), Endpoint(Address(139, 45, 27, 4), 999), L4Proto::TCP, true);
+  // the same server connections normalized
+  Connection norm_a("containerId", Endpoint(Address(), 1024), Endpoint(Address(255, 255, 255, 255), 0), L4Proto::TCP, true);
+  Connection norm_b("containerId", Endpoint(Address(), 1025), Endpoint(Address(255, 255, 255, 255), 0), L4Proto::TCP, true);
+  Connection norm_c("containerId", Endpoint(Address(), 1026), Endpoint(Address(255, 255, 255, 255), 0), L4Proto::TCP, true);
+
+  config.DisableAfterglow();
+
+  EXPECT_CALL(*comm, WaitForConnectionReady).WillRepeatedly(Return(true));
+  EXPECT_CALL(*comm, TryCancel).Times(1).WillOnce([&running] { running = false; });
+
+  EXPECT_CALL(*comm, PushNetworkConnectionInfoOpenStream)
+      .Times(2)
+      .WillOnce([&norm_a](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> {
+        auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
+
+        EXPECT_CALL(*duplex_writer, WriteAsync)
+            .WillOnce([&norm_a](const sensor::NetworkConnectionInfoMessage& msg) -> Result {
+              EXPECT_THAT(NetworkConnectionInfoMessageParser(msg).get_updated_connections(), UnorderedElementsAre(std::make_pair(norm_a, true)));
+              return Result(Status::OK);
+            })
+            .WillOnce(Return(Result(Status::SHUTDOWN)));  // the stream fails
+        EXPECT_CALL(*duplex_writer, Sleep).WillRepeatedly(Return(true));
+        EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, WaitUntilWritable).WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, Finish(::testing::An<const gpr_timespec&>())).WillOnce(Return(grpc::Status(grpc::StatusCode::UNAVAILABLE, "unavailable")));
+
+        return duplex_writer;
+      })
+      .WillOnce([&sem, &running, &norm_b, &norm_c](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> {
+        auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
+
+        EXPECT_CALL(*duplex_writer, WriteAsync)
+            .WillOnce([&sem, &norm_b, &norm_c](const sensor::NetworkConnectionInfoMessage& msg) -> Result {
+              EXPECT_THAT(NetworkConnectionInfoMessageParser(msg).get_updated_connections(), UnorderedElementsAre(std::make_pair(norm_b, true), std::make_pair(norm_c, true)));
+              sem.release();
+              return Result(Status::OK);
+            })
+            .WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, Sleep).WillRepeatedly(ReturnPointee(&running));
+        EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, WaitUntilWritable).WillRepeatedly(Return(Result(Status::OK)));
+
+        return duplex_writer;
+      });
+
+  EXPECT_CALL(*conn_scraper, Scrape).WillRepeatedly([&](std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) -> bool {
+    num_scrapes++;
+    connections->emplace_back(conn_a);
+    if (num_scrapes >= 2) {
+      connections->emplace_back(conn_c);
+    }
+    if (num_scrapes >= 3) {
+      connections->emplace_back(conn_b);
+    }
+    return true;
+  });
+
+  NetworkStatusNotifierOptions options;
+  options.resync_buffer_entries = 100;
+  options.reconnect_delay = std::chrono::milliseconds(10);
+
+  auto net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper,
+                                                               config.ScrapeInterval(), config.ScrapeListenEndpoints(),
+                                                               config.TurnOffScrape(),
+                                                               conn_tracker,
+                                                               config.AfterglowPeriod(), config.EnableAfterglow(),
+                                                               comm, options);
+
+  net_status_notifier->Start();
+
+  EXPECT_TRUE(sem.try_acquire_for(std::chrono::seconds(5)));
+
+  net_status_notifier->Stop();
+}
+
+/* When a previous message can not be sent in time, the stream is torn down, and the updates which may not have been
+   sent are reported on the next stream.
+   - the first stream reports conn_a, which is then stuck in flight
+   - waiting to report conn_c times out, which is counted as a write stall
+   - the second stream reports conn_a and conn_c */
+TEST(NetworkStatusNotifier, WriteStallTearsDownStream) {
+  bool running = true;
+  MockCollectorConfig config;
+  std::shared_ptr<MockConnScraper> conn_scraper = std::make_shared<MockConnScraper>();
+  auto conn_tracker = std::make_shared<ConnectionTracker>();
+  auto comm = std::make_shared<MockNetworkConnectionInfoServiceComm>();
+  Semaphore sem(0);  // to wait for the service to accomplish its job.
+  int num_scrapes = 0;
+
+  Connection conn_a("containerId", Endpoint(Address(10, 0, 1, 32), 1024), Endpoint(Address(139, 45, 27, 4), 999), L4Proto::TCP, true);
+  Connection conn_c("containerId", Endpoint(Address(10, 0, 1, 32), 1026), Endpoint(Address(139, 45, 27, 4), 999), L4Proto::TCP, true);
+  // the same server connections normalized
+  Connection norm_a("containerId", Endpoint(Address(), 1024), Endpoint(Address(255, 255, 255, 255), 0), L4Proto::TCP, true);
+  Connection norm_c("containerId", Endpoint(Address(), 1026), Endpoint(Address(255, 255, 255, 255), 0), L4Proto::TCP, true);
+
+  config.DisableAfterglow();
+  CollectorStats::Reset();
+
+  EXPECT_CALL(*comm, WaitForConnectionReady).WillRepeatedly(Return(true));
+  EXPECT_CALL(*comm, TryCancel).Times(1).WillOnce([&running] { running = false; });
+
+  EXPECT_CALL(*comm, PushNetworkConnectionInfoOpenStream)
+      .Times(2)
+      .WillOnce([&norm_a](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> {
+        auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
+
+        EXPECT_CALL(*duplex_writer, WriteAsync)
+            .WillOnce([&norm_a](const sensor::NetworkConnectionInfoMessage& msg) -> Result {
+              EXPECT_THAT(NetworkConnectionInfoMessageParser(msg).get_updated_connections(), UnorderedElementsAre(std::make_pair(norm_a, true)));
+              return Result(Status::OK);
+            });
+        EXPECT_CALL(*duplex_writer, Sleep).WillRepeatedly(Return(true));
+        EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+        // the first message is written right away, while the stream is stuck afterwards
+        EXPECT_CALL(*duplex_writer, WaitUntilWritable)
+            .WillOnce(Return(Result(Status::OK)))
+            .WillOnce(Return(Result(Status::OK)))
+            .WillRepeatedly([](const gpr_timespec& deadline) -> Result {
+              std::this_thread::sleep_for(std::chrono::milliseconds(5));
+              return Result(Status::TIMEOUT);
+            });
+        EXPECT_CALL(*duplex_writer, Finish(::testing::An<const gpr_timespec&>())).WillOnce(Return(grpc::Status(grpc::StatusCode::DEADLINE_EXCEEDED, "deadline exceeded")));
+
+        return duplex_writer;
+      })
+      .WillOnce([&sem, &running, &norm_a, &norm_c](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> {
+        auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
+
+        EXPECT_CALL(*duplex_writer, WriteAsync)
+            .WillOnce([&sem, &norm_a, &norm_c](const sensor::NetworkConnectionInfoMessage& msg) -> Result {
+              EXPECT_THAT(NetworkConnectionInfoMessageParser(msg).get_updated_connections(), UnorderedElementsAre(std::make_pair(norm_a, true), std::make_pair(norm_c, true)));
+              sem.release();
+              return Result(Status::OK);
+            })
+            .WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, Sleep).WillRepeatedly(ReturnPointee(&running));
+        EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, WaitUntilWritable).WillRepeatedly(Return(Result(Status::OK)));
+
+        return duplex_writer;
+      });
+
+  EXPECT_CALL(*conn_scraper, Scrape).WillRepeatedly([&](std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) -> bool {
+    num_scrapes++;
+    connections->emplace_back(conn_a);
+    if (num_scrapes >= 2) {
+      connections->emplace_back(conn_c);
+    }
+    return true;
+  });
+
+  NetworkStatusNotifierOptions options;
+  options.resync_buffer_entries = 100;
+  options.reconnect_delay = std::chrono::milliseconds(10);
+
+  auto net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper,
+                                                               config.ScrapeInterval(), config.ScrapeListenEndpoints(),
+                                                               config.TurnOffScrape(),
+                                                               conn_tracker,
+                                                               config.AfterglowPeriod(), config.EnableAfterglow(),
+                                                               comm, options);
+
+  net_status_notifier->Start();
+
+  EXPECT_TRUE(sem.try_acquire_for(std::chrono::seconds(5)));
+
+  net_status_notifier->Stop();
+
+  EXPECT_GE(CollectorStats::GetOrCreate().GetCounter(CollectorStats::net_write_stalls), 1);
+}
+
+// WriteCheckpoint writes a checkpoint of a previous collector instance, which had reported the given connection (and
+// its normalized form) as active, to a new temporary file.
+std::shared_ptr<NetworkStateCheckpoint> WriteCheckpoint(const Connection& conn, const Connection& normalized_conn) {
+  char path[] = "/tmp/collector-checkpoint-XXXXXX";
+  int fd = mkstemp(path);
+  EXPECT_GE(fd, 0);
+  close(fd);
+
+  int64_t now = NowMicros();
+  NetworkState state;
+  state.tracker_conns.emplace(conn, ConnStatus(now - 1000000, true));
+  state.reported_conns.emplace(normalized_conn, ConnStatus(now - 1000000, true));
+  state.time_at_last_scrape = now - 1000000;
+
+  auto checkpoint = std::make_shared<NetworkStateCheckpoint>(path, 3600 * 1000000LL, 3600 * 1000000LL);
+  EXPECT_TRUE(checkpoint->Save(state, now));
+  return checkpoint;
+}
+
+/* The state restored from a checkpoint suppresses reporting connections again which were already reported by the
+   previous collector instance.
+   - the checkpoint contains conn_a as reported
+   - the first scrape finds conn_a and conn_b, and only conn_b is reported */
+TEST(NetworkStatusNotifier, RestoredStateSuppressesReports) {
+  bool running = true;
+  MockCollectorConfig config;
+  std::shared_ptr<MockConnScraper> conn_scraper = std::make_shared<MockConnScraper>();
+  auto conn_tracker = std::make_shared<ConnectionTracker>();
+  auto comm = std::make_shared<MockNetworkConnectionInfoServiceComm>();
+  Semaphore sem(0);  // to wait for the service to accomplish its job.
+
+  Connection conn_a("containerId", Endpoint(Address(10, 0, 1, 32), 1024), Endpoint(Address(139, 45, 27, 4), 999), L4Proto::TCP, true);
+  Connection conn_b("containerId", Endpoint(Address(10, 0, 1, 32), 1025), Endpoint(Address(139, 45, 27, 4), 999), L4Proto::TCP, true);
+  // the same server connections normalized
+  Connection norm_a("containerId", Endpoint(Address(), 1024), Endpoint(Address(255, 255, 255, 255), 0), L4Proto::TCP, true);
+  // the normalized connection as reported by the tracker
+  Connection reported_a("containerId", Endpoint(Address(), 1024), Endpoint(IPNet(Address(255, 255, 255, 255), 0, true), 0), L4Proto::TCP, true);
+  Connection norm_b("containerId", Endpoint(Address(), 1025), Endpoint(Address(255, 255, 255, 255), 0), L4Proto::TCP, true);
+
+  config.DisableAfterglow();
+
+  EXPECT_CALL(*comm, WaitForConnectionReady).WillRepeatedly(Return(true));
+  EXPECT_CALL(*comm, TryCancel).Times(1).WillOnce([&running] { running = false; });
+
+  EXPECT_CALL(*comm, PushNetworkConnectionInfoOpenStream)
+      .Times(1)
+      .WillOnce([&sem, &running, &norm_b](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> {
+        auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
+
+        EXPECT_CALL(*duplex_writer, WriteAsync)
+            .WillOnce([&sem, &norm_b](const sensor::NetworkConnectionInfoMessage& msg) -> Result {
+              EXPECT_THAT(NetworkConnectionInfoMessageParser(msg).get_updated_connections(), UnorderedElementsAre(std::make_pair(norm_b, true)));
+              sem.release();
+              return Result(Status::OK);
+            })
+            .WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, Sleep).WillRepeatedly(ReturnPointee(&running));
+        EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, WaitUntilWritable).WillRepeatedly(Return(Result(Status::OK)));
+
+        return duplex_writer;
+      });
+
+  EXPECT_CALL(*conn_scraper, Scrape).WillRepeatedly([&](std::vector<Connection>* connections, std::vector<ContainerEndpoint>* listen_endpoints) -> bool {
+    connections->emplace_back(conn_a);
+    connections->emplace_back(conn_b);
+    return true;
+  });
+
+  NetworkStatusNotifierOptions options;
+  options.checkpoint = WriteCheckpoint(conn_a, reported_a);
+
+  auto net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper,
+                                                               config.ScrapeInterval(), config.ScrapeListenEndpoints(),
+                                                               config.TurnOffScrape(),
+                                                               conn_tracker,
+                                                               config.AfterglowPeriod(), config.EnableAfterglow(),
+                                                               comm, options);
+
+  net_status_notifier->Start();
+
+  EXPECT_TRUE(sem.try_acquire_for(std::chrono::seconds(5)));
+
+  net_status_notifier->Stop();
+  unlink(options.checkpoint->path().c_str());
+}
+
+/* Without scrapes, connections restored from a checkpoint are closed as of the checkpoint, as their close events may
+   have been missed while collector was not running. */
+TEST(NetworkStatusNotifier, RestoredStateClosedWithoutScrapes) {
+  bool running = true;
+  MockCollectorConfig config;
+  std::shared_ptr<MockConnScraper> conn_scraper = std::make_shared<MockConnScraper>();
+  auto conn_tracker = std::make_shared<ConnectionTracker>();
+  auto comm = std::make_shared<MockNetworkConnectionInfoServiceComm>();
+  Semaphore sem(0);  // to wait for the service to accomplish its job.
+
+  Connection conn_a("containerId", Endpoint(Address(10, 0, 1, 32), 1024), Endpoint(Address(139, 45, 27, 4), 999), L4Proto::TCP, true);
+  Connection norm_a("containerId", Endpoint(Address(), 1024), Endpoint(Address(255, 255, 255, 255), 0), L4Proto::TCP, true);
+  // the normalized connection as reported by the tracker
+  Connection reported_a("containerId", Endpoint(Address(), 1024), Endpoint(IPNet(Address(255, 255, 255, 255), 0, true), 0), L4Proto::TCP, true);
+
+  config.DisableAfterglow();
+
+  EXPECT_CALL(*comm, WaitForConnectionReady).WillRepeatedly(Return(true));
+  EXPECT_CALL(*comm, TryCancel).Times(1).WillOnce([&running] { running = false; });
+
+  EXPECT_CALL(*comm, PushNetworkConnectionInfoOpenStream)
+      .Times(1)
+      .WillOnce([&sem, &running, &norm_a](std::function<void(const sensor::NetworkFlowsControlMessage*)> receive_func) -> std::unique_ptr<IDuplexClientWriter<grpc::ByteBuffer>> {
+        auto duplex_writer = MakeUnique<MockDuplexClientWriter>();
+
+        EXPECT_CALL(*duplex_writer, WriteAsync)
+            .WillOnce([&sem, &norm_a](const sensor::NetworkConnectionInfoMessage& msg) -> Result {
+              EXPECT_THAT(NetworkConnectionInfoMessageParser(msg).get_updated_connections(), UnorderedElementsAre(std::make_pair(norm_a, false)));
+              sem.release();
+              return Result(Status::OK);
+            })
+            .WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, Sleep).WillRepeatedly(ReturnPointee(&running));
+        EXPECT_CALL(*duplex_writer, WaitUntilStarted).WillRepeatedly(Return(Result(Status::OK)));
+        EXPECT_CALL(*duplex_writer, WaitUntilWritable).WillRepeatedly(Return(Result(Status::OK)));
+
+        return duplex_writer;
+      });
+
+  EXPECT_CALL(*conn_scraper, Scrape).Times(0);
+
+  NetworkStatusNotifierOptions options;
+  options.checkpoint = WriteCheckpoint(conn_a, reported_a);
+
+  auto net_status_notifier = MakeUnique<NetworkStatusNotifier>(conn_scraper,
+                                                               config.ScrapeInterval(), config.ScrapeListenEndpoints(),
+                                                               true,
+                                                               conn_tracker,
+                                                               config.AfterglowPeriod(), config.EnableAfterglow(),
+                                                               comm, options);
+
+  net_status_notifier->Start();
+
+  EXPECT_TRUE(sem.try_acquire_for(std::chrono::seconds(5)));
+
+  net_status_notifier->Stop();
+  unlink(options.checkpoint->path().c_str());
+}
+
 }  // namespace
 
 }  // namespace collector
\ No newline at end of file
@@ -0,0 +1,85 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#include "ProcessLineageCache.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+namespace {
+
+ProcessLineageCache::Entry MakeEntry(uint64_t clone_ts, const std::string& path, std::vector<int64_t> ancestors) {
+  ProcessLineageCache::Entry entry;
+  entry.clone_ts = clone_ts;
+  ProcessLineageCache::LineageInfo info;
+  info.set_parent_exec_file_path(path);
+  entry.lineage.push_back(info);
+  entry.ancestors = std::move(ancestors);
+  return entry;
+}
+
+TEST(ProcessLineageCacheTest, FindByTidAndCloneTimestamp) {
+  ProcessLineageCache cache;
+  cache.Insert(10, MakeEntry(100, "/bin/sh", {10, 1}));
+
+  const auto* entry = cache.Find(10, 100);
+  ASSERT_NE(entry, nullptr);
+  ASSERT_EQ(entry->lineage.size(), 1);
+  EXPECT_EQ(entry->lineage[0].parent_exec_file_path(), "/bin/sh");
+
+  // A process that reused the tid
+  EXPECT_EQ(cache.Find(10, 200), nullptr);
+  EXPECT_EQ(cache.Find(11, 100), nullptr);
+}
+
+TEST(ProcessLineageCacheTest, InvalidateDependents) {
+  ProcessLineageCache cache;
+  cache.Insert(1, MakeEntry(1, "/sbin/init", {1}));
+  cache.Insert(10, MakeEntry(10, "/bin/bash", {10, 1}));
+  cache.Insert(20, MakeEntry(20, "/bin/sh", {20, 10, 1}));
+  cache.Insert(30, MakeEntry(30, "/usr/bin/make", {30, 1}));
+
+  cache.Invalidate(10);
+  EXPECT_NE(cache.Find(1, 1), nullptr);
+  EXPECT_EQ(cache.Find(10, 10), nullptr);
+  EXPECT_EQ(cache.Find(20, 20), nullptr);
+  EXPECT_NE(cache.Find(30, 30), nullptr);
+
+  cache.Invalidate(1);
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(ProcessLineageCacheTest, ClearedAtCapacity) {
+  ProcessLineageCache cache(2);
+  cache.Insert(1, MakeEntry(1, "a", {1}));
+  cache.Insert(2, MakeEntry(2, "b", {2}));
+  EXPECT_EQ(cache.size(), 2);
+
+  cache.Insert(3, MakeEntry(3, "c", {3}));
+  EXPECT_EQ(cache.size(), 1);
+  EXPECT_NE(cache.Find(3, 3), nullptr);
+}
+
+}  // namespace
+}  // namespace collector
@@ -0,0 +1,161 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include <fstream>
+#include <string>
+
+#include <ftw.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Process.h"
+#include "ProcfsScraper.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+const char kContainerCgroup[] = "5:pids:/docker/951e643e3c241b225b6284ef2b79a37c13fc64cbf65b5d46bda95fcb98fe63a4\n";
+const char kHostCgroup[] = "0::/init.scope\n";
+
+int RemoveEntry(const char* path, const struct stat* sb, int typeflag, struct FTW* ftwbuf) {
+  return remove(path);
+}
+
+class ProcessScraperTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir_template[] = "/tmp/collector-proc-XXXXXX";
+    ASSERT_NE(mkdtemp(dir_template), nullptr);
+    proc_path_ = dir_template;
+  }
+
+  void TearDown() override {
+    nftw(proc_path_.c_str(), RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+  }
+
+  void AddProcess(uint64_t pid, const std::string& cgroup, const std::string& exe, const std::string& cmdline) {
+    std::string dir = proc_path_ + "/" + std::to_string(pid);
+    ASSERT_EQ(mkdir(dir.c_str(), 0755), 0);
+    ASSERT_EQ(symlink(exe.c_str(), (dir + "/exe").c_str()), 0);
+    std::ofstream(dir + "/cgroup") << cgroup;
+    std::ofstream(dir + "/cmdline", std::ios::binary) << cmdline;
+    std::ofstream(dir + "/stat") << pid << " (" << exe << ") S 1 1 1 0 -1 4194560 0 0 0 0 0 0 0 0 20 0 1 0 " << 1000 + pid << " 0 0\n";
+  }
+
+  std::string proc_path_;
+};
+
+TEST_F(ProcessScraperTest, TestScrape) {
+  AddProcess(100, kContainerCgroup, "/usr/sbin/nginx", std::string("nginx\0-g\0\0daemon off;\0", 23));
+  AddProcess(200, kHostCgroup, "/bin/sh", std::string("sh\0", 3));
+
+  ProcessScraper scraper(proc_path_);
+  ProcessScraper::ProcessInfo info;
+  ASSERT_TRUE(scraper.Scrape(100, info));
+  EXPECT_EQ(info.pid, 100);
+  EXPECT_EQ(info.container_id, "951e643e3c24");
+  EXPECT_EQ(info.comm, "nginx");
+  EXPECT_EQ(info.exe_path, "/usr/sbin/nginx");
+  EXPECT_EQ(info.exe, "nginx");
+  EXPECT_EQ(info.args, "-g daemon off;");
+
+  EXPECT_FALSE(scraper.Scrape(200, info));
+  EXPECT_FALSE(scraper.Scrape(300, info));
+}
+
+TEST_F(ProcessScraperTest, TestScrapeLongCmdline) {
+  std::string arg(10000, 'x');
+  AddProcess(100, kContainerCgroup, "java", std::string("java\0", 5) + arg + '\0' + arg);
+
+  ProcessScraper scraper(proc_path_);
+  ProcessScraper::ProcessInfo info;
+  ASSERT_TRUE(scraper.Scrape(100, info));
+  EXPECT_EQ(info.comm, "java");
+  EXPECT_EQ(info.exe, "java");
+  EXPECT_EQ(info.args, arg + ' ' + arg);
+}
+
+TEST_F(ProcessScraperTest, TestScrapeAll) {
+  for (uint64_t pid = 1; pid <= 200; pid++) {
+    AddProcess(pid, pid % 4 == 0 ? kHostCgroup : kContainerCgroup, "/bin/proc" + std::to_string(pid),
+               std::string("proc\0--id=", 10) + std::to_string(pid));
+  }
+
+  auto cache = std::make_shared<ContainerIDCache>();
+  ProcessScraper scraper(proc_path_, cache, 4);
+  for (int i = 0; i < 2; i++) {
+    std::vector<ProcessScraper::ProcessInfo> infos;
+    ASSERT_TRUE(scraper.ScrapeAll(&infos));
+    ASSERT_EQ(infos.size(), 150);
+    uint64_t pid = 0;
+    for (const auto& info : infos) {
+      EXPECT_GT(info.pid, pid);
+      pid = info.pid;
+      EXPECT_NE(pid % 4, 0);
+      EXPECT_EQ(info.container_id, "951e643e3c24");
+      EXPECT_EQ(info.comm, "proc" + std::to_string(pid));
+      EXPECT_EQ(info.args, "--id=" + std::to_string(pid));
+    }
+    EXPECT_EQ(cache->size(), 2);
+  }
+
+  std::vector<ProcessScraper::ProcessInfo> infos;
+  ASSERT_TRUE(scraper.ScrapeMany({5, 4, 3, 1000}, &infos));
+  ASSERT_EQ(infos.size(), 2);
+  EXPECT_EQ(infos[0].pid, 5);
+  EXPECT_EQ(infos[1].pid, 3);
+}
+
+TEST_F(ProcessScraperTest, TestProcessStoreFetchMany) {
+  AddProcess(100, kContainerCgroup, "/usr/sbin/nginx", std::string("nginx\0-g\0daemon off;\0", 22));
+  AddProcess(101, kContainerCgroup, "/usr/bin/redis-server", std::string("redis-server\0", 13));
+  AddProcess(200, kHostCgroup, "/bin/sh", std::string("sh\0", 3));
+
+  ProcessStore store(nullptr, std::make_shared<ProcessScraper>(proc_path_, std::make_shared<ContainerIDCache>(), 2));
+  auto processes = store.FetchMany({101, 200, 100, 101});
+  ASSERT_EQ(processes.size(), 4);
+  for (const auto& process : processes) ASSERT_NE(process, nullptr);
+
+  EXPECT_EQ(processes[0]->pid(), 101);
+  EXPECT_EQ(processes[0]->exe_path(), "/usr/bin/redis-server");
+  EXPECT_EQ(processes[0], processes[3]);
+  EXPECT_EQ(processes[2]->pid(), 100);
+  EXPECT_EQ(processes[2]->container_id(), "951e643e3c24");
+  EXPECT_EQ(processes[2]->comm(), "nginx");
+  EXPECT_EQ(processes[2]->exe(), "nginx");
+  EXPECT_EQ(processes[2]->args(), "-g daemon off;");
+
+  // Host processes are not read from procfs, and are left to Falco.
+  EXPECT_EQ(processes[1]->pid(), 200);
+  EXPECT_EQ(processes[1]->container_id(), "N/A");
+
+  // Processes are kept in the store as long as they are referenced.
+  EXPECT_EQ(store.Fetch(100), processes[2]);
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -639,6 +639,123 @@ TEST(ProcessSignalFormatterTest, Rox3377ProcessLineageWithNoVPidTest) {
   CollectorStats::Reset();
 }
 
+TEST(ProcessSignalFormatterTest, LineageCacheTest) {
+  std::unique_ptr<sinsp> inspector(new_inspector());
+  CollectorStats& collector_stats = CollectorStats::GetOrCreate();
+
+  ProcessSignalFormatter processSignalFormatter(inspector.get());
+
+  auto tinfo = std::make_shared<sinsp_threadinfo>(inspector.get());
+  tinfo->m_pid = 3;
+  tinfo->m_tid = 3;
+  tinfo->m_ptid = -1;
+  tinfo->m_vpid = 1;
+  tinfo->m_user.uid = 42;
+  tinfo->m_exepath = "asdf";
+  auto tinfo2 = std::make_shared<sinsp_threadinfo>(inspector.get());
+  tinfo2->m_pid = 4;
+  tinfo2->m_tid = 4;
+  tinfo2->m_ptid = 3;
+  tinfo2->m_vpid = 2;
+  tinfo2->m_user.uid = 7;
+  tinfo2->m_exepath = "qwerty";
+  auto tinfo3 = std::make_shared<sinsp_threadinfo>(inspector.get());
+  tinfo3->m_pid = 5;
+  tinfo3->m_tid = 5;
+  tinfo3->m_ptid = 3;
+  tinfo3->m_vpid = 3;
+  tinfo3->m_user.uid = 8;
+  tinfo3->m_exepath = "uiop";
+  inspector->add_thread(tinfo);
+  inspector->add_thread(tinfo2);
+  inspector->add_thread(tinfo3);
+
+  std::vector<LineageInfo> lineage;
+  processSignalFormatter.GetProcessLineage(tinfo2.get(), lineage);
+  ASSERT_EQ(lineage.size(), 1);
+  EXPECT_EQ(lineage[0].parent_exec_file_path(), "asdf");
+
+  // The lineage of the parent's children is cached.
+  std::vector<LineageInfo> lineage2;
+  processSignalFormatter.GetProcessLineage(tinfo3.get(), lineage2);
+  ASSERT_EQ(lineage2.size(), 1);
+  EXPECT_EQ(lineage2[0].parent_exec_file_path(), "asdf");
+  EXPECT_EQ(collector_stats.GetCounter(CollectorStats::process_lineage_cache_hits), 1);
+
+  // Entries depending on a process that exited are dropped.
+  tinfo->m_exepath = "zxcv";
+  processSignalFormatter.HandleProcessExit(3);
+  std::vector<LineageInfo> lineage3;
+  processSignalFormatter.GetProcessLineage(tinfo3.get(), lineage3);
+  ASSERT_EQ(lineage3.size(), 1);
+  EXPECT_EQ(lineage3[0].parent_exec_file_path(), "zxcv");
+
+  // Entries depending on a process that changed its user are dropped.
+  tinfo->m_user.uid = 0;
+  processSignalFormatter.HandleUserChange(3);
+  std::vector<LineageInfo> lineage4;
+  processSignalFormatter.GetProcessLineage(tinfo3.get(), lineage4);
+  ASSERT_EQ(lineage4.size(), 1);
+  EXPECT_EQ(lineage4[0].parent_uid(), 0);
+
+  EXPECT_EQ(collector_stats.GetCounter(CollectorStats::process_lineage_counts), 4);
+
+  CollectorStats::Reset();
+}
+
+TEST(ProcessSignalFormatterTest, SnapshotTest) {
+  std::unique_ptr<sinsp> inspector(new_inspector());
+
+  ProcessSignalFormatter processSignalFormatter(inspector.get());
+
+  auto tinfo = std::make_shared<sinsp_threadinfo>(inspector.get());
+  tinfo->m_pid = 3;
+  tinfo->m_tid = 3;
+  tinfo->m_ptid = -1;
+  tinfo->m_vpid = 1;
+  tinfo->m_user.uid = 42;
+  tinfo->m_exepath = "asdf";
+  auto tinfo2 = std::make_shared<sinsp_threadinfo>(inspector.get());
+  tinfo2->m_pid = 4;
+  tinfo2->m_tid = 4;
+  tinfo2->m_ptid = 3;
+  tinfo2->m_vpid = 2;
+  tinfo2->m_user.uid = 7;
+  tinfo2->m_group.gid = 8;
+  tinfo2->m_clone_ts = 1000000000;
+  tinfo2->m_comm = "<NA>";
+  tinfo2->m_exepath = "qwerty";
+  tinfo2->m_args = {"-c", "echo"};
+  tinfo2->m_container_id = "c2b0b3b4f1a6";
+  inspector->add_thread(tinfo);
+  inspector->add_thread(tinfo2);
+
+  ProcessSignalFormatter::ProcessSnapshot snapshot;
+  ASSERT_TRUE(processSignalFormatter.TakeSnapshot(tinfo2.get(), &snapshot));
+
+  // The snapshot does not refer to the thread.
+  tinfo2->m_exepath = "zxcv";
+  tinfo2->m_args.clear();
+
+  const auto* msg = processSignalFormatter.ToProtoMessage(snapshot);
+  ASSERT_NE(msg, nullptr);
+  const ProcessSignal& signal = msg->signal().process_signal();
+  EXPECT_EQ(signal.name(), "qwerty");
+  EXPECT_EQ(signal.exec_file_path(), "qwerty");
+  EXPECT_EQ(signal.args(), "-c echo");
+  EXPECT_EQ(signal.container_id(), "c2b0b3b4f1a6");
+  EXPECT_EQ(signal.pid(), 4);
+  EXPECT_EQ(signal.uid(), 7);
+  EXPECT_EQ(signal.gid(), 8);
+  EXPECT_EQ(signal.time().seconds(), 1);
+  EXPECT_TRUE(signal.scraped());
+  ASSERT_EQ(signal.lineage_info_size(), 1);
+  EXPECT_EQ(signal.lineage_info(0).parent_exec_file_path(), "asdf");
+  EXPECT_EQ(signal.lineage_info(0).parent_uid(), 42);
+
+  CollectorStats::Reset();
+}
+
 }  // namespace
 
 }  // namespace collector
@@ -0,0 +1,245 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+// clang-format off
+// sinsp.h needs to be included before chisel.h
+#include <Utility.h>
+#include "libsinsp/sinsp.h"
+#include "chisel.h"
+#include "libsinsp/wrapper.h"
+// clang-format on
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ProcessSignalHandler.h"
+#include "SignalServiceClient.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+using ::testing::_;
+using ::testing::ElementsAre;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+using ::testing::Return;
+
+constexpr auto kTimeout = std::chrono::seconds(5);
+
+class MockSignalServiceClient : public ISignalServiceClient {
+ public:
+  MOCK_METHOD(void, Start, (), (override));
+  MOCK_METHOD(void, Stop, (), (override));
+  MOCK_METHOD(SignalHandler::Result, PushSignals, (const sensor::SignalStreamMessage& msg), (override));
+  MOCK_METHOD(uint64_t, dropped_signals, (), (const, override));
+  MOCK_METHOD(size_t, queued_signals, (), (override));
+  MOCK_METHOD(size_t, max_queue_size, (), (const, override));
+};
+
+class TestProcessSignalHandler : public ProcessSignalHandler {
+ public:
+  using ProcessSignalHandler::ProcessSignalHandler;
+  using ProcessSignalHandler::TakeRefreshRequest;
+};
+
+// Records the existing processes sent by the handler, and simulates the send queue of the client: the queue is full
+// until Drain() is called.
+class FakeSendQueue {
+ public:
+  static constexpr size_t kMaxQueueSize = 4;
+
+  explicit FakeSendQueue(MockSignalServiceClient* client) {
+    ON_CALL(*client, max_queue_size()).WillByDefault(Return(kMaxQueueSize));
+    ON_CALL(*client, queued_signals()).WillByDefault(Invoke([this]() {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_checks_++;
+      cond_.notify_all();
+      return queued_;
+    }));
+    ON_CALL(*client, PushSignals(_)).WillByDefault(Invoke([this](const sensor::SignalStreamMessage& msg) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      sent_.push_back(msg.signal().process_signal().exec_file_path());
+      cond_.notify_all();
+      return push_result_;
+    }));
+  }
+
+  void Drain() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queued_ = 0;
+  }
+
+  void SetPushResult(SignalHandler::Result result) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    push_result_ = result;
+  }
+
+  // Waits until the handler has checked the full queue at least twice, i.e., is pausing.
+  bool WaitUntilPaused() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    int checks = queue_checks_;
+    return cond_.wait_for(lock, kTimeout, [this, checks]() { return queue_checks_ >= checks + 2; });
+  }
+
+  bool WaitForSent(size_t num_sent) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cond_.wait_for(lock, kTimeout, [this, num_sent]() { return sent_.size() >= num_sent; });
+  }
+
+  std::vector<std::string> sent() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return sent_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  size_t queued_ = kMaxQueueSize;
+  int queue_checks_ = 0;
+  SignalHandler::Result push_result_ = SignalHandler::PROCESSED;
+  std::vector<std::string> sent_;
+};
+
+// Tests must always reach Stop(), since the handler cannot be destroyed while its threads are running.
+class ProcessSignalHandlerTest : public ::testing::Test {
+ protected:
+  ProcessSignalHandlerTest() : inspector_(new_inspector()) {
+    client_ = new NiceMock<MockSignalServiceClient>();
+    std::unique_ptr<ISignalServiceClient> client(client_);
+    queue_ = MakeUnique<FakeSendQueue>(client_);
+    handler_ = MakeUnique<TestProcessSignalHandler>(inspector_.get(), std::move(client), &stats_);
+  }
+
+  void AddProcess(int64_t pid, const std::string& exepath) {
+    auto tinfo = std::make_shared<sinsp_threadinfo>(inspector_.get());
+    tinfo->m_pid = pid;
+    tinfo->m_tid = pid;
+    tinfo->m_ptid = -1;
+    tinfo->m_vpid = pid;
+    tinfo->m_comm = "<NA>";
+    tinfo->m_exepath = exepath;
+    inspector_->add_thread(tinfo);
+    threads_[pid] = tinfo;
+  }
+
+  // Takes a snapshot of the given processes, and hands it to the existing processes thread.
+  void SendSnapshot(const std::vector<int64_t>& pids) {
+    for (int64_t pid : pids) {
+      EXPECT_EQ(handler_->HandleExistingProcess(threads_[pid].get()), SignalHandler::PROCESSED);
+    }
+    handler_->FinishExistingProcesses();
+  }
+
+  std::unique_ptr<sinsp> inspector_;
+  std::unordered_map<int64_t, std::shared_ptr<sinsp_threadinfo>> threads_;
+  SysdigStats stats_;
+  MockSignalServiceClient* client_;
+  std::unique_ptr<FakeSendQueue> queue_;
+  std::unique_ptr<TestProcessSignalHandler> handler_;
+};
+
+TEST_F(ProcessSignalHandlerTest, PacesOnQueuedSignals) {
+  AddProcess(10, "a");
+  AddProcess(11, "b");
+  AddProcess(12, "c");
+  handler_->Start();
+
+  SendSnapshot({10, 11, 12});
+  EXPECT_TRUE(queue_->WaitUntilPaused());
+  EXPECT_TRUE(queue_->sent().empty());
+
+  queue_->Drain();
+  EXPECT_TRUE(queue_->WaitForSent(3));
+  EXPECT_THAT(queue_->sent(), ElementsAre("a", "b", "c"));
+
+  handler_->Stop();
+}
+
+TEST_F(ProcessSignalHandlerTest, NewerSnapshotReplacesPending) {
+  AddProcess(10, "a");
+  AddProcess(11, "b");
+  AddProcess(12, "c");
+  handler_->Start();
+
+  // Whether or not the thread already picked up the first snapshot, only the latest one is sent.
+  SendSnapshot({10});
+  EXPECT_TRUE(queue_->WaitUntilPaused());
+  SendSnapshot({11});
+  SendSnapshot({12});
+
+  queue_->Drain();
+  EXPECT_TRUE(queue_->WaitForSent(1));
+  handler_->Stop();
+  EXPECT_THAT(queue_->sent(), ElementsAre("c"));
+}
+
+TEST_F(ProcessSignalHandlerTest, RefreshRequestedByExistingProcesses) {
+  AddProcess(10, "a");
+  AddProcess(11, "b");
+  handler_->Start();
+  queue_->Drain();
+  queue_->SetPushResult(SignalHandler::NEEDS_REFRESH);
+
+  // The stream was re-established while sending existing processes, hence the remaining ones are not sent, and the
+  // next event asks for another snapshot.
+  EXPECT_FALSE(handler_->TakeRefreshRequest());
+  SendSnapshot({10, 11});
+  EXPECT_TRUE(queue_->WaitForSent(1));
+  auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  bool refresh_requested = false;
+  while (!(refresh_requested = handler_->TakeRefreshRequest()) && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_TRUE(refresh_requested);
+  EXPECT_FALSE(handler_->TakeRefreshRequest());
+
+  handler_->Stop();
+  EXPECT_THAT(queue_->sent(), ElementsAre("a"));
+}
+
+TEST_F(ProcessSignalHandlerTest, StopWhilePaused) {
+  AddProcess(10, "a");
+  handler_->Start();
+
+  SendSnapshot({10});
+  EXPECT_TRUE(queue_->WaitUntilPaused());
+
+  auto start = std::chrono::steady_clock::now();
+  handler_->Stop();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+  EXPECT_TRUE(queue_->sent().empty());
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -40,6 +40,80 @@ TEST(ProtoAllocator, OverflowDefaultPool) {
   allocator.Reset();
 }
 
+#ifdef USE_PROTO_ARENAS
+
+using ArenaAllocator = internal::ArenaProtoAllocator<sensor::NetworkConnectionInfoMessage>;
+
+constexpr size_t kPoolSize = ArenaAllocator::kPoolGranularity;
+
+// AllocateMessages allocates messages in the allocator until at least the given number of bytes are used.
+void AllocateMessages(ArenaAllocator* allocator, size_t bytes) {
+  for (size_t i = 0; i <= bytes / sizeof(sensor::NetworkConnectionInfoMessage); i++) {
+    allocator->AllocateRoot();
+  }
+}
+
+TEST(ProtoAllocator, GrowsAfterOverflow) {
+  ArenaAllocator allocator(kPoolSize);
+
+  AllocateMessages(&allocator, 4 * kPoolSize);
+  allocator.Reset();
+
+  ProtoAllocatorStats stats = allocator.allocator_stats();
+  EXPECT_EQ(stats.resets, 1u);
+  EXPECT_EQ(stats.hits, 0u);
+  EXPECT_EQ(stats.grows, 1u);
+  EXPECT_GT(stats.pool_size, 4 * kPoolSize);
+  EXPECT_EQ(stats.pool_size % ArenaAllocator::kPoolGranularity, 0u);
+
+  // A message of the same size now fits into the pool.
+  AllocateMessages(&allocator, 4 * kPoolSize);
+  allocator.Reset();
+
+  stats = allocator.allocator_stats();
+  EXPECT_EQ(stats.resets, 2u);
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.grows, 1u);
+}
+
+TEST(ProtoAllocator, ShrinksAfterSpike) {
+  ArenaAllocator allocator(kPoolSize);
+
+  AllocateMessages(&allocator, 16 * kPoolSize);
+  allocator.Reset();
+  size_t spike_pool_size = allocator.allocator_stats().pool_size;
+  EXPECT_GT(spike_pool_size, 16 * kPoolSize);
+
+  for (int i = 0; i < 100; i++) {
+    AllocateMessages(&allocator, kPoolSize / 4);
+    allocator.Reset();
+  }
+
+  ProtoAllocatorStats stats = allocator.allocator_stats();
+  EXPECT_EQ(stats.grows, 1u);
+  EXPECT_GE(stats.shrinks, 1u);
+  EXPECT_EQ(stats.hits, 100u);
+  // The pool never shrinks below its initial size.
+  EXPECT_EQ(stats.pool_size, kPoolSize);
+}
+
+TEST(ProtoAllocator, RespectsMaxPoolSize) {
+  ArenaAllocator allocator(kPoolSize, 2 * kPoolSize);
+
+  for (int i = 0; i < 3; i++) {
+    AllocateMessages(&allocator, 8 * kPoolSize);
+    allocator.Reset();
+  }
+
+  ProtoAllocatorStats stats = allocator.allocator_stats();
+  EXPECT_EQ(stats.resets, 3u);
+  EXPECT_EQ(stats.hits, 0u);
+  EXPECT_EQ(stats.grows, 1u);
+  EXPECT_EQ(stats.pool_size, 2 * kPoolSize);
+}
+
+#endif
+
 }  // namespace
 
 }  // namespace collector
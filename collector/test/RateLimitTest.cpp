@@ -72,23 +72,47 @@ TEST(RateLimitTest, EvictionTest) {
   EXPECT_EQ(r.Allow("A"), true);
   EXPECT_EQ(r.Allow("A"), true);
   EXPECT_EQ(r.Allow("B"), true);
-  EXPECT_EQ(r.Allow("B"), true);
   EXPECT_EQ(r.Allow("A"), false);
-  EXPECT_EQ(r.Allow("B"), false);
 
+  // A has been seen again since it was inserted, hence B is evicted.
   EXPECT_EQ(r.Allow("C"), true);
 
-  EXPECT_EQ(r.Allow("A"), true);
-  EXPECT_EQ(r.Allow("A"), true);
+  EXPECT_EQ(r.Allow("A"), false);
   EXPECT_EQ(r.Allow("B"), true);
   EXPECT_EQ(r.Allow("B"), true);
+  EXPECT_EQ(r.Allow("B"), false);
+}
 
-  EXPECT_EQ(r.Allow("D"), true);
+TEST(RateLimitTest, KeepsHotKeys) {
+  RateLimitCache r(100, 2, 5);
+  EXPECT_EQ(r.Allow("hot"), true);
+  EXPECT_EQ(r.Allow("hot"), true);
+
+  // A storm of one-off keys does not reset the bucket of a key that keeps being seen.
+  for (int i = 0; i < 10000; i++) {
+    EXPECT_EQ(r.Allow(std::to_string(i)), true);
+    if (i % 10 == 0) {
+      EXPECT_EQ(r.Allow("hot"), false);
+    }
+  }
+}
 
-  EXPECT_EQ(r.Allow("A"), true);
-  EXPECT_EQ(r.Allow("A"), true);
-  EXPECT_EQ(r.Allow("B"), true);
-  EXPECT_EQ(r.Allow("B"), true);
+TEST(RateLimitTest, KeyHasher) {
+  auto key = [](const std::string& a, const std::string& b) { return RateLimitKeyHasher().Add(a).Add(b).key(); };
+  EXPECT_EQ(key("container", "/bin/sh"), key("container", "/bin/sh"));
+  EXPECT_NE(key("container", "/bin/sh"), key("container", "/bin/bash"));
+  EXPECT_NE(key("ab", "c"), key("a", "bc"));
+  EXPECT_NE(key("", "12345678"), key("12345678", ""));
+}
+
+TEST(RateLimitTest, ManyKeys) {
+  RateLimitCache r(1000, 1, 5);
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_TRUE(r.Allow(RateLimitKeyHasher().Add(std::to_string(i)).key()));
+  }
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_FALSE(r.Allow(RateLimitKeyHasher().Add(std::to_string(i)).key()));
+  }
 }
 
 }  // namespace
@@ -0,0 +1,82 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include <chrono>
+
+#include "ScrapeScheduler.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+using std::chrono::seconds;
+
+TEST(ScrapeSchedulerTest, SlicesSpreadAcrossInterval) {
+  ScrapeScheduler scheduler(seconds(30), 10, 0, microseconds(0));
+  auto start = ScrapeScheduler::clock::time_point(seconds(1000));
+
+  EXPECT_EQ(start + seconds(3), scheduler.NextSliceTime(start, 1, start + milliseconds(100), milliseconds(100), milliseconds(100)));
+  EXPECT_EQ(start + seconds(27), scheduler.NextSliceTime(start, 9, start + seconds(24), seconds(1), seconds(1)));
+  // A slice that is late runs immediately.
+  EXPECT_EQ(start + seconds(6), scheduler.NextSliceTime(start, 2, start + seconds(8), seconds(5), seconds(5)));
+}
+
+TEST(ScrapeSchedulerTest, CPUBudget) {
+  ScrapeScheduler scheduler(seconds(30), 10, 25, microseconds(0));
+  auto start = ScrapeScheduler::clock::time_point(seconds(1000));
+
+  // Within budget, the slices are paced by the interval.
+  EXPECT_EQ(start + seconds(3), scheduler.NextSliceTime(start, 1, start + milliseconds(500), milliseconds(500), milliseconds(500)));
+  // A slice taking 2s of CPU time needs 6s idle time to stay within a 25% budget.
+  EXPECT_EQ(start + seconds(8), scheduler.NextSliceTime(start, 1, start + seconds(2), seconds(2), seconds(2)));
+  // A slice mostly waiting for I/O is paced by the interval.
+  EXPECT_EQ(start + seconds(3), scheduler.NextSliceTime(start, 1, start + seconds(2), seconds(2), milliseconds(200)));
+}
+
+TEST(ScrapeSchedulerTest, CPUBudgetMultipleWorkers) {
+  ScrapeScheduler scheduler(seconds(30), 10, 25, microseconds(0));
+  auto start = ScrapeScheduler::clock::time_point(seconds(1000));
+
+  // 4 workers spending 2s of CPU time in 500ms of wall time, which must be spread over 8s.
+  EXPECT_EQ(start + milliseconds(8000), scheduler.NextSliceTime(start, 1, start + milliseconds(500), milliseconds(500), seconds(2)));
+}
+
+TEST(ScrapeSchedulerTest, RandomStartOffset) {
+  for (int i = 0; i < 100; i++) {
+    ScrapeScheduler scheduler(seconds(30), 4, 0);
+    EXPECT_GE(scheduler.start_offset(), microseconds(0));
+    EXPECT_LT(scheduler.start_offset(), seconds(30));
+  }
+}
+
+TEST(ScrapeSchedulerTest, InvalidNumSlices) {
+  ScrapeScheduler scheduler(seconds(30), 0, 0, microseconds(0));
+  EXPECT_EQ(1, scheduler.num_slices());
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,266 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DuplexGRPC.h"
+#include "SignalServiceClient.h"
+#include "Utility.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+using grpc_duplex_impl::Result;
+using grpc_duplex_impl::Status;
+using ::testing::ElementsAre;
+using SignalStreamMessage = sensor::SignalStreamMessage;
+using OverflowPolicy = SignalServiceClient::OverflowPolicy;
+
+constexpr auto kTimeout = std::chrono::seconds(5);
+
+// StreamState is the state of the fake signal stream, shared between the test and the writers of the client. While
+// the stream is stalled, writers wait for it to become writable in short steps, like a stream with a slow receiver.
+class StreamState {
+ public:
+  void Stall() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stalled_ = true;
+  }
+
+  void Resume() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stalled_ = false;
+    cond_.notify_all();
+  }
+
+  void Break() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    broken_ = true;
+    cond_.notify_all();
+  }
+
+  // Waits until a writer is waiting for the stalled stream.
+  bool WaitUntilStalled() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cond_.wait_for(lock, kTimeout, [this]() { return stalled_waits_ > 0; });
+  }
+
+  bool WaitForWrites(size_t num_writes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return cond_.wait_for(lock, kTimeout, [this, num_writes]() { return written_.size() >= num_writes; });
+  }
+
+  std::vector<std::string> written() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return written_;
+  }
+
+  Result WaitUntilWritable() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stalled_ && !broken_) {
+      stalled_waits_++;
+      cond_.notify_all();
+      cond_.wait_for(lock, std::chrono::milliseconds(10), [this]() { return !stalled_ || broken_; });
+    }
+    if (broken_) return Result(Status::ERROR);
+    return Result(stalled_ ? Status::TIMEOUT : Status::OK);
+  }
+
+  Result Write(const SignalStreamMessage& msg) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (broken_) return Result(Status::ERROR);
+    written_.push_back(msg.signal().process_signal().id());
+    cond_.notify_all();
+    return Result(Status::OK);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stalled_ = false;
+  bool broken_ = false;
+  int stalled_waits_ = 0;
+  std::vector<std::string> written_;
+};
+
+class FakeSignalWriter : public IDuplexClientWriter<SignalStreamMessage> {
+ public:
+  explicit FakeSignalWriter(StreamState* stream) : stream_(stream) {}
+
+  Result Write(const SignalStreamMessage& obj, const gpr_timespec& deadline) override { return stream_->Write(obj); }
+  Result WriteAsync(const SignalStreamMessage& obj) override { return stream_->Write(obj); }
+  Result WriteAsync(const SignalStreamMessage& obj, const grpc::WriteOptions& options) override { return stream_->Write(obj); }
+  Result WaitUntilWritable(const gpr_timespec& deadline) override { return stream_->WaitUntilWritable(); }
+  Result WaitUntilStarted(const gpr_timespec& deadline) override { return Result(Status::OK); }
+  bool Sleep(const gpr_timespec& deadline) override { return true; }
+  Result WritesDoneAsync() override { return Result(Status::OK); }
+  Result WritesDone(const gpr_timespec& deadline) override { return Result(Status::OK); }
+  Result FinishAsync() override { return Result(Status::OK); }
+  Result WaitUntilFinished(const gpr_timespec& deadline) override { return Result(Status::OK); }
+  Result Finish(grpc::Status* status, const gpr_timespec& deadline) override { return Result(Status::OK); }
+  grpc::Status Finish(const gpr_timespec& deadline) override { return grpc::Status::OK; }
+  void TryCancel() override {}
+  Result Shutdown() override { return Result(Status::OK); }
+
+ private:
+  StreamState* stream_;
+};
+
+// A client which establishes a single stream on the fake stream state. Later attempts wait until the client stops.
+class TestSignalServiceClient : public SignalServiceClient {
+ public:
+  TestSignalServiceClient(StreamState* stream, size_t max_queue_size, OverflowPolicy overflow_policy)
+      : SignalServiceClient(nullptr, GRPC_COMPRESS_NONE, max_queue_size, overflow_policy), stream_(stream) {}
+
+ protected:
+  bool WaitUntilChannelReady(const std::function<bool()>& check_stop) override {
+    if (!connected_) {
+      connected_ = true;
+      return true;
+    }
+    while (!check_stop()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    return false;
+  }
+
+  std::unique_ptr<IDuplexClientWriter<SignalStreamMessage>> CreateWriter(grpc::ClientContext* context) override {
+    return MakeUnique<FakeSignalWriter>(stream_);
+  }
+
+ private:
+  StreamState* stream_;
+  bool connected_ = false;
+};
+
+SignalStreamMessage Signal(const std::string& id) {
+  SignalStreamMessage msg;
+  msg.mutable_signal()->mutable_process_signal()->set_id(id);
+  return msg;
+}
+
+// Starts the client, and waits until its stream is established. The first signal on a new stream is not sent, but
+// requests a refresh instead.
+void StartStream(SignalServiceClient* client) {
+  client->Start();
+  auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  SignalHandler::Result result;
+  while ((result = client->PushSignals(Signal("refresh"))) == SignalHandler::ERROR) {
+    ASSERT_LT(std::chrono::steady_clock::now(), deadline);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(result, SignalHandler::NEEDS_REFRESH);
+}
+
+// Stalls the stream on signal "0", such that the following signals stay in the queue.
+void StallStream(StreamState* stream, SignalServiceClient* client) {
+  stream->Stall();
+  ASSERT_EQ(client->PushSignals(Signal("0")), SignalHandler::PROCESSED);
+  ASSERT_TRUE(stream->WaitUntilStalled());
+}
+
+TEST(SignalServiceClientTest, DropOldest) {
+  StreamState stream;
+  TestSignalServiceClient client(&stream, 3, OverflowPolicy::DROP_OLDEST);
+  StartStream(&client);
+  StallStream(&stream, &client);
+
+  for (const char* id : {"1", "2", "3", "4"}) {
+    EXPECT_EQ(client.PushSignals(Signal(id)), SignalHandler::PROCESSED);
+  }
+  EXPECT_EQ(client.queued_signals(), 3);
+  EXPECT_EQ(client.dropped_signals(), 1);
+
+  stream.Resume();
+  ASSERT_TRUE(stream.WaitForWrites(4));
+  EXPECT_THAT(stream.written(), ElementsAre("0", "2", "3", "4"));
+
+  client.Stop();
+}
+
+TEST(SignalServiceClientTest, DropNewest) {
+  StreamState stream;
+  TestSignalServiceClient client(&stream, 3, OverflowPolicy::DROP_NEWEST);
+  StartStream(&client);
+  StallStream(&stream, &client);
+
+  for (const char* id : {"1", "2", "3"}) {
+    EXPECT_EQ(client.PushSignals(Signal(id)), SignalHandler::PROCESSED);
+  }
+  EXPECT_EQ(client.PushSignals(Signal("4")), SignalHandler::IGNORED);
+  EXPECT_EQ(client.queued_signals(), 3);
+  EXPECT_EQ(client.dropped_signals(), 1);
+
+  stream.Resume();
+  ASSERT_TRUE(stream.WaitForWrites(4));
+  EXPECT_THAT(stream.written(), ElementsAre("0", "1", "2", "3"));
+
+  client.Stop();
+}
+
+TEST(SignalServiceClientTest, DropsUnsentSignalsOnStreamFailure) {
+  StreamState stream;
+  TestSignalServiceClient client(&stream, 3, OverflowPolicy::DROP_OLDEST);
+  StartStream(&client);
+  StallStream(&stream, &client);
+
+  EXPECT_EQ(client.PushSignals(Signal("1")), SignalHandler::PROCESSED);
+  EXPECT_EQ(client.PushSignals(Signal("2")), SignalHandler::PROCESSED);
+
+  // The signal being written and the queued ones are dropped.
+  stream.Break();
+  auto deadline = std::chrono::steady_clock::now() + kTimeout;
+  while (client.dropped_signals() < 3 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(client.dropped_signals(), 3);
+  EXPECT_EQ(client.queued_signals(), 0);
+  EXPECT_TRUE(stream.written().empty());
+  EXPECT_EQ(client.PushSignals(Signal("3")), SignalHandler::ERROR);
+
+  client.Stop();
+}
+
+TEST(SignalServiceClientTest, StopWhileStalled) {
+  StreamState stream;
+  TestSignalServiceClient client(&stream, 3, OverflowPolicy::DROP_OLDEST);
+  StartStream(&client);
+  StallStream(&stream, &client);
+  EXPECT_EQ(client.PushSignals(Signal("1")), SignalHandler::PROCESSED);
+
+  auto start = std::chrono::steady_clock::now();
+  client.Stop();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+  EXPECT_TRUE(stream.written().empty());
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -0,0 +1,257 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <ftw.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "Containers.h"
+#include "FileSystem.h"
+#include "ProcfsScraper_internal.h"
+#include "SockDiag.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+// LoopbackSockets is a listen socket on a loopback address, and both ends of a connection to it.
+struct LoopbackSockets {
+  Address address;
+  uint16_t port = 0;
+  int listener = -1;
+  int client = -1;
+  int server = -1;
+
+  ~LoopbackSockets() { Close(); }
+
+  // Closes the client end first, hence the client socket enters TIME_WAIT.
+  void Close() {
+    for (int* fd : {&client, &server, &listener}) {
+      if (*fd >= 0) close(*fd);
+      *fd = -1;
+    }
+  }
+};
+
+Address LoopbackAddress(Address::Family family) {
+  return family == Address::Family::IPV4 ? Address(127, 0, 0, 1) : Address(htonll(0ULL), htonll(1ULL));
+}
+
+// OpenLoopbackSockets creates a listen socket on the loopback address of the given family, and connects to it.
+bool OpenLoopbackSockets(Address::Family family, LoopbackSockets* sockets) {
+  int af = family == Address::Family::IPV4 ? AF_INET : AF_INET6;
+  struct sockaddr_storage addr;
+  std::memset(&addr, 0, sizeof(addr));
+  socklen_t addr_len;
+  if (af == AF_INET) {
+    auto* sin = reinterpret_cast<struct sockaddr_in*>(&addr);
+    sin->sin_family = AF_INET;
+    sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr_len = sizeof(*sin);
+  } else {
+    auto* sin6 = reinterpret_cast<struct sockaddr_in6*>(&addr);
+    sin6->sin6_family = AF_INET6;
+    sin6->sin6_addr = in6addr_loopback;
+    addr_len = sizeof(*sin6);
+  }
+
+  sockets->listener = ::socket(af, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sockets->listener < 0) return false;
+  if (::bind(sockets->listener, reinterpret_cast<struct sockaddr*>(&addr), addr_len) != 0) return false;
+  if (::listen(sockets->listener, 1) != 0) return false;
+  if (::getsockname(sockets->listener, reinterpret_cast<struct sockaddr*>(&addr), &addr_len) != 0) return false;
+
+  sockets->client = ::socket(af, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (sockets->client < 0) return false;
+  if (::connect(sockets->client, reinterpret_cast<struct sockaddr*>(&addr), addr_len) != 0) return false;
+  sockets->server = ::accept4(sockets->listener, nullptr, nullptr, SOCK_CLOEXEC);
+  if (sockets->server < 0) return false;
+
+  sockets->address = LoopbackAddress(family);
+  sockets->port = ntohs(af == AF_INET ? reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port
+                                      : reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port);
+  return true;
+}
+
+ino_t SocketINode(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) != 0) return 0;
+  return st.st_ino;
+}
+
+uint16_t LocalPort(int fd) {
+  struct sockaddr_storage addr;
+  socklen_t addr_len = sizeof(addr);
+  if (::getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &addr_len) != 0) return 0;
+  return ntohs(addr.ss_family == AF_INET ? reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port
+                                         : reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port);
+}
+
+const InetDiagSocket* FindSocket(const std::vector<InetDiagSocket>& sockets, ino_t inode) {
+  for (const auto& socket : sockets) {
+    if (socket.inode == inode) return &socket;
+  }
+  return nullptr;
+}
+
+TEST(SockDiagTest, TestDumpTcpSockets) {
+  FDHandle diag_fd = OpenSockDiagSocket();
+  if (!diag_fd.valid()) {
+    GTEST_SKIP() << "sock_diag is not available: " << StrError();
+  }
+
+  for (auto family : {Address::Family::IPV4, Address::Family::IPV6}) {
+    LoopbackSockets loopback;
+    if (!OpenLoopbackSockets(family, &loopback)) {
+      ADD_FAILURE() << "Could not open loopback sockets for family " << static_cast<int>(family) << ": " << StrError();
+      continue;
+    }
+
+    // A connection closed by the client first leaves the client socket in TIME_WAIT, which must not be reported.
+    LoopbackSockets closed;
+    ASSERT_TRUE(OpenLoopbackSockets(family, &closed));
+    uint16_t closed_port = LocalPort(closed.client);
+    closed.Close();
+
+    std::vector<InetDiagSocket> sockets;
+    ASSERT_TRUE(DumpTcpSockets(diag_fd, family, &sockets));
+
+    for (const auto& socket : sockets) {
+      EXPECT_TRUE(socket.state == TCP_ESTABLISHED || socket.state == TCP_LISTEN) << "state " << int(socket.state);
+      EXPECT_EQ(socket.local.address().family(), family);
+      EXPECT_NE(socket.local.port(), closed_port);
+    }
+
+    const auto* listener = FindSocket(sockets, SocketINode(loopback.listener));
+    ASSERT_NE(listener, nullptr);
+    EXPECT_EQ(listener->state, TCP_LISTEN);
+    EXPECT_EQ(listener->local, Endpoint(loopback.address, loopback.port));
+
+    uint16_t client_port = LocalPort(loopback.client);
+    const auto* client = FindSocket(sockets, SocketINode(loopback.client));
+    ASSERT_NE(client, nullptr);
+    EXPECT_EQ(client->state, TCP_ESTABLISHED);
+    EXPECT_EQ(client->local, Endpoint(loopback.address, client_port));
+    EXPECT_EQ(client->remote, Endpoint(loopback.address, loopback.port));
+
+    const auto* server = FindSocket(sockets, SocketINode(loopback.server));
+    ASSERT_NE(server, nullptr);
+    EXPECT_EQ(server->state, TCP_ESTABLISHED);
+    EXPECT_EQ(server->local, Endpoint(loopback.address, loopback.port));
+    EXPECT_EQ(server->remote, Endpoint(loopback.address, client_port));
+  }
+}
+
+TEST(SockDiagTest, TestGetConnections) {
+  FDHandle diag_fd = OpenSockDiagSocket();
+  if (!diag_fd.valid()) {
+    GTEST_SKIP() << "sock_diag is not available: " << StrError();
+  }
+
+  LoopbackSockets loopback4, loopback6;
+  ASSERT_TRUE(OpenLoopbackSockets(Address::Family::IPV4, &loopback4));
+  ASSERT_TRUE(OpenLoopbackSockets(Address::Family::IPV6, &loopback6));
+
+  FDHandle self = open("/proc/self", O_RDONLY | O_DIRECTORY);
+  ASSERT_TRUE(self.valid());
+
+  // Both sources report the same sockets of the own network namespace.
+  for (auto source : {ConnectionSource::SOCK_DIAG, ConnectionSource::PROCFS}) {
+    UnorderedMap<ino_t, ConnInfo> connections;
+    UnorderedMap<ino_t, EndpointInfo> listen_endpoints;
+    ASSERT_TRUE(GetConnections(self, source, &connections, &listen_endpoints));
+
+    for (const auto* loopback : {&loopback4, &loopback6}) {
+      Endpoint server_endpoint(loopback->address, loopback->port);
+      Endpoint client_endpoint(loopback->address, LocalPort(loopback->client));
+
+      const auto* listener = Lookup(listen_endpoints, SocketINode(loopback->listener));
+      ASSERT_NE(listener, nullptr);
+      EXPECT_EQ(listener->endpoint, server_endpoint);
+      EXPECT_EQ(listener->l4proto, L4Proto::TCP);
+
+      const auto* server = Lookup(connections, SocketINode(loopback->server));
+      ASSERT_NE(server, nullptr);
+      EXPECT_EQ(server->local, server_endpoint);
+      EXPECT_EQ(server->remote, client_endpoint);
+      EXPECT_TRUE(server->is_server);
+
+      const auto* client = Lookup(connections, SocketINode(loopback->client));
+      ASSERT_NE(client, nullptr);
+      EXPECT_EQ(client->local, client_endpoint);
+      EXPECT_EQ(client->remote, server_endpoint);
+      EXPECT_FALSE(client->is_server);
+    }
+  }
+}
+
+int RemoveEntry(const char* path, const struct stat* sb, int typeflag, struct FTW* ftwbuf) {
+  return remove(path);
+}
+
+TEST(SockDiagTest, TestGetConnectionsFallback) {
+  char dir_template[] = "/tmp/collector-proc-XXXXXX";
+  ASSERT_NE(mkdtemp(dir_template), nullptr);
+  std::string pid_path = dir_template;
+  ASSERT_EQ(mkdir((pid_path + "/ns").c_str(), 0755), 0);
+  ASSERT_EQ(mkdir((pid_path + "/net").c_str(), 0755), 0);
+  // A regular file cannot be entered as a network namespace, hence no sock_diag socket can be opened for it.
+  std::ofstream(pid_path + "/ns/net") << "";
+  std::ofstream(pid_path + "/net/tcp") << "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n"
+                                       << "   0: 0100000A:0050 00000000:0000 0A 00000000:00000000 00:00000000 00000000     0        0 100 1 0000000000000000 100 0 0 10 0\n"
+                                       << "   1: 0100000A:0050 0200000A:C350 01 00000000:00000000 00:00000000 00000000     0        0 101 1 0000000000000000 100 0 0 10 0\n";
+  std::ofstream(pid_path + "/net/tcp6") << "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode\n";
+
+  FDHandle ns_net = open((pid_path + "/ns/net").c_str(), O_RDONLY);
+  ASSERT_TRUE(ns_net.valid());
+  EXPECT_FALSE(OpenSockDiagSocket(ns_net).valid());
+
+  FDHandle dirfd = open(pid_path.c_str(), O_RDONLY | O_DIRECTORY);
+  ASSERT_TRUE(dirfd.valid());
+  UnorderedMap<ino_t, ConnInfo> connections;
+  UnorderedMap<ino_t, EndpointInfo> listen_endpoints;
+  ASSERT_TRUE(GetConnections(dirfd, ConnectionSource::SOCK_DIAG, &connections, &listen_endpoints));
+
+  ASSERT_EQ(listen_endpoints.size(), 1);
+  EXPECT_EQ(listen_endpoints[100].endpoint, Endpoint(Address(10, 0, 0, 1), 80));
+  ASSERT_EQ(connections.size(), 1);
+  EXPECT_EQ(connections[101].remote, Endpoint(Address(10, 0, 0, 2), 50000));
+  EXPECT_TRUE(connections[101].is_server);
+
+  nftw(dir_template, RemoveEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+}  // namespace
+
+}  // namespace collector
@@ -24,6 +24,10 @@ You should have received a copy of the GNU General Public License along with thi
 #include <gmock/gmock-actions.h>
 #include <gmock/gmock-spec-builders.h>
 
+#include <set>
+#include <thread>
+#include <vector>
+
 #include "HostInfo.h"
 #include "Utility.cpp"
 #include "gmock/gmock.h"
@@ -204,4 +208,44 @@ TEST(normalizeReleaseStringTest, Garden318Kernel) {
   EXPECT_EQ(normalized_kernel, expected_kernel);
 }
 
+TEST(JoinProcessArgsTest, Join) {
+  std::string args = "stale";
+  JoinProcessArgs({}, &args);
+  EXPECT_EQ(args, "");
+
+  JoinProcessArgs({"-c"}, &args);
+  EXPECT_EQ(args, "-c");
+
+  JoinProcessArgs({"-c", "", "echo hello"}, &args);
+  EXPECT_EQ(args, "-c  echo hello");
+}
+
+TEST(UUIDStrTest, RFC4122Format) {
+  // Version 4, and the two most significant bits of the clock_seq_hi_and_reserved octet set to 1 and 0.
+  std::regex uuid_v4("^[0-9a-f]{8}-[0-9a-f]{4}-4[0-9a-f]{3}-[89ab][0-9a-f]{3}-[0-9a-f]{12}$");
+  std::set<std::string> uuids;
+  for (int i = 0; i < 10000; i++) {
+    std::string uuid = UUIDStr();
+    EXPECT_TRUE(std::regex_match(uuid, uuid_v4)) << uuid;
+    EXPECT_TRUE(uuids.insert(uuid).second) << "duplicate " << uuid;
+  }
+}
+
+TEST(UUIDStrTest, UniqueAcrossThreads) {
+  constexpr int kNumThreads = 4;
+  constexpr int kNumUUIDs = 10000;
+  std::vector<std::vector<std::string>> generated(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&generated, t]() {
+      for (int i = 0; i < kNumUUIDs; i++) generated[t].emplace_back(UUIDStr());
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  std::set<std::string> uuids;
+  for (const auto& thread_uuids : generated) uuids.insert(thread_uuids.begin(), thread_uuids.end());
+  EXPECT_EQ(uuids.size(), kNumThreads * kNumUUIDs);
+}
+
 }  // namespace collector
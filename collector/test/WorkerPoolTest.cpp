@@ -0,0 +1,96 @@
+/** collector
+
+A full notice with attributions is provided along with this source code.
+
+This program is free software; you can redistribute it and/or modify it under the terms of the GNU General Public License version 2 as published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+* In addition, as a special exception, the copyright holders give
+* permission to link the code of portions of this program with the
+* OpenSSL library under certain conditions as described in each
+* individual source file, and distribute linked combinations
+* including the two.
+* You must obey the GNU General Public License in all respects
+* for all of the code used other than OpenSSL.  If you modify
+* file(s) with this exception, you may extend this exception to your
+* version of the file(s), but you are not obligated to do so.  If you
+* do not wish to do so, delete this exception statement from your
+* version.
+*/
+
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "WorkerPool.h"
+#include "gtest/gtest.h"
+
+namespace collector {
+
+namespace {
+
+TEST(WorkerPoolTest, RunsAllWorkers) {
+  WorkerPool pool(4);
+  EXPECT_EQ(pool.num_workers(), 4);
+
+  std::vector<int> calls(pool.num_workers());
+  pool.Run([&](int worker) { calls[worker]++; });
+  EXPECT_EQ(calls, std::vector<int>({1, 1, 1, 1}));
+
+  // At most max_workers workers run, and worker 0 is the calling thread.
+  std::thread::id worker0;
+  pool.Run(2, [&](int worker) {
+    calls[worker]++;
+    if (worker == 0) worker0 = std::this_thread::get_id();
+  });
+  EXPECT_EQ(calls, std::vector<int>({2, 2, 1, 1}));
+  EXPECT_EQ(worker0, std::this_thread::get_id());
+}
+
+TEST(WorkerPoolTest, ThreadsKeptAcrossRuns) {
+  WorkerPool pool(3);
+  std::mutex mutex;
+  std::set<std::thread::id> thread_ids;
+  for (int i = 0; i < 10; i++) {
+    pool.Run([&](int worker) {
+      std::lock_guard<std::mutex> lock(mutex);
+      thread_ids.insert(std::this_thread::get_id());
+    });
+  }
+  EXPECT_EQ(thread_ids.size(), 3);
+}
+
+TEST(WorkerPoolTest, CPUTime) {
+  WorkerPool pool(2);
+  EXPECT_EQ(pool.cpu_time().count(), 0);
+
+  std::atomic<uint64_t> sink(0);
+  pool.Run([&](int worker) {
+    if (worker == 0) return;
+    uint64_t x = 0;
+    for (int i = 0; i < 10000000; i++) x += i * i;
+    sink += x;
+  });
+  EXPECT_GT(pool.cpu_time().count(), 0);
+}
+
+TEST(WorkerPoolTest, SingleWorker) {
+  WorkerPool pool(0);
+  EXPECT_EQ(pool.num_workers(), 1);
+
+  int calls = 0;
+  pool.Run([&](int worker) {
+    EXPECT_EQ(worker, 0);
+    calls++;
+  });
+  EXPECT_EQ(calls, 1);
+}
+
+}  // namespace
+
+}  // namespace collector